@@ -0,0 +1,271 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// per cycle module dispatch overhead: linked list walk with
+// indirect calls against the flattened per port dispatch table.
+// the board is emulated by plain memory.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtapi.h"
+#include "hal.h"
+
+#include "mdsio.h"
+#include "mdsio_dac.h"
+#include "mdsio_dio.h"
+#include "mdsio_enc.h"
+#include "mdsio_phpe.h"
+#include "mdsio_step.h"
+#include "mdsio_wdt.h"
+
+#define BENCH_NAME "bench"
+#define BENCH_MAX_PORTS 2
+#define BENCH_REG_WORDS 0x4000
+#define BENCH_CONF_WORDS 16
+#define BENCH_CYCLES 50000
+#define BENCH_ROUNDS 10
+#define BENCH_PERIOD 1000000
+
+// internals of mdsio_main.c
+void mdsio_decode_port(mdsio_port_t *port, long period);
+void mdsio_encode_port(mdsio_port_t *port, long period);
+void mdsio_update_dirty(mdsio_port_t *port);
+
+extern int bench_msg_level;
+
+typedef struct {
+  uint32_t regs[BENCH_REG_WORDS];
+  int wdt_word;
+} bench_board_t;
+
+typedef struct {
+  const char *name;
+  int port_count;
+  int mod_count;
+  const uint16_t *types;
+} bench_conf_t;
+
+static const uint16_t bench_types_8[] = {
+  MDSIO_WDT_TYPE, MDSIO_DIO_TYPE, MDSIO_DAC_TYPE, MDSIO_ENC_TYPE,
+  MDSIO_ENC_TYPE, MDSIO_STEP_TYPE, MDSIO_PHPE_TYPE, MDSIO_PHPE_TYPE
+};
+
+static const uint16_t bench_types_16[] = {
+  MDSIO_DIO_TYPE, MDSIO_DAC_TYPE, MDSIO_PHPE_TYPE, MDSIO_PHPE_TYPE,
+  MDSIO_ENC_TYPE, MDSIO_ENC_TYPE, MDSIO_STEP_TYPE, MDSIO_WDT_TYPE,
+  MDSIO_DIO_TYPE, MDSIO_DIO_TYPE, MDSIO_DAC_TYPE, MDSIO_PHPE_TYPE,
+  MDSIO_PHPE_TYPE, MDSIO_ENC_TYPE, MDSIO_ENC_TYPE, MDSIO_STEP_TYPE
+};
+
+static const bench_conf_t bench_confs[] = {
+  { "8 modules", 1, 8, bench_types_8 },
+  { "32 modules", 2, 16, bench_types_16 },
+};
+
+// module sizes with the default channel counts
+static int bench_mod_words(uint16_t type) {
+  switch (type) {
+    case MDSIO_WDT_TYPE:
+      return MDSIO_WDT_LEN >> 2;
+    case MDSIO_DIO_TYPE:
+      return MDSIO_DIO_LEN >> 2;
+    case MDSIO_DAC_TYPE:
+      return MDSIO_DAC_LEN(MDSIO_DAC_CHANNELS) >> 2;
+    case MDSIO_ENC_TYPE:
+      return MDSIO_ENC_LEN(MDSIO_ENC_CHANNELS) >> 2;
+    case MDSIO_STEP_TYPE:
+      return MDSIO_STEP_LEN(MDSIO_STEP_CHANNELS) >> 2;
+    case MDSIO_PHPE_TYPE:
+      return MDSIO_PHPE_LEN(MDSIO_PHPE_CHANNELS) >> 2;
+  }
+  return 0;
+}
+
+static int bench_mod_version(uint16_t type) {
+  switch (type) {
+    case MDSIO_ENC_TYPE:
+      return MDSIO_ENC_VERSION;
+    case MDSIO_PHPE_TYPE:
+      return MDSIO_PHPE_VERSION;
+    case MDSIO_STEP_TYPE:
+      return MDSIO_STEP_VERSION;
+  }
+  return 0;
+}
+
+static uint32_t bench_read_conf(mdsio_port_t *port, int word) {
+  bench_board_t *board = port->device_data;
+  return board->regs[word];
+}
+
+static void bench_read_data(mdsio_port_t *port) {
+  bench_board_t *board = port->device_data;
+  mdsio_span_t *span = port->rd_spans;
+  int count = port->rd_span_count;
+
+  for (; count > 0; count--, span++) {
+    memcpy(port->input_data + span->offset, (char *)board->regs + port->data_offset + span->offset, span->len);
+  }
+}
+
+static void bench_write_data(mdsio_port_t *port) {
+  bench_board_t *board = port->device_data;
+  mdsio_span_t *span = port->wr_dirty;
+  int count = port->wr_dirty_count;
+  uint32_t rand;
+
+  for (; count > 0; count--, span++) {
+    memcpy((char *)board->regs + port->data_offset + span->offset, port->output_data + span->offset, span->len);
+  }
+
+  // watchdog answers with the next lfsr value and a running cycle
+  rand = board->regs[board->wdt_word] & 0xffff;
+  rand = ((rand << 1) | (((rand >> 15) & 1) ^ ((rand >> 10) & 1))) & 0xffff;
+  board->regs[board->wdt_word] = rand | (1 << 17);
+}
+
+static mdsio_dev_t bench_device = {
+  .name = BENCH_NAME,
+  .osc_freq = 33333333,
+  .proc_read_conf = bench_read_conf,
+  .proc_read_input = bench_read_data,
+  .proc_write_output = bench_write_data
+};
+
+static void bench_board_init(bench_board_t *board, const bench_conf_t *conf) {
+  int i, word, words;
+
+  memset(board, 0, sizeof(bench_board_t));
+
+  word = BENCH_CONF_WORDS;
+  for (i = 0; i < conf->mod_count; i++) {
+    board->regs[i] = conf->types[i] | (bench_mod_version(conf->types[i]) << 8) | ((word << 2) << 16);
+    if (conf->types[i] == MDSIO_WDT_TYPE) {
+      board->wdt_word = word;
+      board->regs[word] = 1 | (1 << 17);
+    }
+    words = bench_mod_words(conf->types[i]);
+    word += words;
+  }
+}
+
+static void bench_list_cycle(mdsio_dev_t *device, long period) {
+  mdsio_port_t *port;
+  mdsio_mod_t *module;
+
+  // the walk mdsio_read_port/mdsio_write_port did before the dispatch table
+  for (port = device->first_port; port != NULL; port = port->next) {
+    device->proc_read_input(port);
+    for (module = port->first_module; module != NULL; module = module->next) {
+      module->proc_read(module, period, (uint32_t *)(port->input_view + (module->data_offset - port->data_offset)));
+    }
+  }
+  for (port = device->first_port; port != NULL; port = port->next) {
+    for (module = port->first_module; module != NULL; module = module->next) {
+      module->proc_write(module, period, (uint32_t *)(port->output_data + (module->data_offset - port->data_offset)));
+    }
+    mdsio_update_dirty(port);
+    device->proc_write_output(port);
+  }
+}
+
+static void bench_table_cycle(mdsio_dev_t *device, long period) {
+  mdsio_port_t *port;
+
+  // same order as mdsio_collect_all/mdsio_write_all
+  for (port = device->first_port; port != NULL; port = port->next) {
+    device->proc_read_input(port);
+  }
+  for (port = device->first_port; port != NULL; port = port->next) {
+    mdsio_decode_port(port, period);
+  }
+  for (port = device->first_port; port != NULL; port = port->next) {
+    mdsio_encode_port(port, period);
+    device->proc_write_output(port);
+  }
+}
+
+// best of several rounds, to filter scheduling noise
+static double bench_run(mdsio_dev_t *device, void (*cycle)(mdsio_dev_t *device, long period)) {
+  long long start;
+  double ns, best;
+  int i, r;
+
+  for (i = 0; i < BENCH_CYCLES; i++) {
+    cycle(device, BENCH_PERIOD);
+  }
+
+  best = 0;
+  for (r = 0; r < BENCH_ROUNDS; r++) {
+    start = rtapi_get_time();
+    for (i = 0; i < BENCH_CYCLES; i++) {
+      cycle(device, BENCH_PERIOD);
+    }
+    ns = (double)(rtapi_get_time() - start) / BENCH_CYCLES;
+    if (r == 0 || ns < best) {
+      best = ns;
+    }
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  static bench_board_t boards[BENCH_MAX_PORTS];
+  const bench_conf_t *conf;
+  mdsio_port_t *ports[BENCH_MAX_PORTS];
+  double list_ns, table_ns;
+  int i, p;
+
+  if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+    bench_msg_level = RTAPI_MSG_ALL;
+  }
+
+  printf("%-12s %12s %12s %12s\n", "config", "list ns", "table ns", "ns/module");
+
+  for (i = 0; i < sizeof(bench_confs) / sizeof(bench_confs[0]); i++) {
+    conf = &bench_confs[i];
+
+    if (mdsio_init(&bench_device) < 0) {
+      fprintf(stderr, "mdsio_init failed\n");
+      return 1;
+    }
+    for (p = 0; p < conf->port_count; p++) {
+      bench_board_init(&boards[p], conf);
+      ports[p] = mdsio_create_port(&bench_device, &boards[p]);
+      if (ports[p] == NULL) {
+        fprintf(stderr, "mdsio_create_port failed\n");
+        return 1;
+      }
+    }
+
+    list_ns = bench_run(&bench_device, bench_list_cycle);
+    table_ns = bench_run(&bench_device, bench_table_cycle);
+    printf("%-12s %12.1f %12.1f %12.2f\n", conf->name, list_ns, table_ns,
+      (list_ns - table_ns) / (conf->port_count * conf->mod_count));
+
+    for (p = 0; p < conf->port_count; p++) {
+      mdsio_destroy_port(ports[p]);
+    }
+    mdsio_exit(&bench_device);
+  }
+
+  return 0;
+}
+
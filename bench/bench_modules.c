@@ -0,0 +1,366 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// per call cost of the module read/write kernels. every kernel is
+// fed a synthetic input image that changes each call, and every call
+// is timed on its own to get median, p99 and max. the results are
+// also written to a tab separated file for comparing runs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "rtapi.h"
+#include "hal.h"
+
+#include "mdsio.h"
+#include "mdsio_dac.h"
+#include "mdsio_dio.h"
+#include "mdsio_enc.h"
+#include "mdsio_phpe.h"
+#include "mdsio_step.h"
+
+#define BENCH_NAME "bench"
+#define BENCH_REG_WORDS 0x1000
+#define BENCH_CONF_WORDS 16
+#define BENCH_WARMUP 10000
+#define BENCH_SAMPLES 200000
+#define BENCH_PERIOD 1000000
+#define BENCH_RESULTS "bench_modules.txt"
+
+extern int bench_msg_level;
+volatile void *bench_find(const char *fmt, ...);
+
+typedef struct {
+  const char *name;
+  uint16_t type;
+  int version;
+  int channels[3];
+} bench_type_t;
+
+// channels per module: one, the default of pci_top.vhd and the driver
+// maximum
+static const bench_type_t bench_types[] = {
+  { "step", MDSIO_STEP_TYPE, MDSIO_STEP_VERSION, { 1, MDSIO_STEP_CHANNELS, MDSIO_STEP_MAX_CHANNELS } },
+  { "enc", MDSIO_ENC_TYPE, MDSIO_ENC_VERSION, { 1, MDSIO_ENC_CHANNELS, MDSIO_ENC_MAX_CHANNELS } },
+  { "phpe", MDSIO_PHPE_TYPE, MDSIO_PHPE_VERSION, { 1, MDSIO_PHPE_CHANNELS, MDSIO_PHPE_MAX_CHANNELS } },
+  { "dac", MDSIO_DAC_TYPE, MDSIO_DAC_VERSION, { 1, MDSIO_DAC_CHANNELS, MDSIO_DAC_MAX_CHANNELS } },
+  { "dio", MDSIO_DIO_TYPE, MDSIO_DIO_VERSION, { 1, MDSIO_DIO_CHANNELS, MDSIO_DIO_MAX_CHANNELS } },
+};
+
+// modules per port, the working set grows with it
+static const int bench_mod_counts[] = { 1, 8 };
+
+static int bench_len(const bench_type_t *t, int channels) {
+  switch (t->type) {
+    case MDSIO_STEP_TYPE:
+      return MDSIO_STEP_LEN(channels);
+    case MDSIO_ENC_TYPE:
+      return MDSIO_ENC_LEN(channels);
+    case MDSIO_PHPE_TYPE:
+      return MDSIO_PHPE_LEN(channels);
+    case MDSIO_DAC_TYPE:
+      return MDSIO_DAC_LEN(channels);
+  }
+  return MDSIO_DIO_LEN;
+}
+
+static uint32_t bench_regs[BENCH_REG_WORDS];
+static uint32_t bench_data[BENCH_REG_WORDS];
+static long long bench_samples[BENCH_SAMPLES];
+static long long bench_overhead;
+
+static uint32_t bench_read_conf(mdsio_port_t *port, int word) {
+  return bench_regs[word];
+}
+
+static void bench_rw_data(mdsio_port_t *port) {
+}
+
+static mdsio_dev_t bench_device = {
+  .name = BENCH_NAME,
+  .osc_freq = 33333333,
+  .proc_read_conf = bench_read_conf,
+  .proc_read_input = bench_rw_data,
+  .proc_write_output = bench_rw_data
+};
+
+// synthetic register contents of one module for the given call
+static void bench_fill_input(const bench_type_t *t, int channels, uint32_t *data, int n) {
+  long long accum;
+  double phase;
+  int i;
+
+  switch (t->type) {
+    case MDSIO_STEP_TYPE:
+      data[3] = n * 33333;
+      for (i = 0; i < channels; i++) {
+        accum = (long long)n * (1000LL << 20) * (i + 1);
+        data[6 + MDSIO_STEP_CHAN_WORDS * i] = (uint32_t)(accum >> 32);
+        data[7 + MDSIO_STEP_CHAN_WORDS * i] = (uint32_t)accum;
+        data[8 + MDSIO_STEP_CHAN_WORDS * i] = (uint32_t)((1000LL << 20) * (i + 1) / 33333);
+      }
+      break;
+
+    case MDSIO_ENC_TYPE:
+      data[0] = n * 33333;
+      for (i = 0; i < channels; i++) {
+        data[1 + MDSIO_ENC_CHAN_WORDS * i] = ((n * (i + 3)) & 0x7fffffff) | ((n & 1) << 31);
+        data[2 + MDSIO_ENC_CHAN_WORDS * i] = data[0] - 1000 * (i + 1);
+        data[3 + MDSIO_ENC_CHAN_WORDS * i] = ((n * (i + 3)) & 0x7fffffff) | (((n & 0xff) == 0) << 31);
+      }
+      break;
+
+    case MDSIO_PHPE_TYPE:
+      data[0] = 0;
+      for (i = 0; i < channels; i++) {
+        phase = (double)n * 0.01 * (i + 1);
+        data[3 + MDSIO_PHPE_CHAN_WORDS * i] = (uint32_t)(int32_t)(phase / (2 * M_PI) + 0.5);
+        data[4 + MDSIO_PHPE_CHAN_WORDS * i] = (uint32_t)(int32_t)(600000.0 * sin(phase));
+        data[5 + MDSIO_PHPE_CHAN_WORDS * i] = (uint32_t)(int32_t)(600000.0 * cos(phase));
+        if ((n & 0xff) == 0) {
+          data[0] |= 1 << (8 * i + 2);
+          data[6 + MDSIO_PHPE_CHAN_WORDS * i] = data[3 + MDSIO_PHPE_CHAN_WORDS * i];
+          data[7 + MDSIO_PHPE_CHAN_WORDS * i] = data[4 + MDSIO_PHPE_CHAN_WORDS * i];
+          data[8 + MDSIO_PHPE_CHAN_WORDS * i] = data[5 + MDSIO_PHPE_CHAN_WORDS * i];
+        }
+      }
+      break;
+
+    case MDSIO_DIO_TYPE:
+      data[0] = n * 0x9e3779b9;
+      data[1] = n & 0xff;
+      break;
+  }
+}
+
+// driven pins of one module, looked up once
+typedef struct {
+  hal_float_t *value[MDSIO_DIO_PINS];
+  hal_bit_t *bit[MDSIO_DIO_PINS];
+} bench_pins_t;
+
+static bench_pins_t bench_pins[BENCH_CONF_WORDS];
+
+// enable the channels, so the kernels take their full path
+static void bench_setup_pins(const bench_type_t *t, int channels, mdsio_mod_t *mod, bench_pins_t *pins) {
+  int pidx = mod->port->index;
+  int midx = mod->index;
+  int i;
+
+  switch (t->type) {
+    case MDSIO_STEP_TYPE:
+      for (i = 0; i < channels; i++) {
+        *(hal_bit_t *)bench_find("%s.%d.step.%d.ch%d-enable", BENCH_NAME, pidx, midx, i) = 1;
+        *(hal_float_t *)bench_find("%s.%d.step.%d.ch%d-pos-scale", BENCH_NAME, pidx, midx, i) = 1000.0;
+        *(hal_float_t *)bench_find("%s.%d.step.%d.ch%d-maxaccel", BENCH_NAME, pidx, midx, i) = 500.0;
+        pins->value[i] = (hal_float_t *)bench_find("%s.%d.step.%d.ch%d-velo-cmd", BENCH_NAME, pidx, midx, i);
+      }
+      break;
+
+    case MDSIO_DAC_TYPE:
+      for (i = 0; i < channels; i++) {
+        *(hal_bit_t *)bench_find("%s.%d.dac.%d.ch%d-enable", BENCH_NAME, pidx, midx, i) = 1;
+        pins->value[i] = (hal_float_t *)bench_find("%s.%d.dac.%d.ch%d-value", BENCH_NAME, pidx, midx, i);
+      }
+      break;
+
+    case MDSIO_DIO_TYPE:
+      for (i = 0; i < channels * MDSIO_DIO_BANK_PINS; i++) {
+        pins->bit[i] = (hal_bit_t *)bench_find("%s.%d.dio.%d.dout-%02d", BENCH_NAME, pidx, midx, i);
+      }
+      break;
+  }
+}
+
+// synthetic pin values of one module for the given call
+static void bench_fill_pins(const bench_type_t *t, int channels, bench_pins_t *pins, int n) {
+  int i;
+
+  switch (t->type) {
+    case MDSIO_STEP_TYPE:
+      for (i = 0; i < channels; i++) {
+        *(pins->value[i]) = 50.0 * sin((double)n * 0.001 * (i + 1));
+      }
+      break;
+
+    case MDSIO_DAC_TYPE:
+      for (i = 0; i < channels; i++) {
+        *(pins->value[i]) = sin((double)n * 0.001 * (i + 1));
+      }
+      break;
+
+    case MDSIO_DIO_TYPE:
+      for (i = 0; i < channels * MDSIO_DIO_BANK_PINS; i++) {
+        *(pins->bit[i]) = (n >> (i & 7)) & 1;
+      }
+      break;
+  }
+}
+
+static int bench_cmp(const void *a, const void *b) {
+  long long x = *(const long long *)a;
+  long long y = *(const long long *)b;
+  return (x > y) - (x < y);
+}
+
+static long long bench_sample(long long *samples, int count, double q) {
+  int i = (int)(q * (count - 1));
+  long long v = samples[i] - bench_overhead;
+  return (v < 0) ? 0 : v;
+}
+
+// cost of the timer itself, subtracted from all results
+static void bench_calibrate(void) {
+  long long start;
+  int i;
+
+  for (i = 0; i < BENCH_SAMPLES; i++) {
+    start = rtapi_get_time();
+    bench_samples[i] = rtapi_get_time() - start;
+  }
+  qsort(bench_samples, BENCH_SAMPLES, sizeof(long long), bench_cmp);
+  bench_overhead = bench_samples[BENCH_SAMPLES / 2];
+}
+
+// each sample is one module call, the modules of the port take turns
+static int bench_kernel(FILE *out, const bench_type_t *t, int mod_count, int channels, mdsio_port_t *port, mdsio_mod_t **mods, int write) {
+  mdsio_mod_t *mod;
+  uint32_t *data;
+  long long start;
+  int i, n;
+
+  for (i = 0, n = 0; i < BENCH_WARMUP + BENCH_SAMPLES; i++) {
+    mod = mods[i % mod_count];
+    data = bench_data + ((mod->data_offset - port->data_offset) >> 2);
+    if (write) {
+      bench_fill_pins(t, channels, &bench_pins[i % mod_count], i);
+      start = rtapi_get_time();
+      mod->proc_write(mod, BENCH_PERIOD, data);
+    } else {
+      bench_fill_input(t, channels, data, i);
+      start = rtapi_get_time();
+      mod->proc_read(mod, BENCH_PERIOD, data);
+    }
+    start = rtapi_get_time() - start;
+    if (i >= BENCH_WARMUP) {
+      bench_samples[n++] = start;
+    }
+  }
+
+  qsort(bench_samples, n, sizeof(long long), bench_cmp);
+
+  printf("%-6s %-6s %8d %8d %10lld %10lld %10lld\n", t->name, write ? "write" : "read", mod_count, channels,
+    bench_sample(bench_samples, n, 0.5), bench_sample(bench_samples, n, 0.99), bench_sample(bench_samples, n, 1.0));
+  if (out != NULL) {
+    fprintf(out, "%s\t%s\t%d\t%d\t%lld\t%lld\t%lld\n", t->name, write ? "write" : "read", mod_count, channels,
+      bench_sample(bench_samples, n, 0.5), bench_sample(bench_samples, n, 0.99), bench_sample(bench_samples, n, 1.0));
+  }
+  return 0;
+}
+
+static int bench_type(FILE *out, const bench_type_t *t, int mod_count, int channels) {
+  mdsio_mod_t *mods[BENCH_CONF_WORDS];
+  mdsio_port_t *port;
+  mdsio_mod_t *mod;
+  int i, word;
+
+  memset(bench_regs, 0, sizeof(bench_regs));
+  memset(bench_data, 0, sizeof(bench_data));
+  word = BENCH_CONF_WORDS;
+  for (i = 0; i < mod_count; i++) {
+    bench_regs[i] = t->type | (t->version << 8) | (channels << 12) | ((word << 2) << 16);
+    word += bench_len(t, channels) >> 2;
+  }
+
+  if (mdsio_init(&bench_device) < 0) {
+    fprintf(stderr, "mdsio_init failed\n");
+    return -1;
+  }
+  port = mdsio_create_port(&bench_device, bench_regs);
+  if (port == NULL) {
+    fprintf(stderr, "mdsio_create_port failed\n");
+    mdsio_exit(&bench_device);
+    return -1;
+  }
+
+  for (i = 0, mod = port->first_module; mod != NULL; mod = mod->next) {
+    bench_setup_pins(t, mod->channels, mod, &bench_pins[i]);
+    mods[i++] = mod;
+  }
+
+  // dac is output only, enc output is a plain clear
+  if (t->type != MDSIO_DAC_TYPE) {
+    bench_kernel(out, t, mod_count, mods[0]->channels, port, mods, 0);
+  }
+  if (t->type != MDSIO_ENC_TYPE) {
+    bench_kernel(out, t, mod_count, mods[0]->channels, port, mods, 1);
+  }
+
+  mdsio_destroy_port(port);
+  mdsio_exit(&bench_device);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const char *results = BENCH_RESULTS;
+  FILE *out;
+  int i, j, k;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) {
+      bench_msg_level = RTAPI_MSG_ALL;
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      results = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [-v] [-o results]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  out = fopen(results, "w");
+  if (out == NULL) {
+    perror(results);
+    return 1;
+  }
+
+  bench_calibrate();
+  printf("timer overhead %lld ns, subtracted below\n", bench_overhead);
+  printf("times are per module call\n");
+  printf("%-6s %-6s %8s %8s %10s %10s %10s\n", "type", "kernel", "modules", "ch/mod", "median ns", "p99 ns", "max ns");
+  fprintf(out, "# type\tkernel\tmodules\tchannels_per_module\tmedian_ns\tp99_ns\tmax_ns\n");
+
+  for (i = 0; i < sizeof(bench_types) / sizeof(bench_types[0]); i++) {
+    for (k = 0; k < 3; k++) {
+      // skip repeated counts
+      if (k > 0 && bench_types[i].channels[k] == bench_types[i].channels[k - 1]) {
+        continue;
+      }
+      for (j = 0; j < sizeof(bench_mod_counts) / sizeof(bench_mod_counts[0]); j++) {
+        if (bench_type(out, &bench_types[i], bench_mod_counts[j], bench_types[i].channels[k]) < 0) {
+          fclose(out);
+          return 1;
+        }
+      }
+    }
+  }
+
+  fclose(out);
+  return 0;
+}
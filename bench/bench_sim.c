@@ -0,0 +1,520 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// scenarios on the simulated boards of mdsio_sim, 1 ms servo thread:
+// update, read-all, write-all per cycle. the module sources are
+// included, so the scenarios can set params and look at the state
+// behind the pins. the output is deterministic, runs of two trees
+// can be compared with diff.
+//
+// usage: bench_sim [scenario|all]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "mdsio_enc.c"
+#include "mdsio_img.c"
+#include "mdsio_phpe.c"
+#include "mdsio_step.c"
+#include "mdsio_wdt.c"
+#include "mdsio_sim.c"
+
+#define BENCH_SIM_PERIOD 1000000
+
+// hal functions exported by mdsio_main.c
+void mdsio_read_all(void *arg, long period);
+void mdsio_write_all(void *arg, long period);
+
+volatile void *bench_find(const char *fmt, ...);
+
+typedef struct {
+  const char *name;
+  const char *layout;
+  double time_scale;
+  void (*run)(mdsio_sim_board_t *board, double time_scale);
+} bench_sim_t;
+
+static void bench_sim_cycle(long write_period) {
+  mdsio_sim_update(NULL, BENCH_SIM_PERIOD);
+  mdsio_read_all(&mdsio_device, BENCH_SIM_PERIOD);
+  mdsio_write_all(&mdsio_device, write_period);
+}
+
+static void *bench_sim_module(mdsio_sim_board_t *board, uint16_t type) {
+  mdsio_mod_t *module;
+
+  for (module = board->port->first_module; module != NULL; module = module->next) {
+    if (module->type == type) {
+      return module->hal_data;
+    }
+  }
+  return NULL;
+}
+
+static void *bench_sim_model(mdsio_sim_board_t *board, uint16_t type) {
+  int i;
+
+  for (i=0; i<board->mod_count; i++) {
+    if (board->mods[i].type == type) {
+      return board->mods[i].pins;
+    }
+  }
+  return NULL;
+}
+
+// watchdog start up and step velocity mode, 10 units/s at 100 steps/unit.
+// the step rate is counted per second of thread time.
+static void bench_sim_wdt_step(mdsio_sim_board_t *board, double time_scale) {
+  mdsio_wdt_data_t *wdt = bench_sim_module(board, MDSIO_WDT_TYPE);
+  mdsio_step_data_t *step = bench_sim_module(board, MDSIO_STEP_TYPE);
+  mdsio_sim_step_pins_t *model = bench_sim_model(board, MDSIO_STEP_TYPE);
+  double start = 0.0;
+  int i, up, down;
+
+  mdsio_sim_pins->time_scale = time_scale;
+  *(wdt->enable) = 1;
+  step->channels[0].pos_scale = 100;
+  step->channels[0].maxaccel = 100;
+  *(step->channels[0].enable) = 1;
+  *(step->channels[0].vel_cmd) = 10;
+
+  for (i=0, up=-1, down=0; i<2000; i++) {
+    if (i == 1000) {
+      start = *(model->pos[0]);
+    }
+    bench_sim_cycle(BENCH_SIM_PERIOD);
+    if (board->out_en) {
+      if (up < 0) {
+        up = i + 1;
+      }
+    } else if (up >= 0) {
+      down++;
+    }
+  }
+  printf("outputs enabled after %d cycles, disabled again in %d cycles\n", up, down);
+  printf("%.0f steps per thread second at %.1f Hz commanded\n", *(model->pos[0]) - start, *(model->freq[0]));
+}
+
+// enc tracking loop on a ramp up, hold and slow creep
+static void bench_sim_enc_track(mdsio_sim_board_t *board, double time_scale) {
+  mdsio_enc_data_t *enc = bench_sim_module(board, MDSIO_ENC_TYPE);
+  mdsio_sim_enc_pins_t *model = bench_sim_model(board, MDSIO_ENC_TYPE);
+  mdsio_enc_channel_data_t *chan = &(enc->channels[0]);
+  double t, v;
+  int i;
+
+  *(chan->tl_bw) = 20;
+  *(chan->tl_lead) = 0.001;
+  for (i=0; i<3000; i++) {
+    t = i * 1e-3;
+    v = (t < 1.0) ? 2000 * t : (t < 2.0 ? 2000 : 3.0);
+    *(model->pos[0]) += v * 1e-3;
+    bench_sim_cycle(BENCH_SIM_PERIOD);
+    if (i % 200 == 0 || i == 2999) {
+      printf("%4d v=%7.1f vel=%8.1f tl-vel=%8.1f tl-acc=%8.1f pos=%9.1f tl-pos=%9.1f sim=%9.1f\n", i, v,
+        *(chan->vel), *(chan->tl_vel), *(chan->tl_acc), *(chan->pos), *(chan->tl_pos), *(model->pos[0]));
+    }
+  }
+}
+
+// index latch interpolated with the velocity, both directions
+static void bench_sim_enc_index(mdsio_sim_board_t *board, double time_scale) {
+  mdsio_enc_data_t *enc = bench_sim_module(board, MDSIO_ENC_TYPE);
+  mdsio_sim_enc_pins_t *model = bench_sim_model(board, MDSIO_ENC_TYPE);
+  mdsio_enc_channel_data_t *chan = &(enc->channels[0]);
+  double idx_pos = 0.0;
+  int i, k;
+
+  for (k=0; k<3; k++) {
+    *(chan->index_ena) = 1;
+    for (i=0; i<400; i++) {
+      *(model->pos[0]) += 2345.6e-3 * (k == 1 ? -1 : 1);
+      *(model->index[0]) = (i == 200);
+      if (i == 200) {
+        idx_pos = *(model->pos[0]);
+      }
+      bench_sim_cycle(BENCH_SIM_PERIOD);
+      if (i >= 199 && i <= 203) {
+        printf("pass %d %4d index-enable=%d counts=%d pos-interp=%9.3f sim=%9.3f\n", k, i, *(chan->index_ena),
+          *(chan->count), *(chan->pos_interp), *(model->pos[0]) - idx_pos);
+      }
+    }
+  }
+}
+
+// probe latch, with a held probe input and an index reset in the
+// last pass, sim positions are taken relative to that index
+static void bench_sim_enc_probe(mdsio_sim_board_t *board, double time_scale) {
+  mdsio_enc_data_t *enc = bench_sim_module(board, MDSIO_ENC_TYPE);
+  mdsio_sim_enc_pins_t *model = bench_sim_model(board, MDSIO_ENC_TYPE);
+  mdsio_enc_channel_data_t *chan = &(enc->channels[0]);
+  double prb_pos = 0.0;
+  double idx_pos = 0.0;
+  int i, k;
+
+  *(chan->pos_scale) = 100;
+  for (k=0; k<4; k++) {
+    *(chan->probe_ena) = 1;
+    if (k == 3) {
+      *(chan->index_ena) = 1;
+    }
+    for (i=0; i<400; i++) {
+      *(model->pos[0]) += 2345.6e-3 * (k == 1 ? -1 : 1);
+      *(board->pins->probe) = (i >= 200 && i < 210) || i == 300;
+      *(model->index[0]) = (k == 3 && i == 100);
+      if (k == 3 && i == 100) {
+        idx_pos = *(model->pos[0]);
+      }
+      if (i == 200) {
+        prb_pos = *(model->pos[0]);
+      }
+      bench_sim_cycle(BENCH_SIM_PERIOD);
+    }
+    printf("pass %d probe-enable=%d probe-pos=%10.5f sim=%10.5f pos=%10.5f interp-err=%10.5f\n", k, *(chan->probe_ena),
+      *(chan->probe_pos), (prb_pos - idx_pos) / 100, *(chan->pos), *(chan->pos_interp) - (*(model->pos[0]) - idx_pos) / 100);
+  }
+}
+
+// phpe probe latch on the second channel
+static void bench_sim_phpe_probe(mdsio_sim_board_t *board, double time_scale) {
+  mdsio_phpe_data_t *phpe = bench_sim_module(board, MDSIO_PHPE_TYPE);
+  mdsio_sim_phpe_pins_t *model = bench_sim_model(board, MDSIO_PHPE_TYPE);
+  mdsio_phpe_channel_data_t *chan = &(phpe->channels[1]);
+  double prb_pos = 0.0;
+  int i, k;
+
+  model->array_len = phpe->array_len;
+  *(model->level[1]) = 1.0;
+  for (k=0; k<3; k++) {
+    *(chan->probe_ena) = 1;
+    for (i=0; i<400; i++) {
+      *(model->pos[1]) += 0.0123 * (k == 1 ? -1 : 1);
+      *(board->pins->probe) = (i == 200);
+      if (i == 200) {
+        prb_pos = *(model->pos[1]);
+      }
+      bench_sim_cycle(BENCH_SIM_PERIOD);
+    }
+    printf("pass %d probe-enable=%d probe-pos=%10.5f sim=%10.5f raw-pos=%10.5f\n", k, *(chan->probe_ena),
+      *(chan->probe_pos), prb_pos, *(chan->raw_pos));
+  }
+}
+
+// phpe area latch, board reset and probe on a constant move, the
+// position and the area reference have to survive the reset
+static void bench_sim_phpe_reset(mdsio_sim_board_t *board, double time_scale) {
+  mdsio_phpe_data_t *phpe = bench_sim_module(board, MDSIO_PHPE_TYPE);
+  mdsio_sim_phpe_pins_t *model = bench_sim_model(board, MDSIO_PHPE_TYPE);
+  mdsio_phpe_channel_data_t *chan = &(phpe->channels[0]);
+  double area_pos = 0.0, prb_pos = 0.0, old_pos = 0.0, step, max_dev = 0.0;
+  int i;
+
+  model->array_len = phpe->array_len;
+  *(model->level[0]) = 1.0;
+  *(model->pos[0]) = 3.0;
+  *(chan->area_ena) = 1;
+  for (i=0; i<600; i++) {
+    *(model->pos[0]) += 0.01;
+    *(model->area[0]) = (i >= 150);
+    *(board->pins->reset) = (i == 300);
+    *(board->pins->probe) = (i == 450);
+    if (i == 150) {
+      area_pos = *(model->pos[0]);
+    }
+    if (i == 400) {
+      *(chan->probe_ena) = 1;
+    }
+    if (i == 450) {
+      prb_pos = *(model->pos[0]);
+    }
+    bench_sim_cycle(BENCH_SIM_PERIOD);
+
+    step = *(chan->raw_pos) - old_pos;
+    old_pos = *(chan->raw_pos);
+    if (i > 0 && fabs(step - 0.01) > max_dev) {
+      max_dev = fabs(step - 0.01);
+    }
+    if (i == 299 || i == 302) {
+      printf("%4d raw-counts=%d raw-pos=%10.5f sim=%10.5f\n", i, *(chan->raw_counts), *(chan->raw_pos), *(model->pos[0]));
+    }
+  }
+  printf("area-pos=%10.5f sim=%10.5f probe-pos=%10.5f sim=%10.5f\n", *(chan->area_pos), area_pos,
+    *(chan->probe_pos), prb_pos - area_pos);
+  printf("max step deviation %.5f, pos=%10.5f sim=%10.5f\n", max_dev, *(chan->pos), *(model->pos[0]) - area_pos);
+}
+
+// conf words and masks of a layout with non default channel counts
+static void bench_sim_layout(mdsio_sim_board_t *board, double time_scale) {
+  mdsio_enc_data_t *enc = bench_sim_module(board, MDSIO_ENC_TYPE);
+  mdsio_sim_enc_pins_t *model = bench_sim_model(board, MDSIO_ENC_TYPE);
+  mdsio_mod_t *module, *dio = NULL;
+  hal_bit_t *pin;
+  int i;
+
+  for (i=0; i<board->mod_count; i++) {
+    printf("conf %d: %08x\n", i, board->rd[i]);
+  }
+  for (module = board->port->first_module; module != NULL; module = module->next) {
+    printf("type %d channels %d len %d rd %016llx wr %016llx\n", module->type, module->channels, module->data_len,
+      (unsigned long long)module->rd_mask, (unsigned long long)module->wr_mask);
+    if (module->type == MDSIO_DIO_TYPE) {
+      dio = module;
+    }
+  }
+
+  // the dio outputs loop back in the sim, module indices keep counting across scenarios
+  *(hal_bit_t *)bench_find("%s.%d.dio.%d.dout-03", mdsio_device.name, board->port->index, dio->index) = 1;
+  *(hal_bit_t *)bench_find("%s.%d.dio.%d.dout-15", mdsio_device.name, board->port->index, dio->index) = 1;
+
+  for (i=0; i<100; i++) {
+    *(model->pos[5]) += 3.0;
+    *(model->pos[0]) -= 1.0;
+    bench_sim_cycle(BENCH_SIM_PERIOD);
+  }
+  printf("enc counts ch0 %d ch3 %d ch5 %d\n", *(enc->channels[0].count), *(enc->channels[3].count), *(enc->channels[5].count));
+
+  printf("dio din");
+  for (i=0; i<MDSIO_DIO_PINS; i++) {
+    pin = (hal_bit_t *)bench_find("%s.%d.dio.%d.din-%02d", mdsio_device.name, board->port->index, dio->index, i);
+    if (pin == NULL) {
+      break;
+    }
+    printf("%s%d", (i & 7) ? "" : " ", *pin);
+  }
+  printf(", %d pins\n", i);
+}
+
+// step params and thread period changed on the fly
+static void bench_sim_step_params(mdsio_sim_board_t *board, double time_scale) {
+  mdsio_step_data_t *step = bench_sim_module(board, MDSIO_STEP_TYPE);
+  mdsio_step_channel_data_t *chan;
+  double t;
+  int i, c;
+
+  for (c=0; c<4; c++) {
+    chan = &(step->channels[c]);
+    *(chan->enable) = 1;
+    chan->pos_mode = c & 1;
+    chan->pos_scale = 100 * (c + 1);
+    chan->maxaccel = 50;
+    chan->maxvel = 20;
+  }
+  for (i=0; i<3000; i++) {
+    t = i * 1e-3;
+    for (c=0; c<4; c++) {
+      *(step->channels[c].pos_cmd) = 5 * sin(t * (c + 1));
+      *(step->channels[c].vel_cmd) = 8 * cos(t * (c + 1));
+    }
+    if (i == 500) {
+      step->channels[1].maxaccel = 1e12;
+      step->channels[2].maxvel = 1e9;
+    }
+    if (i == 1000) {
+      step->step_len = 5000;
+      step->step_space = 5000;
+    }
+    if (i == 1500) {
+      step->channels[3].pos_scale = -300;
+      step->channels[0].maxvel = -1;
+    }
+    if (i == 2000) {
+      step->channels[0].pos_scale = 0;
+    }
+    bench_sim_cycle(i < 2500 ? BENCH_SIM_PERIOD : BENCH_SIM_PERIOD / 2);
+    if (i % 100 == 0 || i == 2999) {
+      printf("%4d step-len=%u", i, step->step_len);
+      for (c=0; c<4; c++) {
+        chan = &(step->channels[c]);
+        printf(" f=%.9g fb=%.9g mv=%.9g ma=%.9g", chan->freq, *(chan->pos_fb), chan->maxvel, chan->maxaccel);
+      }
+      printf("\n");
+    }
+  }
+}
+
+// position mode following error, host loop on even, gateware loop on
+// odd channels. 0.2 units at 20 rad/s and 0.02 units at 60 rad/s. the
+// thread starts up to +-jitter ns off the 1 ms grid, the error is taken
+// against the command at the capture time.
+static void bench_sim_step_run(mdsio_sim_board_t *board, long jitter) {
+  mdsio_step_data_t *step = bench_sim_module(board, MDSIO_STEP_TYPE);
+  mdsio_step_channel_data_t *chan;
+  double max_err[4] = { 0.0, }, sum_err[4] = { 0.0, };
+  double freq[4][2] = { { 0.0, }, }, sum_dd[4] = { 0.0, };
+  double dd[4], amp, w, err, t;
+  uint32_t seed = 1;
+  long j = 0, j_old = 0;
+  long words = 0;
+  int i, c, n;
+
+  for (c=0; c<4; c++) {
+    chan = &(step->channels[c]);
+    *(chan->enable) = 1;
+    chan->pos_mode = 1;
+    chan->hw_loop = c & 1;
+    chan->pos_scale = 1000;
+    chan->maxaccel = 200;
+    chan->maxvel = 100;
+  }
+  for (i=0, n=0; i<3000; i++) {
+    for (c=0; c<4; c++) {
+      amp = (c < 2) ? 0.2 : 0.02;
+      w = (c < 2) ? 20 : 60;
+      *(step->channels[c].pos_cmd) = amp * sin(i * 1e-3 * w);
+    }
+    if (jitter > 0) {
+      seed = seed * 1103515245 + 12345;
+      j = (long)((seed >> 8) % (2 * jitter + 1)) - jitter;
+    }
+    mdsio_sim_update(NULL, BENCH_SIM_PERIOD + j - j_old);
+    mdsio_read_all(&mdsio_device, BENCH_SIM_PERIOD);
+    mdsio_write_all(&mdsio_device, BENCH_SIM_PERIOD);
+    j_old = j;
+    for (c=0; c<board->port->wr_dirty_count; c++) {
+      words += board->port->wr_dirty[c].len >> 2;
+    }
+
+    // second difference of the frequency command, the noise the
+    // capture skew puts on the steps
+    for (c=0; c<4; c++) {
+      dd[c] = step->channels[c].freq - 2.0 * freq[c][0] + freq[c][1];
+      freq[c][1] = freq[c][0];
+      freq[c][0] = step->channels[c].freq;
+    }
+
+    // feedback against the command of the next cycle, after the start up
+    if (i <= 500) {
+      continue;
+    }
+    t = (i + 1) * 1e-3 + j * 1e-9;
+    for (c=0; c<4; c++) {
+      amp = (c < 2) ? 0.2 : 0.02;
+      w = (c < 2) ? 20 : 60;
+      err = fabs(*(step->channels[c].pos_fb) - amp * sin(t * w));
+      if (err > max_err[c]) {
+        max_err[c] = err;
+      }
+      sum_err[c] += err * err;
+      sum_dd[c] += dd[c] * dd[c];
+    }
+    n++;
+  }
+  for (c=0; c<4; c++) {
+    printf("ch%d hw-loop=%d max error %.5f rms %.5f units, freq noise %.1f Hz\n", c, c & 1, max_err[c],
+      sqrt(sum_err[c] / n), sqrt(sum_dd[c] / n));
+  }
+  printf("%.2f words written per cycle\n", (double)words / 3000);
+}
+
+static void bench_sim_step_loop(mdsio_sim_board_t *board, double time_scale) {
+  bench_sim_step_run(board, 0);
+}
+
+static void bench_sim_step_jitter(mdsio_sim_board_t *board, double time_scale) {
+  bench_sim_step_run(board, BENCH_SIM_PERIOD / 5);
+}
+
+// image dma with bus master enable cleared for a while, a board
+// reset, and the snapshot timer paced by the host thread
+static void bench_sim_img_dma(mdsio_sim_board_t *board, double time_scale) {
+  mdsio_enc_data_t *enc = bench_sim_module(board, MDSIO_ENC_TYPE);
+  mdsio_img_data_t *img = bench_sim_module(board, MDSIO_IMG_TYPE);
+  mdsio_sim_enc_pins_t *model = bench_sim_model(board, MDSIO_ENC_TYPE);
+  mdsio_port_t *port = board->port;
+  int i;
+
+  printf("image of %d bytes mirrors offset %d, dma buffer %s, input view %s\n", port->img_len, port->img_src,
+    board->dma_buf != NULL ? "allocated" : "missing", port->input_view == board->dma_buf ? "dma buffer" : "port data");
+  for (i=0; i<1000; i++) {
+    *(model->pos[0]) += 1.0;
+    *(board->pins->bus_master) = (i < 200 || i >= 300);
+    *(board->pins->reset) = (i == 400);
+    *(img->pace) = (i >= 600);
+    bench_sim_cycle(BENCH_SIM_PERIOD);
+    if (i % 100 == 0 || i == 201 || i == 301 || i == 402 || (i > 600 && i < 606)) {
+      printf("%4d count=%4d sim=%6.1f seq=%5u seq-errors=%u dma-error=%d stat=%08x period=%u phase=%5.1fus locked=%d late=%u\n",
+        i, *(enc->channels[0].count), *(model->pos[0]), *(img->seq), *(img->seq_errors), board->dma_error,
+        board->rd[board->img->word], board->img->state.img.per, *(img->pace_phase) * 1e6, *(img->pace_locked),
+        *(img->pace_late_count));
+    }
+  }
+}
+
+static const bench_sim_t bench_sims[] = {
+  { "wdt-step", MDSIO_SIM_LAYOUT, 1.0, bench_sim_wdt_step },
+  { "wdt-step-10", MDSIO_SIM_LAYOUT, 10.0, bench_sim_wdt_step },
+  { "wdt-step-50", MDSIO_SIM_LAYOUT, 50.0, bench_sim_wdt_step },
+  { "enc-track", "wdee", 1.0, bench_sim_enc_track },
+  { "enc-index", "wdee", 1.0, bench_sim_enc_index },
+  { "enc-probe", "wdee", 1.0, bench_sim_enc_probe },
+  { "phpe-probe", "wdp", 1.0, bench_sim_phpe_probe },
+  { "phpe-reset", "wdp", 1.0, bench_sim_phpe_reset },
+  { "layout", "wd2e6s5p4a3", 1.0, bench_sim_layout },
+  { "step-params", "wsa", 1.0, bench_sim_step_params },
+  { "step-loop", "s", 1.0, bench_sim_step_loop },
+  { "step-jitter", "s", 1.0, bench_sim_step_jitter },
+  { "img-dma", "wdeei", 1.0, bench_sim_img_dma },
+  { NULL, NULL, 0.0, NULL }
+};
+
+static int bench_sim_run(const bench_sim_t *sim) {
+  int err;
+
+  layout = (char *)sim->layout;
+  if ((err = rtapi_app_main()) != 0) {
+    fprintf(stderr, "%s: rtapi_app_main() failed: %d\n", sim->name, err);
+    return err;
+  }
+
+  printf("--- %s, layout %s, time-scale %.0f\n", sim->name, sim->layout, sim->time_scale);
+  sim->run(mdsio_sim_boards[0], sim->time_scale);
+
+  rtapi_app_exit();
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const bench_sim_t *sim;
+  const char *name = (argc > 1) ? argv[1] : "all";
+  int found = 0;
+
+  // keep the driver messages on stderr in order with the results
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  for (sim = bench_sims; sim->name != NULL; sim++) {
+    if (strcmp(name, "all") != 0 && strcmp(name, sim->name) != 0) {
+      continue;
+    }
+    found = 1;
+    if (bench_sim_run(sim) != 0) {
+      return 1;
+    }
+  }
+
+  if (!found) {
+    fprintf(stderr, "unknown scenario %s, one of: all", name);
+    for (sim = bench_sims; sim->name != NULL; sim++) {
+      fprintf(stderr, " %s", sim->name);
+    }
+    fprintf(stderr, "\n");
+    return 1;
+  }
+  return 0;
+}
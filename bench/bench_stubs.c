@@ -0,0 +1,161 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rtapi.h"
+#include "rtapi_slab.h"
+#include "hal.h"
+
+int bench_msg_level = RTAPI_MSG_ERR;
+
+void rtapi_print_msg(int level, const char *fmt, ...) {
+  va_list ap;
+
+  if (level > bench_msg_level) {
+    return;
+  }
+
+  va_start(ap, fmt);
+  vfprintf(stderr, fmt, ap);
+  va_end(ap);
+}
+
+long long int rtapi_get_time(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long int)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+long long int rtapi_get_clocks(void) {
+  return rtapi_get_time();
+}
+
+void *rtapi_kmalloc(size_t size, int flags) {
+  return malloc(size);
+}
+
+void *rtapi_kzalloc(size_t size, int flags) {
+  return calloc(1, size);
+}
+
+void rtapi_kfree(void *p) {
+  free(p);
+}
+
+int hal_init(const char *name) {
+  return 1;
+}
+
+int hal_ready(int comp_id) {
+  return 0;
+}
+
+void *hal_malloc(long int size) {
+  return calloc(1, size);
+}
+
+int hal_export_funct(const char *name, void (*funct) (void *, long), void *arg, int uses_fp, int reentrant, int comp_id) {
+  return 0;
+}
+
+// pins and params are recorded by name, so benchmarks can drive them
+#define BENCH_MAX_NAMES 4096
+
+typedef struct {
+  char name[HAL_NAME_LEN + 1];
+  volatile void *addr;
+} bench_name_t;
+
+static bench_name_t bench_names[BENCH_MAX_NAMES];
+static int bench_name_count = 0;
+
+static int bench_add_name(volatile void *addr, const char *fmt, va_list ap) {
+  bench_name_t *entry;
+
+  if (bench_name_count >= BENCH_MAX_NAMES) {
+    return -ENOMEM;
+  }
+  entry = &bench_names[bench_name_count++];
+  vsnprintf(entry->name, sizeof(entry->name), fmt, ap);
+  entry->addr = addr;
+  return 0;
+}
+
+volatile void *bench_find(const char *fmt, ...) {
+  char name[HAL_NAME_LEN + 1];
+  va_list ap;
+  int i;
+
+  va_start(ap, fmt);
+  vsnprintf(name, sizeof(name), fmt, ap);
+  va_end(ap);
+
+  for (i = bench_name_count - 1; i >= 0; i--) {
+    if (strcmp(bench_names[i].name, name) == 0) {
+      return bench_names[i].addr;
+    }
+  }
+  return NULL;
+}
+
+// the component goes away with all its pins and params
+int hal_exit(int comp_id) {
+  bench_name_count = 0;
+  return 0;
+}
+
+#define BENCH_PIN_NEWF(type, hal_type) \
+int hal_pin_##type##_newf(hal_pin_dir_t dir, hal_type **data_ptr_addr, int comp_id, const char *fmt, ...) { \
+  va_list ap;                                                                                             \
+  int err;                                                                                                \
+  *data_ptr_addr = hal_malloc(sizeof(hal_type));                                                          \
+  if (*data_ptr_addr == NULL) {                                                                           \
+    return -ENOMEM;                                                                                       \
+  }                                                                                                       \
+  va_start(ap, fmt);                                                                                      \
+  err = bench_add_name(*data_ptr_addr, fmt, ap);                                                          \
+  va_end(ap);                                                                                             \
+  return err;                                                                                             \
+}
+
+#define BENCH_PARAM_NEWF(type, hal_type) \
+int hal_param_##type##_newf(hal_param_dir_t dir, hal_type *data_addr, int comp_id, const char *fmt, ...) { \
+  va_list ap;                                                                                              \
+  int err;                                                                                                 \
+  va_start(ap, fmt);                                                                                       \
+  err = bench_add_name(data_addr, fmt, ap);                                                                \
+  va_end(ap);                                                                                              \
+  return err;                                                                                              \
+}
+
+BENCH_PIN_NEWF(bit, hal_bit_t)
+BENCH_PIN_NEWF(u32, hal_u32_t)
+BENCH_PIN_NEWF(s32, hal_s32_t)
+BENCH_PIN_NEWF(float, hal_float_t)
+
+BENCH_PARAM_NEWF(bit, hal_bit_t)
+BENCH_PARAM_NEWF(u32, hal_u32_t)
+BENCH_PARAM_NEWF(s32, hal_s32_t)
+BENCH_PARAM_NEWF(float, hal_float_t)
+
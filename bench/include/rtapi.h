@@ -0,0 +1,49 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// userspace stand-in for the parts of rtapi.h used by mdsio,
+// only for the benchmark harness.
+
+#ifndef _BENCH_RTAPI_H_
+#define _BENCH_RTAPI_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+
+typedef uint8_t rtapi_u8;
+typedef uint16_t rtapi_u16;
+typedef uint32_t rtapi_u32;
+typedef int32_t rtapi_s32;
+typedef uint64_t rtapi_u64;
+typedef int64_t rtapi_s64;
+
+#define RTAPI_MSG_NONE 0
+#define RTAPI_MSG_ERR  1
+#define RTAPI_MSG_WARN 2
+#define RTAPI_MSG_INFO 3
+#define RTAPI_MSG_DBG  4
+#define RTAPI_MSG_ALL  5
+
+#define rtapi__iomem
+
+void rtapi_print_msg(int level, const char *fmt, ...);
+long long int rtapi_get_time(void);
+long long int rtapi_get_clocks(void);
+
+#endif
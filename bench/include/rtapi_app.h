@@ -0,0 +1,39 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// userspace stand-in for rtapi_app.h, module macros and params are
+// dropped, bench_sim calls rtapi_app_main() and rtapi_app_exit() itself
+
+#ifndef _BENCH_RTAPI_APP_H_
+#define _BENCH_RTAPI_APP_H_
+
+#define MODULE_LICENSE(x)
+#define MODULE_AUTHOR(x)
+#define MODULE_DESCRIPTION(x)
+#define MODULE_SUPPORTED_DEVICE(x)
+#define MODULE_DEVICE_TABLE(type, name)
+
+#define RTAPI_MP_INT(var, descr)
+#define RTAPI_MP_ARRAY_INT(var, num, descr)
+#define RTAPI_MP_STRING(var, descr)
+#define RTAPI_MP_ARRAY_STRING(var, num, descr)
+
+int rtapi_app_main(void);
+void rtapi_app_exit(void);
+
+#endif
@@ -0,0 +1,32 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// userspace stand-in for rtapi_slab.h
+
+#ifndef _BENCH_RTAPI_SLAB_H_
+#define _BENCH_RTAPI_SLAB_H_
+
+#include <stdlib.h>
+
+#define RTAPI_GFP_KERNEL 0
+
+void *rtapi_kmalloc(size_t size, int flags);
+void *rtapi_kzalloc(size_t size, int flags);
+void rtapi_kfree(void *p);
+
+#endif
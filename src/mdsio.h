@@ -20,6 +20,27 @@
 
 #define MDSIO_MAX_MODS_PER_PORT 16
 
+// conf word: byte offset(31..16), channels(15..12),
+// register layout version(11..8), type(7..0).
+// channels = 0 selects the module default.
+#define MDSIO_CONF_TYPE(conf) ((conf) & 0xff)
+#define MDSIO_CONF_VERSION(conf) (((conf) >> 8) & 0x0f)
+#define MDSIO_CONF_CHANNELS(conf) (((conf) >> 12) & 0x0f)
+#define MDSIO_CONF_OFFSET(conf) (((conf) >> 16) & 0xffff)
+
+// register masks (one bit per dword of a module)
+#define MDSIO_MAX_MOD_WORDS 64
+#define MDSIO_MASK(word) (1ULL << (word))
+#define MDSIO_MASK_RANGE(word, count) (((1ULL << (count)) - 1) << (word))
+
+// lazy derived constants: values derived from pins/params are only
+// rebuilt when one of their inputs differs from its shadow copy.
+// MDSIO_CHANGED() takes a changed value over, combine several with '|'
+// so every shadow gets updated. a rebuild that clamps its inputs
+// stores the clamped values in the shadows. constants that derive
+// from other derived values track the generation counter of these.
+#define MDSIO_CHANGED(shadow, val) (((shadow) != (val)) ? ((shadow) = (val), 1) : 0)
+
 // list macros
 #define MDSIO_LIST_APPEND(first, last, item) \
 do {                                         \
@@ -49,19 +70,45 @@ do {                                         \
 struct mdsio_dev;
 struct mdsio_port;
 struct mdsio_mod;
+struct mdsio_prof;
 
 typedef uint32_t (*mdsio_read_conf_t) (struct mdsio_port *port, int word);
 typedef void (*mdsio_rw_data_t) (struct mdsio_port *port);
 typedef void (*mdsio_mod_rw_t) (struct mdsio_mod *mod, long period, uint32_t *data);
 typedef void (*mdsio_mod_cleanup_t) (struct mdsio_mod *mod);
+typedef void (*mdsio_mod_resync_t) (struct mdsio_mod *mod);
+
+typedef struct mdsio_span {
+  uint16_t offset;
+  uint16_t len;
+} mdsio_span_t;
+
+// flattened module dispatch entry, 32 bytes on 64 bit
+typedef struct mdsio_disp {
+  uint16_t type;
+  struct mdsio_mod *module;
+  uint32_t *rd_data;
+  uint32_t *wr_data;
+} mdsio_disp_t;
 
 typedef struct mdsio_dev {
   const char *name;
   uint32_t osc_freq;
   int comp_id;
   mdsio_read_conf_t proc_read_conf;
+  mdsio_rw_data_t proc_request_input;
   mdsio_rw_data_t proc_read_input;
   mdsio_rw_data_t proc_write_output;
+  mdsio_rw_data_t proc_flush_output;
+  mdsio_rw_data_t proc_reset_port;
+#ifdef MDSIO_PROFILE
+  struct mdsio_prof *prof_read;
+  struct mdsio_prof *prof_read_bus;
+  struct mdsio_prof *prof_decode;
+  struct mdsio_prof *prof_write;
+  struct mdsio_prof *prof_encode;
+  struct mdsio_prof *prof_write_bus;
+#endif
   int port_count;
   struct mdsio_port *first_port;
   struct mdsio_port *last_port;
@@ -73,10 +120,49 @@ typedef struct mdsio_port {
   struct mdsio_dev *device;
   void *device_data;
   int index;
+  int conf_count;
+  uint32_t conf[MDSIO_MAX_MODS_PER_PORT];
   uint16_t data_offset;
   uint16_t data_len;
   char *input_data;
+  char *input_view;
+  int input_requested;
   char *output_data;
+  char *output_shadow;
+  int output_valid;
+  int rd_span_count;
+  mdsio_span_t *rd_spans;
+  int wr_span_count;
+  mdsio_span_t *wr_spans;
+  char *wr_force;
+  char *wr_fence;
+  int wr_dirty_count;
+  mdsio_span_t *wr_dirty;
+  int disp_count;
+  mdsio_disp_t *disp;
+  uint16_t img_ctrl;
+  uint16_t img_dma;
+  uint16_t img_offset;
+  uint16_t img_src;
+  uint16_t img_len;
+  uint32_t img_trig;
+  uint32_t img_ts;
+  uint32_t img_trailer;
+  uint16_t img_time;
+  int img_pace;
+  uint32_t img_arrival;
+  uint32_t img_next;
+  long img_tick_scale;
+  long long img_due;
+  long img_wait;
+  long img_timeout;
+  int img_late;
+#ifdef MDSIO_PROFILE
+  struct mdsio_prof *prof_read_bus;
+  struct mdsio_prof *prof_decode;
+  struct mdsio_prof *prof_encode;
+  struct mdsio_prof *prof_write_bus;
+#endif
   int module_count;
   struct mdsio_mod *first_module;
   struct mdsio_mod *last_module;
@@ -87,12 +173,23 @@ typedef struct mdsio_mod {
   struct mdsio_mod *next;
   struct mdsio_port *port;
   uint16_t type;
+  uint8_t version;
+  uint8_t channels;
   uint16_t data_offset;
   uint16_t data_len;
+  uint64_t rd_mask;
+  uint64_t wr_mask;
+  uint64_t force_mask;
+  uint64_t fence_mask;
   int index;
   mdsio_mod_cleanup_t proc_cleanup;
+  mdsio_mod_resync_t proc_resync;
   mdsio_mod_rw_t proc_read;
   mdsio_mod_rw_t proc_write;
+#ifdef MDSIO_PROFILE
+  struct mdsio_prof *prof_read;
+  struct mdsio_prof *prof_write;
+#endif
   void *hal_data;
 } mdsio_mod_t;
 
@@ -103,5 +200,12 @@ void mdsio_exit(mdsio_dev_t *device);
 mdsio_port_t *mdsio_create_port(mdsio_dev_t *device, void *device_data);
 void mdsio_destroy_port(mdsio_port_t *port);
 
+int mdsio_mod_channels(mdsio_mod_t *module, const char *name, int version, int def, int max);
+
+void mdsio_mod_set_force(mdsio_mod_t *module, uint64_t force_mask, uint64_t fence_mask);
+void mdsio_invalidate_output(mdsio_port_t *port);
+int mdsio_resync_port(mdsio_port_t *port);
+void mdsio_set_input_view(mdsio_port_t *port, char *view);
+
 #endif
 
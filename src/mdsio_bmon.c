@@ -0,0 +1,291 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// bus monitor, wishbone access counts of the last servo cycle.
+// the gateware latches them with the watchdog write, together with
+// the board time of that write. with the board time of the read
+// this gives the servo period and the read to write dead time as
+// seen at the machine.
+
+#include "rtapi.h"
+#include "rtapi_string.h"
+#include "rtapi_math.h"
+
+#include "hal.h"
+
+#include "mdsio.h"
+#include "mdsio_bmon.h"
+
+static int mdsio_bmon_index = 0;
+
+typedef struct {
+  hal_u32_t *reads;
+  hal_u32_t *writes;
+  hal_u32_t *wait_clocks;
+  hal_u32_t *busy_clocks;
+  hal_u32_t *retries;
+  hal_float_t *busy_time;
+  hal_float_t *wait_time;
+  hal_u32_t *max_busy_clocks;
+  hal_bit_t *reset_max;
+  hal_float_t *period;
+  hal_float_t *jitter;
+  hal_float_t *jitter_max;
+  hal_float_t *dead_time;
+  hal_float_t *dead_time_max;
+  hal_u32_t *jitter_hist[MDSIO_BMON_HIST_BUCKETS];
+  hal_u32_t *cycles;
+  hal_bit_t *reset_stats;
+  uint32_t rd_ts;
+  uint32_t wr_ts;
+  int ts_valid;
+} mdsio_bmon_data_t;
+
+int mdsio_bmon_export_pins(mdsio_mod_t *module);
+
+int mdsio_bmon_init(mdsio_mod_t *module) {
+  mdsio_port_t *port= module->port;
+  mdsio_dev_t *device= port->device;
+  mdsio_bmon_data_t *hal_data;
+
+  if (mdsio_mod_channels(module, "bmon", MDSIO_BMON_VERSION, 1, 1) != 0) {
+    return -EINVAL;
+  }
+
+  // initialize module
+  module->index = mdsio_bmon_index;
+  module->data_len = MDSIO_BMON_LEN;
+  module->rd_mask = MDSIO_MASK_RANGE(0, 7);
+  module->wr_mask = 0;
+  module->force_mask = 0;
+  module->proc_read = mdsio_bmon_read;
+  module->proc_write = mdsio_bmon_write;
+  module->proc_resync = mdsio_bmon_resync;
+  mdsio_bmon_index++;
+
+  if ((hal_data = hal_malloc(sizeof(mdsio_bmon_data_t))) == 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.bmon.%d: ERROR: hal_malloc() failed\n", device->name, port->index, module->index);
+    return -EIO;
+  }
+  memset(hal_data, 0, sizeof(mdsio_bmon_data_t));
+  module->hal_data = hal_data;
+
+  // register pins
+  if (mdsio_bmon_export_pins(module) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.bmon.%d: ERROR: export_pins() failed\n", device->name, port->index, module->index);
+    return -EIO;
+  }
+
+  return 0;
+}
+
+int mdsio_bmon_export_pins(mdsio_mod_t *module) {
+  mdsio_port_t *port= module->port;
+  mdsio_dev_t *device= port->device;
+  mdsio_bmon_data_t *data = module->hal_data;
+  const char *dname = device->name;
+  int comp_id = device->comp_id;
+  int pidx = port->index;
+  int midx = module->index;
+  int err, i;
+
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(data->reads), comp_id, "%s.%d.bmon.%d.reads", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(data->writes), comp_id, "%s.%d.bmon.%d.writes", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(data->wait_clocks), comp_id, "%s.%d.bmon.%d.wait-clocks", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(data->busy_clocks), comp_id, "%s.%d.bmon.%d.busy-clocks", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(data->retries), comp_id, "%s.%d.bmon.%d.retries", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_float_newf(HAL_OUT, &(data->busy_time), comp_id, "%s.%d.bmon.%d.busy-time", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_float_newf(HAL_OUT, &(data->wait_time), comp_id, "%s.%d.bmon.%d.wait-time", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(data->max_busy_clocks), comp_id, "%s.%d.bmon.%d.max-busy-clocks", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_bit_newf(HAL_IN, &(data->reset_max), comp_id, "%s.%d.bmon.%d.reset-max", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_float_newf(HAL_OUT, &(data->period), comp_id, "%s.%d.bmon.%d.period", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_float_newf(HAL_OUT, &(data->jitter), comp_id, "%s.%d.bmon.%d.jitter", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_float_newf(HAL_OUT, &(data->jitter_max), comp_id, "%s.%d.bmon.%d.jitter-max", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_float_newf(HAL_OUT, &(data->dead_time), comp_id, "%s.%d.bmon.%d.dead-time", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_float_newf(HAL_OUT, &(data->dead_time_max), comp_id, "%s.%d.bmon.%d.dead-time-max", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  for (i=0; i<MDSIO_BMON_HIST_BUCKETS; i++) {
+    if ((err = hal_pin_u32_newf(HAL_OUT, &(data->jitter_hist[i]), comp_id, "%s.%d.bmon.%d.jitter-hist-%02d", dname, pidx, midx, i)) != 0) {
+      return err;
+    }
+    *(data->jitter_hist[i]) = 0;
+  }
+
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(data->cycles), comp_id, "%s.%d.bmon.%d.cycles", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_bit_newf(HAL_IN, &(data->reset_stats), comp_id, "%s.%d.bmon.%d.reset-stats", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  // initialize data
+  *(data->reads) = 0;
+  *(data->writes) = 0;
+  *(data->wait_clocks) = 0;
+  *(data->busy_clocks) = 0;
+  *(data->retries) = 0;
+  *(data->busy_time) = 0.0;
+  *(data->wait_time) = 0.0;
+  *(data->max_busy_clocks) = 0;
+  *(data->reset_max) = 0;
+  *(data->period) = 0.0;
+  *(data->jitter) = 0.0;
+  *(data->jitter_max) = 0.0;
+  *(data->dead_time) = 0.0;
+  *(data->dead_time_max) = 0.0;
+  *(data->cycles) = 0;
+  *(data->reset_stats) = 0;
+
+  data->rd_ts = 0;
+  data->wr_ts = 0;
+  data->ts_valid = 0;
+
+  return 0;
+}
+
+static void mdsio_bmon_timing(mdsio_mod_t *mod, long period, uint32_t rd_ts, uint32_t wr_ts) {
+  mdsio_bmon_data_t *hal_data = mod->hal_data;
+  mdsio_dev_t *device = mod->port->device;
+  double osc_freq = (double)device->osc_freq;
+  int32_t delta, jitter;
+  uint32_t abs_jitter;
+  double val;
+  int i;
+
+  if (*(hal_data->reset_stats)) {
+    *(hal_data->jitter_max) = 0.0;
+    *(hal_data->dead_time_max) = 0.0;
+    *(hal_data->cycles) = 0;
+    for (i=0; i<MDSIO_BMON_HIST_BUCKETS; i++) {
+      *(hal_data->jitter_hist[i]) = 0;
+    }
+  }
+
+  // nothing to compare with after load or a board reset
+  if (!hal_data->ts_valid || wr_ts == hal_data->wr_ts) {
+    hal_data->ts_valid = 1;
+    hal_data->rd_ts = rd_ts;
+    hal_data->wr_ts = wr_ts;
+    return;
+  }
+
+  // servo period between two reads, against the thread period
+  delta = (int32_t)(rd_ts - hal_data->rd_ts);
+  jitter = delta - (int32_t)((double)period * osc_freq * 1e-9);
+  *(hal_data->period) = (double)delta / osc_freq;
+  *(hal_data->jitter) = (double)jitter / osc_freq;
+  val = fabs(*(hal_data->jitter));
+  if (val > *(hal_data->jitter_max)) {
+    *(hal_data->jitter_max) = val;
+  }
+
+  abs_jitter = (jitter < 0) ? -jitter : jitter;
+  for (i=0, abs_jitter >>= MDSIO_BMON_HIST_SHIFT; abs_jitter != 0 && i < (MDSIO_BMON_HIST_BUCKETS - 1); i++, abs_jitter >>= 1);
+  (*(hal_data->jitter_hist[i]))++;
+  (*(hal_data->cycles))++;
+
+  // the write latched now belongs to the previous read
+  delta = (int32_t)(wr_ts - hal_data->rd_ts);
+  if (delta > 0) {
+    *(hal_data->dead_time) = (double)delta / osc_freq;
+    if (*(hal_data->dead_time) > *(hal_data->dead_time_max)) {
+      *(hal_data->dead_time_max) = *(hal_data->dead_time);
+    }
+  }
+
+  hal_data->rd_ts = rd_ts;
+  hal_data->wr_ts = wr_ts;
+}
+
+void mdsio_bmon_read(mdsio_mod_t *mod, long period, uint32_t *data) {
+  mdsio_bmon_data_t *hal_data = mod->hal_data;
+  mdsio_dev_t *device = mod->port->device;
+
+  *(hal_data->reads) = data[0];
+  *(hal_data->writes) = data[1];
+  *(hal_data->wait_clocks) = data[2];
+  *(hal_data->busy_clocks) = data[3];
+  *(hal_data->retries) = data[4];
+
+  // bus clocks in seconds
+  *(hal_data->busy_time) = (double)data[3] / (double)device->osc_freq;
+  *(hal_data->wait_time) = (double)data[2] / (double)device->osc_freq;
+
+  if (*(hal_data->reset_max)) {
+    *(hal_data->max_busy_clocks) = 0;
+  }
+  if (data[3] > *(hal_data->max_busy_clocks)) {
+    *(hal_data->max_busy_clocks) = data[3];
+  }
+
+  mdsio_bmon_timing(mod, period, data[5], data[6]);
+}
+
+void mdsio_bmon_write(mdsio_mod_t *mod, long period, uint32_t *data) {
+  // this module is input only
+  memset(data, 0, MDSIO_BMON_LEN);
+}
+
+void mdsio_bmon_resync(mdsio_mod_t *mod) {
+  mdsio_bmon_data_t *hal_data = mod->hal_data;
+
+  // board timer restarted
+  hal_data->ts_valid = 0;
+}
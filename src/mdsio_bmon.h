@@ -0,0 +1,37 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+#ifndef _MDSIO_BMON_H_
+#define _MDSIO_BMON_H_
+
+#include "mdsio.h"
+
+#define MDSIO_BMON_TYPE 8
+#define MDSIO_BMON_VERSION 0
+#define MDSIO_BMON_LEN 28
+
+// jitter histogram, bucket 0 counts below 32 clocks (about 1us),
+// every further bucket doubles, the last one takes the rest
+#define MDSIO_BMON_HIST_BUCKETS 10
+#define MDSIO_BMON_HIST_SHIFT 5
+
+int mdsio_bmon_init(mdsio_mod_t *module);
+void mdsio_bmon_read(mdsio_mod_t *mod, long period, uint32_t *data);
+void mdsio_bmon_write(mdsio_mod_t *mod, long period, uint32_t *data);
+void mdsio_bmon_resync(mdsio_mod_t *mod);
+
+#endif
@@ -38,25 +38,31 @@ typedef struct {
   double scale_recip;	// reciprocal value used for scaling
   hal_float_t *min_dc;	// pin: minimum duty cycle
   hal_float_t *max_dc;	// pin: maximum duty cycle
+  double old_min_dc;	// stored duty cycle limits
+  double old_max_dc;
   hal_float_t *curr_dc;	// pin: current duty cycle
 } mdsio_dac_channel_data_t;
 
 typedef struct {
-  mdsio_dac_channel_data_t channels[MDSIO_DAC_CHANNELS];
+  mdsio_dac_channel_data_t *channels;
 } mdsio_dac_data_t;
 
 int mdsio_dac_export_pins(mdsio_mod_t *module);
-void mdsio_dac_read(mdsio_mod_t *mod, long period, uint32_t *data);
-void mdsio_dac_write(mdsio_mod_t *mod, long period, uint32_t *data);
 
 int mdsio_dac_init(mdsio_mod_t *module) {
   mdsio_port_t *port= module->port;
   mdsio_dev_t *device= port->device;
   mdsio_dac_data_t *hal_data;
 
+  if (mdsio_mod_channels(module, "dac", MDSIO_DAC_VERSION, MDSIO_DAC_CHANNELS, MDSIO_DAC_MAX_CHANNELS) != 0) {
+    return -EINVAL;
+  }
+
   // initialize module
   module->index = mdsio_dac_index;
-  module->data_len = MDSIO_DAC_LEN;
+  module->data_len = MDSIO_DAC_LEN(module->channels);
+  module->rd_mask = 0;
+  module->wr_mask = MDSIO_MASK_RANGE(0, module->data_len >> 2);
   module->proc_read = mdsio_dac_read;
   module->proc_write = mdsio_dac_write;
   mdsio_dac_index++;
@@ -68,6 +74,12 @@ int mdsio_dac_init(mdsio_mod_t *module) {
   memset(hal_data, 0, sizeof(mdsio_dac_data_t));
   module->hal_data = hal_data;
 
+  if ((hal_data->channels = hal_malloc(module->channels * sizeof(mdsio_dac_channel_data_t))) == 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.dac.%d: ERROR: hal_malloc() failed\n", device->name, port->index, module->index);
+    return -EIO;
+  }
+  memset(hal_data->channels, 0, module->channels * sizeof(mdsio_dac_channel_data_t));
+
   // register pins
   if (mdsio_dac_export_pins(module) != 0) {
     rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.dac.%d: ERROR: export_pins() failed\n", device->name, port->index, module->index);
@@ -89,7 +101,7 @@ int mdsio_dac_export_pins(mdsio_mod_t *module) {
   int err;
   int i;
 
-  for(i=0; i<MDSIO_DAC_CHANNELS; i++) {
+  for(i=0; i<module->channels; i++) {
     data = &(module_data->channels[i]);
 
     // export paramameters
@@ -158,24 +170,30 @@ void mdsio_dac_write(mdsio_mod_t *mod, long period, uint32_t *data) {
   double tmpval, tmpdc;
   int32_t dac_val;
 
-  memset(data, 0, MDSIO_DAC_LEN);
+  memset(data, 0, mod->data_len);
 
-  for (i=0; i<MDSIO_DAC_CHANNELS; i++) {
+  for (i=0; i<mod->channels; i++) {
     hal_data = &(module_data->channels[i]);
 
     // validate duty cycle limits, both limits must be between
-    // 0.0 and 1.0 (inclusive) and max must be greater then min
-    if (*(hal_data->max_dc) > 1.0) {
-      *(hal_data->max_dc) = 1.0;
-    }
-    if (*(hal_data->min_dc) > *(hal_data->max_dc)) {
-      *(hal_data->min_dc) = *(hal_data->max_dc);
-    }
-    if (*(hal_data->min_dc) < -1.0) {
-      *(hal_data->min_dc) = -1.0;
-    }
-    if (*(hal_data->max_dc) < *(hal_data->min_dc)) {
-      *(hal_data->max_dc) = *(hal_data->min_dc);
+    // 0.0 and 1.0 (inclusive) and max must be greater then min.
+    // only needed when they change
+    if (MDSIO_CHANGED(hal_data->old_min_dc, *(hal_data->min_dc)) |
+        MDSIO_CHANGED(hal_data->old_max_dc, *(hal_data->max_dc))) {
+      if (*(hal_data->max_dc) > 1.0) {
+        *(hal_data->max_dc) = 1.0;
+      }
+      if (*(hal_data->min_dc) > *(hal_data->max_dc)) {
+        *(hal_data->min_dc) = *(hal_data->max_dc);
+      }
+      if (*(hal_data->min_dc) < -1.0) {
+        *(hal_data->min_dc) = -1.0;
+      }
+      if (*(hal_data->max_dc) < *(hal_data->min_dc)) {
+        *(hal_data->max_dc) = *(hal_data->min_dc);
+      }
+      hal_data->old_min_dc = *(hal_data->min_dc);
+      hal_data->old_max_dc = *(hal_data->max_dc);
     }
 
     // do scale calcs only when scale changes
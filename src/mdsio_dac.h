@@ -21,10 +21,17 @@
 #include "mdsio.h"
 
 #define MDSIO_DAC_TYPE 3
-#define MDSIO_DAC_LEN 12
+#define MDSIO_DAC_VERSION 0
 
+// default and max channel count, three dual dacs on the header
 #define MDSIO_DAC_CHANNELS 6
+#define MDSIO_DAC_MAX_CHANNELS 6
+
+// two 16 bit channels per word
+#define MDSIO_DAC_LEN(channels) ((((channels) + 1) >> 1) << 2)
 
 int mdsio_dac_init(mdsio_mod_t *module);
+void mdsio_dac_read(mdsio_mod_t *mod, long period, uint32_t *data);
+void mdsio_dac_write(mdsio_mod_t *mod, long period, uint32_t *data);
 
 #endif
@@ -37,20 +37,27 @@ typedef struct {
   hal_bit_t *output_error_reset;
   hal_bit_t *output_fault;
   hal_bit_t *output_fault_reset;
+  hal_u32_t probe_src;
+  hal_bit_t probe_inv;
+  int pins;
 } mdsio_dio_data_t;
 
 int mdsio_dio_export_pins(mdsio_mod_t *module);
-void mdsio_dio_read(mdsio_mod_t *mod, long period, uint32_t *data);
-void mdsio_dio_write(mdsio_mod_t *mod, long period, uint32_t *data);
 
 int mdsio_dio_init(mdsio_mod_t *module) {
   mdsio_port_t *port= module->port;
   mdsio_dev_t *device= port->device;
   mdsio_dio_data_t *hal_data;
 
+  if (mdsio_mod_channels(module, "dio", MDSIO_DIO_VERSION, MDSIO_DIO_CHANNELS, MDSIO_DIO_MAX_CHANNELS) != 0) {
+    return -EINVAL;
+  }
+
   // initialize module
   module->index = mdsio_dio_index;
   module->data_len = MDSIO_DIO_LEN;
+  module->rd_mask = MDSIO_MASK_RANGE(0, 2);
+  module->wr_mask = MDSIO_MASK_RANGE(0, 2);
   module->proc_read = mdsio_dio_read;
   module->proc_write = mdsio_dio_write;
   mdsio_dio_index++;
@@ -60,6 +67,7 @@ int mdsio_dio_init(mdsio_mod_t *module) {
     return -EIO;
   }
   memset(hal_data, 0, sizeof(mdsio_dio_data_t));
+  hal_data->pins = module->channels * MDSIO_DIO_BANK_PINS;
   module->hal_data = hal_data;
 
   // register pins
@@ -109,7 +117,16 @@ int mdsio_dio_export_pins(mdsio_mod_t *module) {
   *(data->output_fault) = 0;
   *(data->output_fault_reset) = 0;
 
-  for (i=0; i<MDSIO_DIO_PINS; i++) {
+  if ((err = hal_param_u32_newf(HAL_RW, &(data->probe_src), comp_id, "%s.%d.dio.%d.probe-src", dname, pidx, midx)) != 0) {
+    return err;
+  }
+  if ((err = hal_param_bit_newf(HAL_RW, &(data->probe_inv), comp_id, "%s.%d.dio.%d.probe-invert", dname, pidx, midx)) != 0) {
+    return err;
+  }
+  data->probe_src = 0;
+  data->probe_inv = 0;
+
+  for (i=0; i<data->pins; i++) {
     if ((err = hal_pin_bit_newf(HAL_OUT, &(data->input_pins[i]), comp_id, "%s.%d.dio.%d.din-%02d", dname, pidx, midx, i)) != 0) {
       return err;
     }
@@ -140,7 +157,7 @@ void mdsio_dio_read(mdsio_mod_t *mod, long period, uint32_t *data) {
   int i, word, bit;
   hal_bit_t error_pin;
 
-  for (i=0; i<MDSIO_DIO_PINS; i++) {
+  for (i=0; i<hal_data->pins; i++) {
     word = i >> 5;
     bit = i & 0x1f;
 
@@ -172,13 +189,13 @@ void mdsio_dio_read(mdsio_mod_t *mod, long period, uint32_t *data) {
 
 void mdsio_dio_write(mdsio_mod_t *mod, long period, uint32_t *data) {
   mdsio_dio_data_t *hal_data = mod->hal_data;
-  uint32_t reg;
+  uint32_t reg, src;
   int i, word, bit;
   hal_bit_t state;
   
   memset(data, 0, MDSIO_DIO_LEN);
 
-  for (i=0; i<MDSIO_DIO_PINS; i++) {
+  for (i=0; i<hal_data->pins; i++) {
     word = i >> 5;
     bit = i & 0x1f;
 
@@ -201,6 +218,16 @@ void mdsio_dio_write(mdsio_mod_t *mod, long period, uint32_t *data) {
   if(*(hal_data->output_fault_reset)) {
     reg |= (1 << 16);
   }
+
+  // probe trigger for the enc/phpe latches
+  src = hal_data->probe_src;
+  if (src > hal_data->pins) {
+    src = MDSIO_DIO_PROBE_OFF;
+  }
+  reg |= src << 24;
+  if (hal_data->probe_inv) {
+    reg |= (1 << 30);
+  }
   data[1] = reg;
 }
 
@@ -21,10 +21,23 @@
 #include "mdsio.h"
 
 #define MDSIO_DIO_TYPE 2
+#define MDSIO_DIO_VERSION 0
 #define MDSIO_DIO_LEN 8
 
-#define MDSIO_DIO_PINS 40
+// default and max channel count, a channel is a bank of 8 inputs and
+// 8 outputs on the serial chain. the layout stays at 2 words, the
+// flags share the second one with the upper pins.
+#define MDSIO_DIO_CHANNELS 5
+#define MDSIO_DIO_MAX_CHANNELS 5
+#define MDSIO_DIO_BANK_PINS 8
+
+#define MDSIO_DIO_PINS (MDSIO_DIO_MAX_CHANNELS * MDSIO_DIO_BANK_PINS)
+
+// probe trigger source, 0 = probe input, n = din n-1
+#define MDSIO_DIO_PROBE_OFF 0x3f
 
 int mdsio_dio_init(mdsio_mod_t *module);
+void mdsio_dio_read(mdsio_mod_t *mod, long period, uint32_t *data);
+void mdsio_dio_write(mdsio_mod_t *mod, long period, uint32_t *data);
 
 #endif
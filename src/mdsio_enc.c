@@ -18,6 +18,7 @@
 
 #include "rtapi.h"
 #include "rtapi_string.h"
+#include "rtapi_math.h"
 
 #include "hal.h"
 
@@ -28,6 +29,7 @@ static int mdsio_enc_index = 0;
 
 typedef struct {
   int do_init;
+  int resync;			// u:rw rebase on restarted hardware counter
   hal_s32_t *raw_counts;	// u:rw raw count value, in update() only
   hal_bit_t *index_ena;		// c:rw index enable input
   hal_bit_t *reset;		// c:r counter reset input
@@ -35,6 +37,11 @@ typedef struct {
   int32_t raw_count;		// c:rw captured raw_count
   uint32_t timestamp;		// c:rw captured timestamp
   int32_t index_count;		// c:rw captured index count
+  double index_frac;		// c:rw index edge beyond index_count in counts
+  int idx_wait;			// c:rw index consumed, wait for the hw flag to clear
+  hal_bit_t *probe_ena;		// c:rw probe enable input
+  hal_float_t *probe_pos;	// c:w scaled position at the probe edge
+  int probe_wait;		// c:rw probe consumed, wait for the hw flag to clear
   hal_s32_t *count;		// c:w captured binary count value
   hal_float_t *pos;		// c:w scaled position (floating point)
   hal_float_t *pos_interp;	// c:w scaled and interpolated position (float)
@@ -43,27 +50,52 @@ typedef struct {
   double old_scale;		// c:rw stored scale value
   double scale;			// c:rw reciprocal value used for scaling
   int counts_since_timeout;	// c:rw used for velocity calcs
+  hal_float_t *tl_bw;		// c:r tracking loop bandwidth in Hz, 0 = off
+  hal_float_t *tl_lead;		// c:r tracking loop prediction time in sec.
+  hal_float_t *tl_pos;		// c:w tracking loop position, predicted
+  hal_float_t *tl_vel;		// c:w tracking loop velocity
+  hal_float_t *tl_acc;		// c:w tracking loop acceleration
+  double tl_p;			// c:rw loop state in raw counts
+  double tl_v;			// c:rw loop state in counts/sec.
+  double tl_a;			// c:rw loop state in counts/sec.^2
+  uint32_t tl_timebase;		// c:rw timebase of the loop state
+  int tl_valid;			// c:rw loop state valid
 } mdsio_enc_channel_data_t;
 
 typedef struct {
   hal_float_t timeout;		// c:rw timeout for vel in sec. (floating point)
-  mdsio_enc_channel_data_t channels[MDSIO_ENC_CHANNELS];
+  double old_timeout;		// c:rw stored timeout value
+  uint32_t timeout_cnt;		// c:rw timeout in timer clocks
+  double osc_period;		// c:r timer clock period in sec.
+  mdsio_enc_channel_data_t *channels;
 } mdsio_enc_data_t;
 
 int mdsio_enc_export_pins(mdsio_mod_t *module);
-void mdsio_enc_read(mdsio_mod_t *mod, long period, uint32_t *data);
-void mdsio_enc_write(mdsio_mod_t *mod, long period, uint32_t *data);
+static double mdsio_enc_latch_frac(double osc_period, int32_t raw_count, uint32_t timestamp, int32_t latch_count,
+  uint32_t latch_ts, double vel);
+static void mdsio_enc_track(mdsio_enc_channel_data_t *chan, double osc_period, int32_t raw_count, uint32_t timestamp,
+  uint32_t timebase, int cnt_flag, double index_pos, double scale);
+static void mdsio_enc_read_chan(mdsio_enc_data_t *module_data, mdsio_enc_channel_data_t *hal_data,
+  uint32_t timebase, uint32_t timeout, uint32_t *data);
+static void mdsio_enc_resync_chan(mdsio_enc_channel_data_t *hal_data);
 
 int mdsio_enc_init(mdsio_mod_t *module) {
   mdsio_port_t *port= module->port;
   mdsio_dev_t *device= port->device;
   mdsio_enc_data_t *hal_data;
 
+  if (mdsio_mod_channels(module, "enc", MDSIO_ENC_VERSION, MDSIO_ENC_CHANNELS, MDSIO_ENC_MAX_CHANNELS) != 0) {
+    return -EINVAL;
+  }
+
   // initialize module
   module->index = mdsio_enc_index;
-  module->data_len = MDSIO_ENC_LEN;
+  module->data_len = MDSIO_ENC_LEN(module->channels);
+  module->rd_mask = MDSIO_MASK_RANGE(0, 1 + MDSIO_ENC_CHAN_WORDS * module->channels);
+  module->wr_mask = MDSIO_MASK(0);
   module->proc_read = mdsio_enc_read;
   module->proc_write = mdsio_enc_write;
+  module->proc_resync = mdsio_enc_resync;
   mdsio_enc_index++;
 
   if ((hal_data = hal_malloc(sizeof(mdsio_enc_data_t))) == 0) {
@@ -73,6 +105,14 @@ int mdsio_enc_init(mdsio_mod_t *module) {
   memset(hal_data, 0, sizeof(mdsio_enc_data_t));
   module->hal_data = hal_data;
 
+  if ((hal_data->channels = hal_malloc(module->channels * sizeof(mdsio_enc_channel_data_t))) == 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.enc.%d: ERROR: hal_malloc() failed\n", device->name, port->index, module->index);
+    return -EIO;
+  }
+  memset(hal_data->channels, 0, module->channels * sizeof(mdsio_enc_channel_data_t));
+
+  hal_data->osc_period = 1.0 / (double)device->osc_freq;
+
   // register pins
   if (mdsio_enc_export_pins(module) != 0) {
     rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.enc.%d: ERROR: export_pins() failed\n", device->name, port->index, module->index);
@@ -100,13 +140,20 @@ int mdsio_enc_export_pins(mdsio_mod_t *module) {
   }
   module_data->timeout = 0.1;
 
-  for(i=0; i<MDSIO_ENC_CHANNELS; i++) {
+  for(i=0; i<module->channels; i++) {
     data = &(module_data->channels[i]);
 
     // export pin for the index enable input
     if ((err = hal_pin_bit_newf(HAL_IO, &(data->index_ena), comp_id, "%s.%d.enc.%d.ch%d-index-enable", dname, pidx, midx, i)) != 0) {
       return err;
     }
+    // export pins for the probe latch
+    if ((err = hal_pin_bit_newf(HAL_IO, &(data->probe_ena), comp_id, "%s.%d.enc.%d.ch%d-probe-enable", dname, pidx, midx, i)) != 0) {
+      return err;
+    }
+    if ((err = hal_pin_float_newf(HAL_OUT, &(data->probe_pos), comp_id, "%s.%d.enc.%d.ch%d-probe-pos", dname, pidx, midx, i)) != 0) {
+      return err;
+    }
     // export pin for the reset input
     if ((err = hal_pin_bit_newf(HAL_IN, &(data->reset), comp_id, "%s.%d.enc.%d.ch%d-reset", dname, pidx, midx, i)) != 0) {
       return err;
@@ -135,6 +182,22 @@ int mdsio_enc_export_pins(mdsio_mod_t *module) {
     if ((err = hal_pin_float_newf(HAL_IO, &(data->pos_scale), comp_id, "%s.%d.enc.%d.ch%d-pos-scale", dname, pidx, midx, i)) != 0) {
       return err;
     }
+    // export pins for the tracking loop estimator
+    if ((err = hal_pin_float_newf(HAL_IN, &(data->tl_bw), comp_id, "%s.%d.enc.%d.ch%d-tl-bandwidth", dname, pidx, midx, i)) != 0) {
+      return err;
+    }
+    if ((err = hal_pin_float_newf(HAL_IN, &(data->tl_lead), comp_id, "%s.%d.enc.%d.ch%d-tl-lead", dname, pidx, midx, i)) != 0) {
+      return err;
+    }
+    if ((err = hal_pin_float_newf(HAL_OUT, &(data->tl_pos), comp_id, "%s.%d.enc.%d.ch%d-tl-pos", dname, pidx, midx, i)) != 0) {
+      return err;
+    }
+    if ((err = hal_pin_float_newf(HAL_OUT, &(data->tl_vel), comp_id, "%s.%d.enc.%d.ch%d-tl-velo", dname, pidx, midx, i)) != 0) {
+      return err;
+    }
+    if ((err = hal_pin_float_newf(HAL_OUT, &(data->tl_acc), comp_id, "%s.%d.enc.%d.ch%d-tl-acc", dname, pidx, midx, i)) != 0) {
+      return err;
+    }
 
     // set default pin values
     *(data->raw_counts) = 0;
@@ -142,6 +205,13 @@ int mdsio_enc_export_pins(mdsio_mod_t *module) {
     *(data->pos) = 0.0;
     *(data->vel) = 0.0;
     *(data->pos_scale) = 1.0;
+    *(data->tl_bw) = 0.0;
+    *(data->tl_lead) = 0.0;
+    *(data->tl_pos) = 0.0;
+    *(data->tl_vel) = 0.0;
+    *(data->tl_acc) = 0.0;
+    *(data->probe_ena) = 0;
+    *(data->probe_pos) = 0.0;
 
     // init other fields
     data->do_init = 1;
@@ -152,137 +222,299 @@ int mdsio_enc_export_pins(mdsio_mod_t *module) {
     data->old_scale = *(data->pos_scale) + 1.0;
     data->scale = 1.0;
     data->counts_since_timeout = 0;
+    data->tl_valid = 0;
   }
 
   return 0;
 }
 
-void mdsio_enc_read(mdsio_mod_t *mod, long period, uint32_t *data) {
-  mdsio_enc_data_t *module_data = mod->hal_data;
-  mdsio_port_t *port= mod->port;
-  mdsio_dev_t *device= port->device;
-  mdsio_enc_channel_data_t *hal_data;
-  int i, word;
-  uint32_t timeout;
-  uint32_t timebase, timestamp, delta_time;
-  int32_t raw_count, idx_count, delta_counts;
-  uint32_t cnt_flag, idx_flag;
-  double vel, interp;
+// velocity timeout in timer clocks, rebuilt on param change only
+static inline uint32_t mdsio_enc_timeout(mdsio_enc_data_t *module_data, mdsio_dev_t *device) {
+  if (MDSIO_CHANGED(module_data->old_timeout, module_data->timeout)) {
+    module_data->timeout_cnt = (uint32_t)((double)(device->osc_freq) * module_data->timeout);
+  }
+  return module_data->timeout_cnt;
+}
 
-  // read timebase
-  word = 0;
-  timebase = data[word++];
+// position of a latched index/probe edge relative to its latched count,
+// from the last count edge and the velocity in counts/sec.
+static double mdsio_enc_latch_frac(double osc_period, int32_t raw_count, uint32_t timestamp, int32_t latch_count,
+  uint32_t latch_ts, double vel) {
 
-  // calculate timeout
-  timeout = (uint32_t)((double)(device->osc_freq) * module_data->timeout);
-  
-  for (i=0; i<MDSIO_ENC_CHANNELS; i++) {
-    hal_data = &(module_data->channels[i]);
+  double frac;
 
-    // check for change in scale value
-    if (*(hal_data->pos_scale) != hal_data->old_scale) {
-      // scale value has changed, test and update it
-      if ((*(hal_data->pos_scale) < 1e-20) && (*(hal_data->pos_scale) > -1e-20)) {
-        // value too small, divide by zero is a bad thing
-        *(hal_data->pos_scale) = 1.0;
-      }
-      // save new scale to detect future changes
-      hal_data->old_scale = *(hal_data->pos_scale);
-      // we actually want the reciprocal
-      hal_data->scale = 1.0 / *(hal_data->pos_scale);
+  frac = (double)(raw_count - latch_count) - vel * (double)(int32_t)(timestamp - latch_ts) * osc_period;
+
+  // the edge lies within one count of the latched value
+  if (frac > 1.0) {
+    return 1.0;
+  }
+  if (frac < -1.0) {
+    return -1.0;
+  }
+  return frac;
+}
+
+// optional tracking loop, a third order observer on the raw count.
+// the count is exact at the timestamp of its last edge.
+static void mdsio_enc_track(mdsio_enc_channel_data_t *chan, double osc_period, int32_t raw_count, uint32_t timestamp,
+  uint32_t timebase, int cnt_flag, double index_pos, double scale) {
+
+  double w, dt, age, err, lead, pos;
+
+  w = *(chan->tl_bw) * 2.0 * M_PI;
+  if (w <= 0.0) {
+    chan->tl_valid = 0;
+    return;
+  }
+
+  if (!chan->tl_valid) {
+    chan->tl_valid = 1;
+    chan->tl_p = raw_count;
+    chan->tl_v = 0.0;
+    chan->tl_a = 0.0;
+    chan->tl_timebase = timebase;
+  }
+
+  // predict to this sample
+  dt = (double)(int32_t)(timebase - chan->tl_timebase) * osc_period;
+  chan->tl_timebase = timebase;
+  if (dt > 0.0) {
+    chan->tl_p += chan->tl_v * dt + 0.5 * chan->tl_a * dt * dt;
+    chan->tl_v += chan->tl_a * dt;
+
+    // measurement error, against the last edge while it is recent,
+    // else against the count, which lets the loop settle at rest
+    age = (double)(int32_t)(timebase - timestamp) * osc_period;
+    if (cnt_flag || age * w < 1.0) {
+      err = raw_count - (chan->tl_p - chan->tl_v * age + 0.5 * chan->tl_a * age * age);
+    } else {
+      err = raw_count - chan->tl_p;
     }
 
-    // read hw data
-    cnt_flag = data[word++];
-    timestamp = data[word++];
-    idx_flag = data[word++];
-
-    // expand counter width to 32 bit
-    raw_count = hal_data->exp_count + ((((int32_t)(cnt_flag << 1)) - (hal_data->exp_count << 1)) >> 1);
-    idx_count = hal_data->exp_count + ((((int32_t)(idx_flag << 1)) - (hal_data->exp_count << 1)) >> 1);
-    hal_data->exp_count = raw_count;    
-
-    // get flags
-    cnt_flag = cnt_flag  >> 31;
-    idx_flag = cnt_flag  >> 31;
-
-    // update raw count
-    *(hal_data->raw_counts) = raw_count;
-
-    // handle initialization
-    if (hal_data->do_init || *(hal_data->reset)) {
-      hal_data->do_init = 0;
-      hal_data->raw_count = raw_count;
-      hal_data->index_count = raw_count;
-      cnt_flag = 0;
-      idx_flag = 0;
+    // correct with critically damped gains, bandwidth limited to the sample rate
+    if (w * dt > MDSIO_ENC_TL_MAX_WDT) {
+      w = MDSIO_ENC_TL_MAX_WDT / dt;
     }
+    chan->tl_p += 3.0 * w * err * dt;
+    chan->tl_v += 3.0 * w * w * err * dt;
+    chan->tl_a += w * w * w * err * dt;
+  }
+
+  // latency compensated outputs
+  lead = *(chan->tl_lead);
+  pos = chan->tl_p + chan->tl_v * lead + 0.5 * chan->tl_a * lead * lead;
+  *(chan->tl_pos) = (pos - index_pos) * scale;
+  *(chan->tl_vel) = (chan->tl_v + chan->tl_a * lead) * scale;
+  *(chan->tl_acc) = chan->tl_a * scale;
+}
+
+// decode one channel from its register block
+static void mdsio_enc_read_chan(mdsio_enc_data_t *module_data, mdsio_enc_channel_data_t *hal_data,
+  uint32_t timebase, uint32_t timeout, uint32_t *data) {
 
-    // handle index
-    if (idx_flag && *(hal_data->index_ena)) {
-      hal_data->index_count = idx_count;
-      *(hal_data->index_ena) = 0;
+  uint32_t timestamp, idx_ts, prb_ts, delta_time;
+  int32_t raw_count, idx_count, prb_count, delta_counts;
+  uint32_t cnt_flag, idx_flag, prb_flag;
+  double vel, interp;
+
+  // check for change in scale value
+  if (*(hal_data->pos_scale) != hal_data->old_scale) {
+    // scale value has changed, test and update it
+    if ((*(hal_data->pos_scale) < 1e-20) && (*(hal_data->pos_scale) > -1e-20)) {
+      // value too small, divide by zero is a bad thing
+      *(hal_data->pos_scale) = 1.0;
     }
+    // save new scale to detect future changes
+    hal_data->old_scale = *(hal_data->pos_scale);
+    // we actually want the reciprocal
+    hal_data->scale = 1.0 / *(hal_data->pos_scale);
+  }
 
-    // calculate vel
-    if (cnt_flag) {
-      // one or more counts in the last period
-      delta_counts = raw_count - hal_data->raw_count;
-      delta_time = timestamp - hal_data->timestamp;
-      hal_data->raw_count = raw_count;
-      hal_data->timestamp = timestamp;
-      if (hal_data->counts_since_timeout < 2) {
-        hal_data->counts_since_timeout++;
-      } else {
-        vel = (delta_counts * hal_data->scale) / ((double)delta_time / (double)(device->osc_freq));
-        *(hal_data->vel) = vel;
-      }
+  // read hw data
+  cnt_flag = data[0];
+  timestamp = data[1];
+  idx_flag = data[2];
+  idx_ts = data[3];
+  prb_flag = data[4];
+  prb_ts = data[5];
+
+  // expand counter width to 32 bit
+  raw_count = hal_data->exp_count + ((((int32_t)(cnt_flag << 1)) - (hal_data->exp_count << 1)) >> 1);
+  idx_count = hal_data->exp_count + ((((int32_t)(idx_flag << 1)) - (hal_data->exp_count << 1)) >> 1);
+  prb_count = hal_data->exp_count + ((((int32_t)(prb_flag << 1)) - (hal_data->exp_count << 1)) >> 1);
+  hal_data->exp_count = raw_count;
+
+  // get flags
+  cnt_flag = cnt_flag >> 31;
+  idx_flag = idx_flag >> 31;
+  prb_flag = prb_flag >> 31;
+
+  // the hw drops the index/probe latch once the arm bit is cleared
+  if (!idx_flag) {
+    hal_data->idx_wait = 0;
+  }
+  if (!prb_flag) {
+    hal_data->probe_wait = 0;
+  }
+
+  // update raw count
+  *(hal_data->raw_counts) = raw_count;
+
+  // handle initialization
+  if (hal_data->do_init || *(hal_data->reset)) {
+    hal_data->do_init = 0;
+    hal_data->raw_count = raw_count;
+    hal_data->index_count = raw_count;
+    hal_data->index_frac = 0.0;
+    cnt_flag = 0;
+    idx_flag = 0;
+    prb_flag = 0;
+  }
+
+  // handle board reset, keep count and position continuous
+  if (hal_data->resync) {
+    hal_data->resync = 0;
+    hal_data->index_count += raw_count - hal_data->raw_count;
+    hal_data->raw_count = raw_count;
+    hal_data->timestamp = timestamp;
+    hal_data->counts_since_timeout = 0;
+    cnt_flag = 0;
+    idx_flag = 0;
+    prb_flag = 0;
+  }
+
+  // calculate vel
+  if (cnt_flag) {
+    // one or more counts in the last period
+    delta_counts = raw_count - hal_data->raw_count;
+    delta_time = timestamp - hal_data->timestamp;
+    hal_data->raw_count = raw_count;
+    hal_data->timestamp = timestamp;
+    if (hal_data->counts_since_timeout < 2) {
+      hal_data->counts_since_timeout++;
     } else {
-      // no count
-      if (hal_data->counts_since_timeout) {
-        // calc time since last count
-        delta_time = timebase - hal_data->timestamp;
-        if (delta_time < timeout) {
-          // not to long, estimate vel if a count arrived now
-          vel = (hal_data->scale) / ((double)delta_time / (double)(device->osc_freq));
-          // make vel positive, even if scale is negative
-          if (vel < 0.0) {
-            vel = -vel;
-          }
-          // use lesser of estimate and previous value
-          // use sign of previous value, magnitude of estimate
-          if (vel < *(hal_data->vel)) {
-            *(hal_data->vel) = vel;
-          }
-          if (-vel > *(hal_data->vel)) {
-            *(hal_data->vel) = -vel;
-          }
-        } else {
-          // its been a long time, stop estimating
-          hal_data->counts_since_timeout = 0;
-          *(hal_data->vel) = 0;
+      vel = (delta_counts * hal_data->scale) / ((double)delta_time * module_data->osc_period);
+      *(hal_data->vel) = vel;
+    }
+  } else {
+    // no count
+    if (hal_data->counts_since_timeout) {
+      // calc time since last count
+      delta_time = timebase - hal_data->timestamp;
+      if (delta_time < timeout) {
+        // not to long, estimate vel if a count arrived now
+        vel = (hal_data->scale) / ((double)delta_time * module_data->osc_period);
+        // make vel positive, even if scale is negative
+        if (vel < 0.0) {
+          vel = -vel;
+        }
+        // use lesser of estimate and previous value
+        // use sign of previous value, magnitude of estimate
+        if (vel < *(hal_data->vel)) {
+          *(hal_data->vel) = vel;
+        }
+        if (-vel > *(hal_data->vel)) {
+          *(hal_data->vel) = -vel;
         }
       } else {
-        // we already stopped estimating
+        // its been a long time, stop estimating
+        hal_data->counts_since_timeout = 0;
         *(hal_data->vel) = 0;
       }
+    } else {
+      // we already stopped estimating
+      *(hal_data->vel) = 0;
     }
+  }
 
-    // compute net counts
-    *(hal_data->count) = hal_data->raw_count - hal_data->index_count;
+  // handle index, interpolate the edge with the current velocity
+  if (idx_flag && *(hal_data->index_ena) && !hal_data->idx_wait) {
+    hal_data->index_count = idx_count;
+    hal_data->index_frac = mdsio_enc_latch_frac(module_data->osc_period, hal_data->raw_count,
+      hal_data->timestamp, idx_count, idx_ts, *(hal_data->vel) * *(hal_data->pos_scale));
+    hal_data->idx_wait = 1;
+    *(hal_data->index_ena) = 0;
+  }
+
+  // handle probe, interpolated like the index
+  if (prb_flag && *(hal_data->probe_ena) && !hal_data->probe_wait) {
+    *(hal_data->probe_pos) = ((double)(prb_count - hal_data->index_count) - hal_data->index_frac
+      + mdsio_enc_latch_frac(module_data->osc_period, hal_data->raw_count, hal_data->timestamp, prb_count, prb_ts,
+      *(hal_data->vel) * *(hal_data->pos_scale))) * hal_data->scale;
+    hal_data->probe_wait = 1;
+    *(hal_data->probe_ena) = 0;
+  }
 
-    // scale count to make floating point position
-    *(hal_data->pos) = *(hal_data->count) * hal_data->scale;
+  // compute net counts
+  *(hal_data->count) = hal_data->raw_count - hal_data->index_count;
 
-    // add interpolation value
-    delta_time = timebase - hal_data->timestamp;
-    interp = *(hal_data->vel) * ((double)delta_time / (double)(device->osc_freq));
-    *(hal_data->pos_interp) = *(hal_data->pos) + interp;
+  // scale count to make floating point position
+  *(hal_data->pos) = *(hal_data->count) * hal_data->scale;
+
+  // add interpolation value
+  delta_time = timebase - hal_data->timestamp;
+  interp = *(hal_data->vel) * ((double)delta_time * module_data->osc_period);
+  *(hal_data->pos_interp) = *(hal_data->pos) + interp - hal_data->index_frac * hal_data->scale;
+
+  mdsio_enc_track(hal_data, module_data->osc_period, raw_count, timestamp, timebase, cnt_flag,
+    hal_data->index_count + hal_data->index_frac, hal_data->scale);
+}
+
+void mdsio_enc_read(mdsio_mod_t *mod, long period, uint32_t *data) {
+  mdsio_enc_data_t *module_data = mod->hal_data;
+  mdsio_port_t *port= mod->port;
+  mdsio_dev_t *device= port->device;
+  int i, word;
+  uint32_t timeout;
+  uint32_t timebase;
+
+  // read timebase
+  word = 0;
+  timebase = data[word++];
+
+  // get timeout
+  timeout = mdsio_enc_timeout(module_data, device);
+
+  for (i=0; i<mod->channels; i++, word+=MDSIO_ENC_CHAN_WORDS) {
+    mdsio_enc_read_chan(module_data, &(module_data->channels[i]), timebase, timeout, &data[word]);
   }
 }
 
 void mdsio_enc_write(mdsio_mod_t *mod, long period, uint32_t *data) {
-  // this module is input only
-  memset(data, 0, MDSIO_ENC_LEN);
+  mdsio_enc_data_t *module_data = mod->hal_data;
+  mdsio_enc_channel_data_t *hal_data;
+  uint32_t arm;
+  int i;
+
+  // arm the index/probe latch while its enable is set
+  arm = 0;
+  for (i=0; i<mod->channels; i++) {
+    hal_data = &(module_data->channels[i]);
+    if (*(hal_data->index_ena) && !hal_data->idx_wait) {
+      arm |= MDSIO_ENC_ARM_IDX(i);
+    }
+    if (*(hal_data->probe_ena) && !hal_data->probe_wait) {
+      arm |= MDSIO_ENC_ARM_PRB(i);
+    }
+  }
+  data[0] = arm;
+}
+
+static void mdsio_enc_resync_chan(mdsio_enc_channel_data_t *hal_data) {
+  hal_data->exp_count = 0;
+  hal_data->resync = 1;
+  hal_data->idx_wait = 0;
+  hal_data->probe_wait = 0;
+  hal_data->tl_valid = 0;
 }
 
+void mdsio_enc_resync(mdsio_mod_t *mod) {
+  mdsio_enc_data_t *module_data = mod->hal_data;
+  int i;
+
+  // hardware counters restarted from zero
+  for (i=0; i<mod->channels; i++) {
+    mdsio_enc_resync_chan(&(module_data->channels[i]));
+  }
+}
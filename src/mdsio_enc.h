@@ -21,10 +21,27 @@
 #include "mdsio.h"
 
 #define MDSIO_ENC_TYPE 4
-#define MDSIO_ENC_LEN 28
+#define MDSIO_ENC_VERSION 1
 
+// default and max channel count, limited by the module mask
 #define MDSIO_ENC_CHANNELS 2
+#define MDSIO_ENC_MAX_CHANNELS 10
+
+// timebase word, then per channel: count, timestamp, index count,
+// index timestamp, probe count, probe timestamp
+#define MDSIO_ENC_CHAN_WORDS 6
+#define MDSIO_ENC_LEN(channels) ((1 + MDSIO_ENC_CHAN_WORDS * (channels)) << 2)
+
+// arm bits in the timebase word
+#define MDSIO_ENC_ARM_IDX(chan) (1 << (chan))
+#define MDSIO_ENC_ARM_PRB(chan) (1 << (16 + (chan)))
+
+// tracking loop, max bandwidth against the sample period (w * dt)
+#define MDSIO_ENC_TL_MAX_WDT 0.3
 
 int mdsio_enc_init(mdsio_mod_t *module);
+void mdsio_enc_read(mdsio_mod_t *mod, long period, uint32_t *data);
+void mdsio_enc_write(mdsio_mod_t *mod, long period, uint32_t *data);
+void mdsio_enc_resync(mdsio_mod_t *mod);
 
 #endif
@@ -0,0 +1,347 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+#include "rtapi.h"
+#include "rtapi_string.h"
+#include "rtapi_math.h"
+
+#include "hal.h"
+
+#include "mdsio.h"
+#include "mdsio_img.h"
+
+static int mdsio_img_index = 0;
+
+typedef struct {
+  hal_bit_t *global_latch;
+  hal_bit_t *latched;
+  hal_u32_t *seq;
+  hal_u32_t *timestamp;
+  hal_u32_t *seq_errors;
+  hal_bit_t *pace;
+  hal_float_t *pace_lead;
+  hal_u32_t *pace_period;
+  hal_float_t *pace_phase;
+  hal_float_t *pace_wait;
+  hal_bit_t *pace_locked;
+  hal_bit_t *pace_late;
+  hal_u32_t *pace_late_count;
+  uint16_t last_seq;
+  int seq_valid;
+  int32_t phase;
+  int phase_valid;
+  double trim;
+} mdsio_img_data_t;
+
+int mdsio_img_export_pins(mdsio_mod_t *module);
+static void mdsio_img_pace(mdsio_mod_t *mod, long period, uint32_t *data);
+
+int mdsio_img_init(mdsio_mod_t *module) {
+  mdsio_port_t *port= module->port;
+  mdsio_dev_t *device= port->device;
+  mdsio_img_data_t *hal_data;
+  int word = module->data_offset >> 2;
+  uint32_t ctrl, src, base;
+
+  if (mdsio_mod_channels(module, "img", MDSIO_IMG_VERSION, 1, 1) != 0) {
+    return -EINVAL;
+  }
+
+  // initialize module
+  module->index = mdsio_img_index;
+  module->data_len = MDSIO_IMG_LEN;
+  module->rd_mask = 0;
+  module->wr_mask = 0;
+  module->proc_read = mdsio_img_read;
+  module->proc_write = mdsio_img_write;
+  module->proc_resync = mdsio_img_resync;
+  mdsio_img_index++;
+
+  if (port->img_len != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.img.%d: ERROR: port already has a process image\n", device->name, port->index, module->index);
+    return -EINVAL;
+  }
+
+  // read image layout
+  ctrl = device->proc_read_conf(port, word + MDSIO_IMG_CTRL);
+  src = device->proc_read_conf(port, word + MDSIO_IMG_SRC);
+  base = device->proc_read_conf(port, word + MDSIO_IMG_BASE);
+
+  port->img_ctrl = module->data_offset + (MDSIO_IMG_CTRL << 2);
+  port->img_src = src & 0xffff;
+  port->img_len = (src >> 16) & 0xffff;
+  port->img_offset = base & 0xffff;
+  port->img_dma = 0;
+  if (ctrl & MDSIO_IMG_STAT_DMA) {
+    port->img_dma = module->data_offset + (MDSIO_IMG_DMA << 2);
+  }
+  port->img_trig = MDSIO_IMG_CTRL_TRIG | MDSIO_IMG_CTRL_LATCH;
+  port->img_ts = 0;
+  port->img_trailer = 0;
+  port->img_time = module->data_offset + (MDSIO_IMG_TIME << 2);
+  port->img_pace = 0;
+  port->img_arrival = 0;
+  port->img_next = 0;
+  port->img_tick_scale = 0;
+  port->img_due = 0;
+  port->img_wait = 0;
+  port->img_timeout = 0;
+  port->img_late = 0;
+
+  // snapshot timer, the period is written with the outputs
+  module->wr_mask = MDSIO_MASK_RANGE(MDSIO_IMG_PERIOD, 1);
+
+  if ((hal_data = hal_malloc(sizeof(mdsio_img_data_t))) == 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.img.%d: ERROR: hal_malloc() failed\n", device->name, port->index, module->index);
+    return -EIO;
+  }
+  memset(hal_data, 0, sizeof(mdsio_img_data_t));
+  module->hal_data = hal_data;
+
+  // register pins
+  if (mdsio_img_export_pins(module) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.img.%d: ERROR: export_pins() failed\n", device->name, port->index, module->index);
+    return -EIO;
+  }
+
+  rtapi_print_msg(RTAPI_MSG_INFO, "%s.%d.img.%d: process image of %d bytes at offset %d mirrors offset %d%s.\n",
+    device->name, port->index, module->index, port->img_len, port->img_offset, port->img_src,
+    port->img_dma ? ", dma capable" : "");
+
+  return 0;
+}
+
+int mdsio_img_export_pins(mdsio_mod_t *module) {
+  mdsio_port_t *port= module->port;
+  mdsio_dev_t *device= port->device;
+  mdsio_img_data_t *data = module->hal_data;
+  const char *dname = device->name;
+  int comp_id = device->comp_id;
+  int pidx = port->index;
+  int midx = module->index;
+  int err;
+
+  if ((err = hal_pin_bit_newf(HAL_IN, &(data->global_latch), comp_id, "%s.%d.img.%d.global-latch", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_bit_newf(HAL_OUT, &(data->latched), comp_id, "%s.%d.img.%d.latched", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(data->seq), comp_id, "%s.%d.img.%d.seq", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(data->timestamp), comp_id, "%s.%d.img.%d.timestamp", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(data->seq_errors), comp_id, "%s.%d.img.%d.seq-errors", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_bit_newf(HAL_IN, &(data->pace), comp_id, "%s.%d.img.%d.pace", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_float_newf(HAL_IN, &(data->pace_lead), comp_id, "%s.%d.img.%d.pace-lead", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(data->pace_period), comp_id, "%s.%d.img.%d.pace-period", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_float_newf(HAL_OUT, &(data->pace_phase), comp_id, "%s.%d.img.%d.pace-phase", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_float_newf(HAL_OUT, &(data->pace_wait), comp_id, "%s.%d.img.%d.pace-wait", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_bit_newf(HAL_OUT, &(data->pace_locked), comp_id, "%s.%d.img.%d.pace-locked", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_bit_newf(HAL_OUT, &(data->pace_late), comp_id, "%s.%d.img.%d.pace-late", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(data->pace_late_count), comp_id, "%s.%d.img.%d.pace-late-count", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
+  // initialize data
+  *(data->global_latch) = 1;
+  *(data->latched) = 0;
+  *(data->seq) = 0;
+  *(data->timestamp) = 0;
+  *(data->seq_errors) = 0;
+  *(data->pace) = 0;
+  *(data->pace_lead) = MDSIO_IMG_PACE_LEAD;
+  *(data->pace_period) = 0;
+  *(data->pace_phase) = 0.0;
+  *(data->pace_wait) = 0.0;
+  *(data->pace_locked) = 0;
+  *(data->pace_late) = 0;
+  *(data->pace_late_count) = 0;
+
+  data->last_seq = 0;
+  data->seq_valid = 0;
+  data->phase = 0;
+  data->phase_valid = 0;
+  data->trim = 0.0;
+
+  return 0;
+}
+
+void mdsio_img_read(mdsio_mod_t *mod, long period, uint32_t *data) {
+  mdsio_port_t *port = mod->port;
+  mdsio_img_data_t *hal_data = mod->hal_data;
+  double osc_freq = (double)port->device->osc_freq;
+  uint16_t seq;
+  int fresh;
+
+  // the image is fetched by the device backend, only the stamp is checked here
+  if (port->img_len == 0) {
+    return;
+  }
+
+  // one snapshot per cycle, anything else means stale or skipped inputs
+  seq = MDSIO_IMG_TRAILER_SEQ(port->img_trailer);
+  fresh = !hal_data->seq_valid || seq != hal_data->last_seq;
+  if (hal_data->seq_valid && seq != (uint16_t)(hal_data->last_seq + 1)) {
+    (*(hal_data->seq_errors))++;
+  }
+  hal_data->last_seq = seq;
+  hal_data->seq_valid = 1;
+
+  // host arrival against the snapshot we got, negative while the host is ahead
+  hal_data->phase_valid = 0;
+  if (port->img_pace && fresh) {
+    hal_data->phase = (int32_t)(port->img_arrival - port->img_ts);
+    hal_data->phase_valid = 1;
+    *(hal_data->pace_phase) = (double)hal_data->phase / osc_freq;
+  }
+  *(hal_data->pace_wait) = (double)port->img_wait * 1e-9;
+
+  // the timer snapshot did not come in time, the backend took one itself
+  *(hal_data->pace_late) = port->img_late;
+  if (port->img_late) {
+    (*(hal_data->pace_late_count))++;
+  }
+
+  *(hal_data->seq) = seq;
+  *(hal_data->timestamp) = port->img_ts;
+  *(hal_data->latched) = (port->img_trailer & MDSIO_IMG_TRAILER_LATCHED) != 0;
+}
+
+void mdsio_img_write(mdsio_mod_t *mod, long period, uint32_t *data) {
+  mdsio_port_t *port = mod->port;
+  mdsio_img_data_t *hal_data = mod->hal_data;
+
+  // ctrl word for the next snapshot request
+  port->img_trig = MDSIO_IMG_CTRL_TRIG;
+  if (*(hal_data->global_latch)) {
+    port->img_trig |= MDSIO_IMG_CTRL_LATCH;
+  }
+
+  mdsio_img_pace(mod, period, data);
+}
+
+// paced mode: the board timer triggers the snapshots and the read waits
+// for them. the timer period is trimmed every cycle, so the snapshot
+// is done pace-lead before the host thread arrives and both clocks
+// never beat. the lead is the margin for the host jitter, a host
+// that comes earlier still waits for the snapshot.
+static void mdsio_img_pace(mdsio_mod_t *mod, long period, uint32_t *data) {
+  mdsio_port_t *port = mod->port;
+  mdsio_img_data_t *hal_data = mod->hal_data;
+  double osc_freq = (double)port->device->osc_freq;
+  double nominal, lead, err, limit;
+  int32_t per;
+
+  if (!*(hal_data->pace) || period <= 0 || port->img_len == 0) {
+    data[MDSIO_IMG_PERIOD] = 0;
+    port->img_pace = 0;
+    hal_data->trim = 0.0;
+    *(hal_data->pace_period) = 0;
+    *(hal_data->pace_locked) = 0;
+    return;
+  }
+
+  nominal = (double)period * osc_freq * 1e-9;
+  lead = *(hal_data->pace_lead) * osc_freq;
+  limit = nominal / (1 << MDSIO_IMG_PACE_TRIM_SHIFT);
+
+  // phase error, wrapped to the nearest snapshot
+  err = 0.0;
+  if (hal_data->phase_valid) {
+    err = (double)hal_data->phase - lead;
+    while (err > nominal * 0.5) {
+      err -= nominal;
+    }
+    while (err < -nominal * 0.5) {
+      err += nominal;
+    }
+  }
+
+  // a late host means an early snapshot, stretch the period.
+  // the integral takes up the offset between both clocks.
+  hal_data->trim += err * MDSIO_IMG_PACE_KI;
+  if (hal_data->trim > limit) {
+    hal_data->trim = limit;
+  }
+  if (hal_data->trim < -limit) {
+    hal_data->trim = -limit;
+  }
+  err *= MDSIO_IMG_PACE_KP;
+  if (err > limit) {
+    err = limit;
+  }
+  if (err < -limit) {
+    err = -limit;
+  }
+  per = (int32_t)(nominal + hal_data->trim + err + 0.5);
+
+  data[MDSIO_IMG_PERIOD] = per;
+  port->img_pace = 1;
+  port->img_timeout = period >> MDSIO_IMG_PACE_WAIT_SHIFT;
+
+  // board time the next snapshot is due, unknown without a timer snapshot
+  // in this cycle. the backends poll from shortly before it.
+  port->img_next = port->img_ts;
+  if (hal_data->phase_valid && !port->img_late) {
+    port->img_next += per;
+  }
+  port->img_tick_scale = (long)(65536e9 / osc_freq);
+
+  *(hal_data->pace_period) = per;
+  *(hal_data->pace_locked) = hal_data->phase_valid && fabs((double)hal_data->phase - lead) < lead * 0.5;
+}
+
+void mdsio_img_resync(mdsio_mod_t *mod) {
+  mdsio_img_data_t *hal_data = mod->hal_data;
+
+  // board restarted the sequence number and its timer
+  hal_data->seq_valid = 0;
+  hal_data->phase_valid = 0;
+}
+
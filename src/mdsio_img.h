@@ -0,0 +1,83 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+#ifndef _MDSIO_IMG_H_
+#define _MDSIO_IMG_H_
+
+#include "mdsio.h"
+
+#define MDSIO_IMG_TYPE 7
+#define MDSIO_IMG_VERSION 1
+#define MDSIO_IMG_LEN 32
+
+#define MDSIO_IMG_CTRL 0
+#define MDSIO_IMG_SRC  1
+#define MDSIO_IMG_TS   2
+#define MDSIO_IMG_BASE 3
+#define MDSIO_IMG_DMA  4
+#define MDSIO_IMG_PERIOD 5
+#define MDSIO_IMG_TIME 7
+
+// write: trigger snapshot / push image to host memory / latch all inputs with the snapshot
+#define MDSIO_IMG_CTRL_TRIG  (1 << 0)
+#define MDSIO_IMG_CTRL_DMA   (1 << 1)
+#define MDSIO_IMG_CTRL_LATCH (1 << 2)
+
+// read: snapshot busy / dma capable / dma master abort / latch capable / snapshot timer capable
+#define MDSIO_IMG_STAT_BUSY    (1 << 0)
+#define MDSIO_IMG_STAT_DMA     (1 << 1)
+#define MDSIO_IMG_STAT_DMA_ERR (1 << 2)
+#define MDSIO_IMG_STAT_LATCH   (1 << 3)
+#define MDSIO_IMG_STAT_TIMER   (1 << 4)
+#define MDSIO_IMG_STAT_SEQ(c)  (((c) >> 16) & 0xffff)
+
+// paced mode: default lead of the snapshot ahead of the host (s),
+// loop gains of the period trim, the limit of the trim and the
+// longest wait for a snapshot, both as a fraction of the period
+#define MDSIO_IMG_PACE_LEAD 20e-6
+#define MDSIO_IMG_PACE_KP 0.25
+#define MDSIO_IMG_PACE_KI 0.02
+#define MDSIO_IMG_PACE_TRIM_SHIFT 3
+#define MDSIO_IMG_PACE_WAIT_SHIFT 3
+
+// paced mode: the backends poll for the snapshot from this long (ns)
+// before it is due and at this interval
+#define MDSIO_IMG_PACE_POLL_MARGIN 2000
+#define MDSIO_IMG_PACE_POLL_INTERVAL 500
+
+// snapshot time and trailer behind the image
+#define MDSIO_IMG_STAMP_LEN 8
+#define MDSIO_IMG_TRAILER_LATCHED (1 << 0)
+#define MDSIO_IMG_TRAILER_SEQ(t) (((t) >> 16) & 0xffff)
+
+int mdsio_img_init(mdsio_mod_t *module);
+void mdsio_img_read(mdsio_mod_t *mod, long period, uint32_t *data);
+void mdsio_img_write(mdsio_mod_t *mod, long period, uint32_t *data);
+void mdsio_img_resync(mdsio_mod_t *mod);
+
+// host time the next timer snapshot is due, now is the host time
+// the board time img_arrival was read at
+static inline long long mdsio_img_due(mdsio_port_t *port, long long now) {
+  int32_t ticks = (int32_t)(port->img_next - port->img_arrival);
+
+  if (ticks <= 0) {
+    return now;
+  }
+  return now + (((long long)ticks * port->img_tick_scale) >> 16);
+}
+
+#endif
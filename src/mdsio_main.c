@@ -23,21 +23,37 @@
 #include "hal.h"
 
 #include "mdsio.h"
+#include "mdsio_prof.h"
 
+#include "mdsio_bmon.h"
 #include "mdsio_dac.h"
 #include "mdsio_dio.h"
 #include "mdsio_enc.h"
+#include "mdsio_img.h"
 #include "mdsio_phpe.h"
 #include "mdsio_step.h"
 #include "mdsio_wdt.h"
 
 void mdsio_read_all(void *arg, long period);
+void mdsio_request_all(void *arg, long period);
+void mdsio_collect_all(void *arg, long period);
 void mdsio_write_all(void *arg, long period);
 
 void mdsio_read_port(void *arg, long period);
+void mdsio_request_port(void *arg, long period);
+void mdsio_collect_port(void *arg, long period);
+void mdsio_fetch_port(mdsio_port_t *port);
+void mdsio_decode_port(mdsio_port_t *port, long period);
+void mdsio_encode_port(mdsio_port_t *port, long period);
 void mdsio_write_port(void *arg, long period);
 
-mdsio_mod_t *mdsio_add_module(mdsio_port_t *port, uint16_t type, uint16_t offset);
+int mdsio_build_plan(mdsio_port_t *port, int write, mdsio_span_t **spans);
+int mdsio_build_force(mdsio_port_t *port);
+void mdsio_check_image(mdsio_port_t *port);
+int mdsio_build_dispatch(mdsio_port_t *port);
+void mdsio_update_dirty(mdsio_port_t *port);
+
+mdsio_mod_t *mdsio_add_module(mdsio_port_t *port, uint32_t conf_val);
 void mdsio_remove_modules(mdsio_port_t *port);
 void mdsio_remove_module(mdsio_mod_t *module);
 
@@ -64,6 +80,20 @@ int mdsio_init(mdsio_dev_t *device) {
     return -EIO;
   }
 
+  // export read request function
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.read-request-all", device->name);
+  if (hal_export_funct(name, mdsio_request_all, device, 0, 0, device->comp_id) != 0) {
+    rtapi_print_msg (RTAPI_MSG_ERR, "%s: ERROR: read-request-all funct export failed\n", device->name);
+    return -EIO;
+  }
+
+  // export read collect function
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.read-collect-all", device->name);
+  if (hal_export_funct(name, mdsio_collect_all, device, 0, 0, device->comp_id) != 0) {
+    rtapi_print_msg (RTAPI_MSG_ERR, "%s: ERROR: read-collect-all funct export failed\n", device->name);
+    return -EIO;
+  }
+
   // export write function
   rtapi_snprintf(name, HAL_NAME_LEN, "%s.write-all", device->name);
   if (hal_export_funct(name, mdsio_write_all, device, 0, 0, device->comp_id) != 0) {
@@ -71,6 +101,11 @@ int mdsio_init(mdsio_dev_t *device) {
     return -EIO;
   }
 
+  // export profiling pins
+  if (mdsio_prof_dev_init(device) < 0) {
+    return -EIO;
+  }
+
   return 0;
 }
 
@@ -84,21 +119,78 @@ void mdsio_exit(mdsio_dev_t *device) {
 }
 
 void mdsio_read_all(void *arg, long period) {
+  mdsio_dev_t *device = arg;
+  MDSIO_PROF_VAR(t)
+
+  // latch all boards before the first fetch
+  MDSIO_PROF_START(t);
+  mdsio_request_all(device, period);
+  mdsio_collect_all(device, period);
+  MDSIO_PROF_STOP(device->prof_read, t);
+}
+
+void mdsio_request_all(void *arg, long period) {
   mdsio_dev_t *device = arg;
   mdsio_port_t *port;
 
   for (port = device->first_port; port != NULL; port = port->next) {
-    mdsio_read_port(port, period);
+    mdsio_request_port(port, period);
+  }
+}
+
+void mdsio_collect_all(void *arg, long period) {
+  mdsio_dev_t *device = arg;
+  mdsio_port_t *port;
+  MDSIO_PROF_VAR(t)
+  MDSIO_PROF_VAR(tp)
+
+  // fetch all boards back to back, decode afterwards
+  MDSIO_PROF_START(t);
+  for (port = device->first_port; port != NULL; port = port->next) {
+    MDSIO_PROF_START(tp);
+    mdsio_fetch_port(port);
+    MDSIO_PROF_STOP(port->prof_read_bus, tp);
+  }
+  MDSIO_PROF_STOP(device->prof_read_bus, t);
+
+  MDSIO_PROF_START(t);
+  for (port = device->first_port; port != NULL; port = port->next) {
+    MDSIO_PROF_START(tp);
+    mdsio_decode_port(port, period);
+    MDSIO_PROF_STOP(port->prof_decode, tp);
   }
+  MDSIO_PROF_STOP(device->prof_decode, t);
 }
 
 void mdsio_write_all(void *arg, long period) {
   mdsio_dev_t *device = arg;
   mdsio_port_t *port;
+  MDSIO_PROF_VAR(t)
+  MDSIO_PROF_VAR(tb)
+  MDSIO_PROF_VAR(tp)
+
+  // encode all boards first, then emit the posted writes back to back and flush at the end
+  MDSIO_PROF_START(t);
+  for (port = device->first_port; port != NULL; port = port->next) {
+    MDSIO_PROF_START(tp);
+    mdsio_encode_port(port, period);
+    MDSIO_PROF_STOP(port->prof_encode, tp);
+  }
+  MDSIO_PROF_STOP(device->prof_encode, t);
 
+  MDSIO_PROF_START(tb);
   for (port = device->first_port; port != NULL; port = port->next) {
-    mdsio_write_port(port, period);
+    MDSIO_PROF_START(tp);
+    device->proc_write_output(port);
+    MDSIO_PROF_STOP(port->prof_write_bus, tp);
   }
+  if (device->proc_flush_output != NULL) {
+    for (port = device->first_port; port != NULL; port = port->next) {
+      device->proc_flush_output(port);
+    }
+  }
+  MDSIO_PROF_STOP(device->prof_write_bus, tb);
+  MDSIO_PROF_STOP(device->prof_write, t);
 }
 
 mdsio_port_t *mdsio_create_port(mdsio_dev_t *device, void *device_data) {
@@ -108,7 +200,7 @@ mdsio_port_t *mdsio_create_port(mdsio_dev_t *device, void *device_data) {
   uint32_t conf_val;
   mdsio_mod_t *module;
   uint16_t mod_type, mod_start, mod_end;
-  uint16_t mod_bot, mod_top;
+  uint16_t mod_bot, mod_top, conf_end;
   char name[HAL_NAME_LEN + 1];
 
   // allocate port data
@@ -131,16 +223,19 @@ mdsio_port_t *mdsio_create_port(mdsio_dev_t *device, void *device_data) {
     conf_val = device->proc_read_conf(port, i);
 
     // get type and start address
-    mod_type = conf_val & 0xffff;
-    mod_start = (conf_val >> 16) & 0xffff;
+    mod_type = MDSIO_CONF_TYPE(conf_val);
+    mod_start = MDSIO_CONF_OFFSET(conf_val);
 
     // type = 0 is EOL marker
     if (mod_type == 0) {
       break;
     }
 
+    // keep layout for resync after a board reset
+    port->conf[port->conf_count++] = conf_val;
+
     // add module
-    module = mdsio_add_module(port, mod_type, mod_start);
+    module = mdsio_add_module(port, conf_val);
     if (module == NULL) {
       continue;
     }
@@ -155,6 +250,14 @@ mdsio_port_t *mdsio_create_port(mdsio_dev_t *device, void *device_data) {
     }
   }
 
+  // the conf table and its eol word must not overlap the module
+  // registers, else live register data is parsed as conf words
+  conf_end = port->conf_count + ((port->conf_count < MDSIO_MAX_MODS_PER_PORT) ? 1 : 0);
+  if (mod_top > 0 && mod_bot < (conf_end << 2)) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: conf table overlaps module registers at 0x%04x\n", device->name, mod_bot);
+    goto fail1;
+  }
+
   // calculate offset and length of data range
   if (mod_top > 0 && mod_bot < mod_top) {
     port->data_offset = mod_bot;
@@ -167,24 +270,70 @@ mdsio_port_t *mdsio_create_port(mdsio_dev_t *device, void *device_data) {
     rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: Unable to allocate input memory\n", device->name);
     goto fail1;
   }
+  port->input_view = port->input_data;
+  port->input_requested = 0;
   port->output_data = rtapi_kzalloc(port->data_len, RTAPI_GFP_KERNEL);
   if (port->output_data == NULL) {
     rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: Unable to allocate output memory\n", device->name);
     goto fail2;
   }
+  port->output_shadow = rtapi_kzalloc(port->data_len, RTAPI_GFP_KERNEL);
+  if (port->output_shadow == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: Unable to allocate output shadow memory\n", device->name);
+    goto fail3;
+  }
+  port->output_valid = 0;
+
+  // build transfer plan
+  port->rd_span_count = mdsio_build_plan(port, 0, &port->rd_spans);
+  if (port->rd_span_count < 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: Unable to allocate read plan memory\n", device->name);
+    goto fail4;
+  }
+  port->wr_span_count = mdsio_build_plan(port, 1, &port->wr_spans);
+  if (port->wr_span_count < 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: Unable to allocate write plan memory\n", device->name);
+    goto fail5;
+  }
+  if (mdsio_build_force(port) < 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: Unable to allocate dirty tracking memory\n", device->name);
+    goto fail6;
+  }
+  mdsio_check_image(port);
+  if (mdsio_build_dispatch(port) < 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: Unable to allocate dispatch table memory\n", device->name);
+    goto fail7;
+  }
+  if (mdsio_prof_port_init(port) < 0) {
+    goto fail8;
+  }
 
   // export read function
   rtapi_snprintf(name, HAL_NAME_LEN, "%s.%d.read", device->name, port->index);
   if (hal_export_funct(name, mdsio_read_port, port, 0, 0, device->comp_id) != 0) {
     rtapi_print_msg (RTAPI_MSG_ERR, "%s: ERROR: read funct export for port %d failed\n", device->name, port->index);
-    goto fail2;
+    goto fail8;
+  }
+
+  // export read request function
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.%d.read-request", device->name, port->index);
+  if (hal_export_funct(name, mdsio_request_port, port, 0, 0, device->comp_id) != 0) {
+    rtapi_print_msg (RTAPI_MSG_ERR, "%s: ERROR: read-request funct export for port %d failed\n", device->name, port->index);
+    goto fail8;
+  }
+
+  // export read collect function
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.%d.read-collect", device->name, port->index);
+  if (hal_export_funct(name, mdsio_collect_port, port, 0, 0, device->comp_id) != 0) {
+    rtapi_print_msg (RTAPI_MSG_ERR, "%s: ERROR: read-collect funct export for port %d failed\n", device->name, port->index);
+    goto fail8;
   }
 
   // export write function
   rtapi_snprintf(name, HAL_NAME_LEN, "%s.%d.write", device->name, port->index);
   if (hal_export_funct(name, mdsio_write_port, port, 0, 0, device->comp_id) != 0) {
     rtapi_print_msg (RTAPI_MSG_ERR, "%s: ERROR: write funct export for port %d failed\n", device->name, port->index);
-    goto fail2;
+    goto fail8;
   }
 
   // add to list
@@ -193,6 +342,20 @@ mdsio_port_t *mdsio_create_port(mdsio_dev_t *device, void *device_data) {
 
   return port;
 
+fail8:
+  rtapi_kfree(port->disp);
+fail7:
+  rtapi_kfree(port->wr_dirty);
+  rtapi_kfree(port->wr_fence);
+  rtapi_kfree(port->wr_force);
+fail6:
+  rtapi_kfree(port->wr_spans);
+fail5:
+  rtapi_kfree(port->rd_spans);
+fail4:
+  rtapi_kfree(port->output_shadow);
+fail3:
+  rtapi_kfree(port->output_data);
 fail2:
   rtapi_kfree(port->input_data);
 fail1:
@@ -208,6 +371,13 @@ void mdsio_destroy_port(mdsio_port_t *port) {
   // remove from list
   MDSIO_LIST_REMOVE(device->first_port, device->last_port, port);
 
+  rtapi_kfree(port->disp);
+  rtapi_kfree(port->wr_dirty);
+  rtapi_kfree(port->wr_fence);
+  rtapi_kfree(port->wr_force);
+  rtapi_kfree(port->wr_spans);
+  rtapi_kfree(port->rd_spans);
+  rtapi_kfree(port->output_shadow);
   rtapi_kfree(port->output_data);
   rtapi_kfree(port->input_data);
   mdsio_remove_modules(port);
@@ -216,30 +386,393 @@ void mdsio_destroy_port(mdsio_port_t *port) {
   device->port_count--;
 }
 
+int mdsio_build_plan(mdsio_port_t *port, int write, mdsio_span_t **spans) {
+  mdsio_mod_t *module;
+  int words = port->data_len >> 2;
+  char *used;
+  uint64_t mask;
+  int i, base, count, used_words;
+  mdsio_span_t *span;
+
+  // mark all registers that have to be transferred
+  used = rtapi_kzalloc(words + 1, RTAPI_GFP_KERNEL);
+  if (used == NULL) {
+    return -ENOMEM;
+  }
+  for (module = port->first_module; module != NULL; module = module->next) {
+    mask = write ? module->wr_mask : module->rd_mask;
+    base = (module->data_offset - port->data_offset) >> 2;
+    for (i=0; i<(module->data_len >> 2) && i<MDSIO_MAX_MOD_WORDS; i++) {
+      if (mask & MDSIO_MASK(i)) {
+        used[base + i] = 1;
+      }
+    }
+  }
+
+  // count coalesced spans
+  count = 0;
+  used_words = 0;
+  for (i=0; i<words; i++) {
+    if (used[i]) {
+      used_words++;
+      if (i == 0 || !used[i - 1]) {
+        count++;
+      }
+    }
+  }
+
+  // build span list in ascending address order, this keeps
+  // the capture registers in front of the captured data
+  *spans = rtapi_kzalloc(sizeof(mdsio_span_t) * (count + 1), RTAPI_GFP_KERNEL);
+  if (*spans == NULL) {
+    rtapi_kfree(used);
+    return -ENOMEM;
+  }
+  span = NULL;
+  for (i=0, count=0; i<words; i++) {
+    if (!used[i]) {
+      continue;
+    }
+    if (i == 0 || !used[i - 1]) {
+      span = &((*spans)[count++]);
+      span->offset = i << 2;
+      span->len = 0;
+    }
+    span->len += 4;
+  }
+
+  rtapi_kfree(used);
+
+  rtapi_print_msg(RTAPI_MSG_INFO, "%s: port %d %s plan: %d of %d dwords in %d spans.\n",
+    port->device->name, port->index, write ? "write" : "read", used_words, words, count);
+  return count;
+}
+
+int mdsio_build_force(mdsio_port_t *port) {
+  mdsio_mod_t *module;
+  int words = port->data_len >> 2;
+
+  // mark registers that have to be written every cycle, and those
+  // that must not reach the board ahead of the writes before them
+  port->wr_force = rtapi_kzalloc(words + 1, RTAPI_GFP_KERNEL);
+  if (port->wr_force == NULL) {
+    return -ENOMEM;
+  }
+  port->wr_fence = rtapi_kzalloc(words + 1, RTAPI_GFP_KERNEL);
+  if (port->wr_fence == NULL) {
+    rtapi_kfree(port->wr_force);
+    return -ENOMEM;
+  }
+  for (module = port->first_module; module != NULL; module = module->next) {
+    mdsio_mod_set_force(module, module->force_mask, module->fence_mask);
+  }
+
+  // at most one dirty span per register
+  port->wr_dirty = rtapi_kzalloc(sizeof(mdsio_span_t) * (words + 1), RTAPI_GFP_KERNEL);
+  if (port->wr_dirty == NULL) {
+    rtapi_kfree(port->wr_fence);
+    rtapi_kfree(port->wr_force);
+    return -ENOMEM;
+  }
+  port->wr_dirty_count = 0;
+
+  return 0;
+}
+
+void mdsio_check_image(mdsio_port_t *port) {
+  mdsio_span_t *span = port->rd_spans;
+  int count;
+  uint16_t start, end;
+
+  if (port->img_len == 0) {
+    return;
+  }
+
+  // every register of the read plan must be mirrored by the image
+  for (count = port->rd_span_count; count > 0; count--, span++) {
+    start = port->data_offset + span->offset;
+    end = start + span->len;
+    if (start < port->img_src || end > (port->img_src + port->img_len)) {
+      rtapi_print_msg(RTAPI_MSG_ERR, "%s: port %d process image does not cover offset %d, using register reads.\n",
+        port->device->name, port->index, start);
+      port->img_len = 0;
+      return;
+    }
+  }
+}
+
+int mdsio_build_dispatch(mdsio_port_t *port) {
+  mdsio_mod_t *module;
+  mdsio_disp_t *disp, tmp;
+  size_t size;
+
+  // power of two sizes come cache aligned from the allocator
+  size = 64;
+  while (size < port->module_count * sizeof(mdsio_disp_t)) {
+    size <<= 1;
+  }
+  port->disp = rtapi_kzalloc(size, RTAPI_GFP_KERNEL);
+  if (port->disp == NULL) {
+    return -ENOMEM;
+  }
+
+  // insert sorted by type, keep address order within a type
+  port->disp_count = 0;
+  for (module = port->first_module; module != NULL; module = module->next) {
+    disp = &(port->disp[port->disp_count++]);
+    disp->type = module->type;
+    disp->module = module;
+    disp->wr_data = (uint32_t *)(port->output_data + (module->data_offset - port->data_offset));
+    for (; disp > port->disp && (disp - 1)->type > disp->type; disp--) {
+      tmp = *(disp - 1);
+      *(disp - 1) = *disp;
+      *disp = tmp;
+    }
+  }
+  mdsio_set_input_view(port, port->input_view);
+
+  return 0;
+}
+
+void mdsio_set_input_view(mdsio_port_t *port, char *view) {
+  mdsio_disp_t *disp;
+  int count;
+
+  port->input_view = view;
+  for (disp = port->disp, count = port->disp_count; count > 0; count--, disp++) {
+    disp->rd_data = (uint32_t *)(view + (disp->module->data_offset - port->data_offset));
+  }
+}
+
+// modules that force or fence registers only in some modes change
+// their masks at runtime, effective with the next dirty update
+void mdsio_mod_set_force(mdsio_mod_t *module, uint64_t force_mask, uint64_t fence_mask) {
+  mdsio_port_t *port = module->port;
+  int i, base;
+
+  module->force_mask = force_mask;
+  module->fence_mask = fence_mask;
+  base = (module->data_offset - port->data_offset) >> 2;
+  for (i=0; i<(module->data_len >> 2) && i<MDSIO_MAX_MOD_WORDS; i++) {
+    port->wr_force[base + i] = (force_mask & MDSIO_MASK(i)) != 0;
+    port->wr_fence[base + i] = (fence_mask & MDSIO_MASK(i)) != 0;
+  }
+}
+
+void mdsio_invalidate_output(mdsio_port_t *port) {
+  port->output_valid = 0;
+}
+
+// called from the decode path after the board lost its state,
+// modules rebase their channel state on the restarted hardware
+int mdsio_resync_port(mdsio_port_t *port) {
+  mdsio_dev_t *device = port->device;
+  mdsio_mod_t *module;
+  uint32_t conf_val;
+  int i;
+
+  // the gateware must come back with the same layout
+  for (i=0; i<MDSIO_MAX_MODS_PER_PORT; i++) {
+    conf_val = device->proc_read_conf(port, i);
+    if (i == port->conf_count) {
+      if (MDSIO_CONF_TYPE(conf_val) != 0) {
+        return -EINVAL;
+      }
+      break;
+    }
+    if (conf_val != port->conf[i]) {
+      return -EINVAL;
+    }
+  }
+
+  if (device->proc_reset_port != NULL) {
+    device->proc_reset_port(port);
+  }
+
+  for (module = port->first_module; module != NULL; module = module->next) {
+    if (module->proc_resync != NULL) {
+      module->proc_resync(module);
+    }
+  }
+
+  mdsio_invalidate_output(port);
+  return 0;
+}
+
+void mdsio_update_dirty(mdsio_port_t *port) {
+  uint32_t *out = (uint32_t *)port->output_data;
+  uint32_t *shadow = (uint32_t *)port->output_shadow;
+  mdsio_span_t *span = port->wr_spans;
+  mdsio_span_t *dirty;
+  int count, word, end;
+
+  port->wr_dirty_count = 0;
+  for (count = port->wr_span_count; count > 0; count--, span++) {
+    dirty = NULL;
+    for (word = span->offset >> 2, end = word + (span->len >> 2); word < end; word++) {
+      // skip unchanged registers
+      if (port->output_valid && !port->wr_force[word] && out[word] == shadow[word]) {
+        dirty = NULL;
+        continue;
+      }
+
+      // append to current dirty span or start a new one
+      shadow[word] = out[word];
+      if (dirty == NULL) {
+        dirty = &(port->wr_dirty[port->wr_dirty_count++]);
+        dirty->offset = word << 2;
+        dirty->len = 0;
+      }
+      dirty->len += 4;
+    }
+  }
+
+  port->output_valid = 1;
+}
+
 void mdsio_read_port(void *arg, long period) {
+  mdsio_request_port(arg, period);
+  mdsio_collect_port(arg, period);
+}
+
+void mdsio_request_port(void *arg, long period) {
   mdsio_port_t *port = arg;
   mdsio_dev_t *device = port->device;
-  mdsio_mod_t *module;
+
+  // latch inputs in hardware, if the device is able to
+  if (device->proc_request_input != NULL) {
+    device->proc_request_input(port);
+  }
+  port->input_requested = 1;
+}
+
+void mdsio_collect_port(void *arg, long period) {
+  mdsio_port_t *port = arg;
+  MDSIO_PROF_VAR(t)
+
+  MDSIO_PROF_START(t);
+  mdsio_fetch_port(port);
+  MDSIO_PROF_STOP(port->prof_read_bus, t);
+
+  MDSIO_PROF_START(t);
+  mdsio_decode_port(port, period);
+  MDSIO_PROF_STOP(port->prof_decode, t);
+}
+
+void mdsio_fetch_port(mdsio_port_t *port) {
+  mdsio_dev_t *device = port->device;
+
+  // collect without request behaves like read
+  if (!port->input_requested) {
+    mdsio_request_port(port, 0);
+  }
+  port->input_requested = 0;
 
   device->proc_read_input(port);
-  for (module = port->first_module; module != NULL; module = module->next) {
-    module->proc_read(module, period, (uint32_t *)(port->input_data + (module->data_offset - port->data_offset)));
+}
+
+void mdsio_decode_port(mdsio_port_t *port, long period) {
+  mdsio_disp_t *disp;
+  int count;
+  MDSIO_PROF_VAR(t)
+
+  for (disp = port->disp, count = port->disp_count; count > 0; count--, disp++) {
+    MDSIO_PROF_START(t);
+    switch (disp->type) {
+      case MDSIO_WDT_TYPE:
+        mdsio_wdt_read(disp->module, period, disp->rd_data);
+        break;
+      case MDSIO_DIO_TYPE:
+        mdsio_dio_read(disp->module, period, disp->rd_data);
+        break;
+      case MDSIO_DAC_TYPE:
+        mdsio_dac_read(disp->module, period, disp->rd_data);
+        break;
+      case MDSIO_ENC_TYPE:
+        mdsio_enc_read(disp->module, period, disp->rd_data);
+        break;
+      case MDSIO_STEP_TYPE:
+        mdsio_step_read(disp->module, period, disp->rd_data);
+        break;
+      case MDSIO_PHPE_TYPE:
+        mdsio_phpe_read(disp->module, period, disp->rd_data);
+        break;
+      case MDSIO_IMG_TYPE:
+        mdsio_img_read(disp->module, period, disp->rd_data);
+        break;
+      case MDSIO_BMON_TYPE:
+        mdsio_bmon_read(disp->module, period, disp->rd_data);
+        break;
+      default:
+        disp->module->proc_read(disp->module, period, disp->rd_data);
+        break;
+    }
+    MDSIO_PROF_STOP(disp->module->prof_read, t);
   }
 }
 
 void mdsio_write_port(void *arg, long period) {
   mdsio_port_t *port = arg;
   mdsio_dev_t *device = port->device;
-  mdsio_mod_t *module;
+  MDSIO_PROF_VAR(t)
 
-  for (module = port->first_module; module != NULL; module = module->next) {
-    module->proc_write(module, period, (uint32_t *)(port->output_data + (module->data_offset - port->data_offset)));
-  }
+  MDSIO_PROF_START(t);
+  mdsio_encode_port(port, period);
+  MDSIO_PROF_STOP(port->prof_encode, t);
+
+  MDSIO_PROF_START(t);
   device->proc_write_output(port);
+  if (device->proc_flush_output != NULL) {
+    device->proc_flush_output(port);
+  }
+  MDSIO_PROF_STOP(port->prof_write_bus, t);
 }
 
-mdsio_mod_t *mdsio_add_module(mdsio_port_t *port, uint16_t type, uint16_t offset) {
+void mdsio_encode_port(mdsio_port_t *port, long period) {
+  mdsio_disp_t *disp;
+  int count;
+  MDSIO_PROF_VAR(t)
+
+  for (disp = port->disp, count = port->disp_count; count > 0; count--, disp++) {
+    MDSIO_PROF_START(t);
+    switch (disp->type) {
+      case MDSIO_WDT_TYPE:
+        mdsio_wdt_write(disp->module, period, disp->wr_data);
+        break;
+      case MDSIO_DIO_TYPE:
+        mdsio_dio_write(disp->module, period, disp->wr_data);
+        break;
+      case MDSIO_DAC_TYPE:
+        mdsio_dac_write(disp->module, period, disp->wr_data);
+        break;
+      case MDSIO_ENC_TYPE:
+        mdsio_enc_write(disp->module, period, disp->wr_data);
+        break;
+      case MDSIO_STEP_TYPE:
+        mdsio_step_write(disp->module, period, disp->wr_data);
+        break;
+      case MDSIO_PHPE_TYPE:
+        mdsio_phpe_write(disp->module, period, disp->wr_data);
+        break;
+      case MDSIO_IMG_TYPE:
+        mdsio_img_write(disp->module, period, disp->wr_data);
+        break;
+      case MDSIO_BMON_TYPE:
+        mdsio_bmon_write(disp->module, period, disp->wr_data);
+        break;
+      default:
+        disp->module->proc_write(disp->module, period, disp->wr_data);
+        break;
+    }
+    MDSIO_PROF_STOP(disp->module->prof_write, t);
+  }
+  mdsio_update_dirty(port);
+}
+
+mdsio_mod_t *mdsio_add_module(mdsio_port_t *port, uint32_t conf_val) {
   mdsio_dev_t *device = port->device;
+  uint16_t type = MDSIO_CONF_TYPE(conf_val);
+  uint16_t offset = MDSIO_CONF_OFFSET(conf_val);
 
   mdsio_mod_t *module;
   int err;
@@ -253,6 +786,8 @@ mdsio_mod_t *mdsio_add_module(mdsio_port_t *port, uint16_t type, uint16_t offset
   // initialize module
   module->port = port;
   module->type = type;
+  module->version = MDSIO_CONF_VERSION(conf_val);
+  module->channels = MDSIO_CONF_CHANNELS(conf_val);
   module->data_offset = offset;
 
   // initialize module specific parts
@@ -276,8 +811,15 @@ mdsio_mod_t *mdsio_add_module(mdsio_port_t *port, uint16_t type, uint16_t offset
     case MDSIO_PHPE_TYPE:
       err = mdsio_phpe_init(module);
       break;
+    case MDSIO_IMG_TYPE:
+      err = mdsio_img_init(module);
+      break;
+    case MDSIO_BMON_TYPE:
+      err = mdsio_bmon_init(module);
+      break;
     default:
       rtapi_print_msg(RTAPI_MSG_ERR, "%s: Unknown module type %d found at offset %d.\n", device->name, type, offset);
+      err = -EINVAL;
   }
 
   // handle error
@@ -290,7 +832,7 @@ mdsio_mod_t *mdsio_add_module(mdsio_port_t *port, uint16_t type, uint16_t offset
   MDSIO_LIST_APPEND(port->first_module, port->last_module, module);
   port->module_count++;
 
-  rtapi_print_msg(RTAPI_MSG_INFO, "%s: Initialized module type %d at offset %d.\n", device->name, type, offset);
+  rtapi_print_msg(RTAPI_MSG_INFO, "%s: Initialized module type %d at offset %d (%d channels).\n", device->name, type, offset, module->channels);
   return module;
 
 fail1:
@@ -299,6 +841,28 @@ fail0:
   return NULL;
 }
 
+// checks the register layout version of the conf word and
+// resolves its channel count, 0 selects the module default
+int mdsio_mod_channels(mdsio_mod_t *module, const char *name, int version, int def, int max) {
+  mdsio_port_t *port = module->port;
+  mdsio_dev_t *device = port->device;
+
+  if (module->version != version) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.%s: ERROR: unsupported register layout version %d (driver has %d)\n", device->name, port->index, name, module->version, version);
+    return -EINVAL;
+  }
+
+  if (module->channels == 0) {
+    module->channels = def;
+  }
+  if (module->channels > max) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.%s: ERROR: %d channels exceed the maximum of %d\n", device->name, port->index, name, module->channels, max);
+    return -EINVAL;
+  }
+
+  return 0;
+}
+
 void mdsio_remove_modules(mdsio_port_t *port) {
   mdsio_mod_t *module, *prev;
 
@@ -23,11 +23,14 @@
 #include "rtapi_slab.h"
 
 #include <linux/pci.h>
+#include <linux/io.h>
+#include <linux/dma-mapping.h>
 
 #include "hal.h"
 
 #include "mdsio_pci.h"
 #include "mdsio.h"
+#include "mdsio_img.h"
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Sascha Ittner <sascha.ittner@modusoft.de>");
@@ -46,36 +49,239 @@ static struct rtapi_pci_device_id mdsio_pci_tbl[] = {
 
 MODULE_DEVICE_TABLE(pci, mdsio_pci_tbl);
 
+static int wc[MDSIO_PCI_MAX_BOARDS] = { 0, };
+RTAPI_MP_ARRAY_INT(wc, MDSIO_PCI_MAX_BOARDS, "write outputs through write-combining mapping (per board, 0=off, 1=on)");
+
 uint32_t mdsio_pci_read_conf(mdsio_port_t *port, int word) {
   mdsio_pci_board_t *board = (mdsio_pci_board_t *)port->device_data;
   return ((uint32_t *)(board->base))[word];
 }
 
+void mdsio_pci_request_data(mdsio_port_t *port) {
+  mdsio_pci_board_t *board = (mdsio_pci_board_t *)port->device_data;
+
+  // without process image the registers are captured while reading
+  if (port->img_len == 0) {
+    return;
+  }
+
+  // paced by the board timer, only keep the snapshot mode and note the arrival
+  if (port->img_pace) {
+    *(rtapi_u32*)(board->base + port->img_ctrl) = (port->img_trig & ~MDSIO_IMG_CTRL_TRIG) |
+      (board->dma_buf != NULL ? MDSIO_IMG_CTRL_DMA : 0);
+    port->img_arrival = *(rtapi_u32*)(board->base + port->img_time);
+    port->img_due = mdsio_img_due(port, rtapi_get_time());
+    return;
+  }
+
+  // trigger snapshot and optional push, the board writes the dma trailer with the new sequence number last
+  if (board->dma_buf != NULL) {
+    *(rtapi_u32*)(board->base + port->img_ctrl) = port->img_trig | MDSIO_IMG_CTRL_DMA;
+    return;
+  }
+  *(rtapi_u32*)(board->base + port->img_ctrl) = port->img_trig;
+}
+
+static void mdsio_pci_read_stamp(mdsio_pci_board_t *board, mdsio_port_t *port) {
+  void *stamp = board->base + port->img_offset + port->img_len;
+
+  // snapshot time and trailer behind the image
+  port->img_ts = *(rtapi_u32*)(stamp);
+  port->img_trailer = *(rtapi_u32*)(stamp + 4);
+}
+
+static void mdsio_pci_wait_image(mdsio_pci_board_t *board, mdsio_port_t *port) {
+  long long start, now, poll, timeout;
+  uint32_t ctrl;
+
+  // wait for the next timer snapshot, its sequence number shows up with the end of it.
+  // the uncached ctrl read stalls the bus, so it is polled from shortly before
+  // the snapshot is due only, and once more at the timeout.
+  start = rtapi_get_time();
+  timeout = start + port->img_timeout;
+  poll = port->img_due - MDSIO_IMG_PACE_POLL_MARGIN;
+  do {
+    now = rtapi_get_time();
+    if (now >= poll || now >= timeout) {
+      ctrl = *(rtapi_u32*)(board->base + port->img_ctrl);
+      if (MDSIO_IMG_STAT_SEQ(ctrl) != MDSIO_IMG_TRAILER_SEQ(port->img_trailer) && !(ctrl & MDSIO_IMG_STAT_BUSY)) {
+        port->img_wait = rtapi_get_time() - start;
+        return;
+      }
+      poll = now + MDSIO_IMG_PACE_POLL_INTERVAL;
+    }
+    cpu_relax();
+  } while (now < timeout);
+  port->img_wait = now - start;
+
+  // late, take a snapshot now as in the unpaced mode
+  port->img_late = 1;
+  *(rtapi_u32*)(board->base + port->img_ctrl) = port->img_trig;
+}
+
+void mdsio_pci_read_image(mdsio_port_t *port) {
+  mdsio_pci_board_t *board = (mdsio_pci_board_t *)port->device_data;
+  mdsio_span_t *span = port->rd_spans;
+  int count = port->rd_span_count;
+  void *img = board->base + port->img_offset - port->img_src + port->data_offset;
+
+  port->img_late = 0;
+  if (port->img_pace) {
+    mdsio_pci_wait_image(board, port);
+  }
+
+  // the board retries our first image read until the snapshot is done
+  for (; count > 0; count--, span++) {
+    memcpy_fromio(port->input_data + span->offset, img + span->offset, span->len);
+  }
+  mdsio_pci_read_stamp(board, port);
+}
+
+void mdsio_pci_read_dma(mdsio_port_t *port) {
+  mdsio_pci_board_t *board = (mdsio_pci_board_t *)port->device_data;
+  volatile uint32_t *trailer = board->dma_trailer;
+  long long start, timeout;
+  mdsio_span_t *span;
+  uint32_t ctrl;
+  uint16_t expect;
+  int count;
+  void *img;
+
+  // paced snapshots come by the board timer, wait a fraction of the thread period for them.
+  // only the snapshot after the last one read counts, a late push of an older one is stale.
+  // newer ones come after missed timer snapshots.
+  port->img_late = 0;
+  expect = MDSIO_IMG_TRAILER_SEQ(board->dma_last) + 1;
+  start = rtapi_get_time();
+  timeout = start + (port->img_pace ? port->img_timeout : MDSIO_PCI_DMA_TIMEOUT);
+  while ((int16_t)(MDSIO_IMG_TRAILER_SEQ(*trailer) - expect) < 0) {
+    if (rtapi_get_time() > timeout) {
+      goto timeout;
+    }
+    cpu_relax();
+  }
+  rmb();
+  port->img_wait = rtapi_get_time() - start;
+
+  port->img_trailer = *trailer;
+  board->dma_last = port->img_trailer;
+  port->img_ts = trailer[-1];
+
+  // back from the mmio fallback
+  if (port->input_view != board->dma_buf) {
+    mdsio_set_input_view(port, board->dma_buf);
+  }
+
+  if (board->dma_error) {
+    rtapi_print_msg(RTAPI_MSG_INFO, "%s: port %d image dma recovered\n", MDSIO_PCI_NAME, port->index);
+    board->dma_error = 0;
+  }
+  return;
+
+timeout:
+  port->img_wait = rtapi_get_time() - start;
+  ctrl = *(rtapi_u32*)(board->base + port->img_ctrl);
+  if (port->img_pace && !(ctrl & MDSIO_IMG_STAT_DMA_ERR)) {
+    // late timer snapshot, no dma fault: take a snapshot now and read it by mmio.
+    // the ctrl write also sets the timer mode, so it keeps the push on.
+    port->img_late = 1;
+    *(rtapi_u32*)(board->base + port->img_ctrl) = port->img_trig | MDSIO_IMG_CTRL_DMA;
+  } else if (!board->dma_error) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: port %d image dma timeout, copying image by mmio\n", MDSIO_PCI_NAME, port->index);
+    board->dma_error = 1;
+  }
+
+  // copy last snapshot into the input buffer, a late push may still overwrite the dma buffer
+  img = board->base + port->img_offset - port->img_src + port->data_offset;
+  for (span = port->rd_spans, count = port->rd_span_count; count > 0; count--, span++) {
+    memcpy_fromio(port->input_data + span->offset, img + span->offset, span->len);
+  }
+  mdsio_pci_read_stamp(board, port);
+  if (port->input_view != port->input_data) {
+    mdsio_set_input_view(port, port->input_data);
+  }
+
+  // a push of this or an older snapshot is stale, wait past it next time
+  board->dma_last = port->img_trailer;
+}
+
 void mdsio_pci_read_data(mdsio_port_t *port) {
   mdsio_pci_board_t *board = (mdsio_pci_board_t *)port->device_data;
-  int size = port->data_len;
-  void *buffer = port->input_data;
-  void *src = board->base + port->data_offset;
+  mdsio_span_t *span = port->rd_spans;
+  int count = port->rd_span_count;
+  int size;
+  void *buffer;
+  void *src;
 
-  while (size > 0) {
-    *(rtapi_u32*)buffer = *(rtapi_u32*)src;
-    src += 4;
-    buffer += 4;
-    size -=4;
+  // fetch from process image if available
+  if (board->dma_buf != NULL) {
+    mdsio_pci_read_dma(port);
+    return;
+  }
+  if (port->img_len > 0) {
+    mdsio_pci_read_image(port);
+    return;
+  }
+
+  for (; count > 0; count--, span++) {
+    size = span->len;
+    buffer = port->input_data + span->offset;
+    src = board->base + port->data_offset + span->offset;
+
+    while (size > 0) {
+      *(rtapi_u32*)buffer = *(rtapi_u32*)src;
+      src += 4;
+      buffer += 4;
+      size -=4;
+    }
   }
 }
 
 void mdsio_pci_write_data(mdsio_port_t *port) {
   mdsio_pci_board_t *board = (mdsio_pci_board_t *)port->device_data;
-  int size = port->data_len;
-  void *buffer = port->output_data;
-  void *dest = board->base + port->data_offset;
+  mdsio_span_t *span = port->wr_dirty;
+  int count = port->wr_dirty_count;
+  int size;
+  void *buffer;
+  void *dest;
+  char *fence;
+
+  for (; count > 0; count--, span++) {
+    size = span->len;
+    buffer = port->output_data + span->offset;
+    dest = board->out_base + port->data_offset + span->offset;
+    fence = port->wr_fence + (span->offset >> 2);
+
+    while (size > 0) {
+      // write-combining may merge and reorder, keep fenced words behind the ones before them
+      if (*fence++ && board->wc_base != NULL) {
+        wmb();
+      }
+      *(rtapi_u32*)dest = *(rtapi_u32*)buffer;
+      dest += 4;
+      buffer += 4;
+      size -=4;
+    }
+  }
+}
+
+void mdsio_pci_flush_data(mdsio_port_t *port) {
+  mdsio_pci_board_t *board = (mdsio_pci_board_t *)port->device_data;
+
+  // flush write-combining buffers, the uncached read returns after all posted writes arrived
+  if (board->wc_base != NULL && port->wr_dirty_count > 0) {
+    wmb();
+    (void) ioread32(board->base);
+  }
+}
+
+void mdsio_pci_reset_port(mdsio_port_t *port) {
+  mdsio_pci_board_t *board = (mdsio_pci_board_t *)port->device_data;
 
-  while (size > 0) {
-    *(rtapi_u32*)dest = *(rtapi_u32*)buffer;
-    dest += 4;
-    buffer += 4;
-    size -=4;
+  // the board lost the dma address with its reset and restarted the sequence
+  if (board->dma_buf != NULL) {
+    *(rtapi_u32*)(board->base + port->img_dma) = board->dma_handle + (port->img_src - port->data_offset);
+    board->dma_last = 0;
   }
 }
 
@@ -83,10 +289,126 @@ static mdsio_dev_t mdsio_device = {
   .name = MDSIO_PCI_NAME,
   .osc_freq = MDSIO_PCI_OSC_FREQ,
   .proc_read_conf = mdsio_pci_read_conf,
+  .proc_request_input = mdsio_pci_request_data,
   .proc_read_input = mdsio_pci_read_data,
-  .proc_write_output = mdsio_pci_write_data
+  .proc_write_output = mdsio_pci_write_data,
+  .proc_flush_output = mdsio_pci_flush_data,
+  .proc_reset_port = mdsio_pci_reset_port
 };
 
+// BAR0 is not marked prefetchable, the driver knows the registers and
+// maps the output alias write-combining anyway. the stores of one write
+// call may then be merged and reordered until the flush. two writes rely
+// on their order: the watchdog word is a strobe that must arrive once per
+// cycle, which the flush read at the end of every call ensures, and the
+// step command is loaded by its low word, which is fenced (fence_mask)
+// while the channel runs the gateware loop.
+// reads, captures and triggers stay on the uncached mapping.
+static void mdsio_pci_init_wc(mdsio_pci_board_t *board, mdsio_port_t *port) {
+  struct rtapi_pci_dev *dev = board->pci_dev;
+
+  board->wc_base = NULL;
+  board->out_base = board->base;
+
+  if (port->index >= MDSIO_PCI_MAX_BOARDS || !wc[port->index]) {
+    return;
+  }
+
+  board->wc_base = ioremap_wc(pci_resource_start(dev, 0) + MDSIO_PCI_WC_OFFSET, MDSIO_PCI_WC_SIZE);
+  if (board->wc_base == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: write-combining IOREMAP failed, using uncached outputs\n", MDSIO_PCI_NAME);
+    return;
+  }
+  board->out_base = board->wc_base;
+
+  rtapi_print_msg(RTAPI_MSG_INFO, "%s: port %d outputs mapped write-combining to 0x%p.\n", MDSIO_PCI_NAME, port->index, board->wc_base);
+}
+
+static void mdsio_pci_free_wc(mdsio_pci_board_t *board) {
+  if (board->wc_base == NULL) {
+    return;
+  }
+
+  board->out_base = board->base;
+  iounmap(board->wc_base);
+  board->wc_base = NULL;
+}
+
+static void mdsio_pci_init_dma(mdsio_pci_board_t *board, mdsio_port_t *port) {
+  struct rtapi_pci_dev *dev = board->pci_dev;
+  uint16_t img_start;
+  size_t size;
+
+  if (port->img_len == 0 || port->img_dma == 0) {
+    return;
+  }
+  if (port->img_src < port->data_offset) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: process image starts before port data, dma disabled\n", MDSIO_PCI_NAME);
+    return;
+  }
+
+  // buffer mirrors the port data window, stamp and trailer follow the image
+  img_start = port->img_src - port->data_offset;
+  size = img_start + port->img_len + MDSIO_IMG_STAMP_LEN;
+  if (size < port->data_len) {
+    size = port->data_len;
+  }
+
+  // the board master only drives 32 bit addresses
+  if (dma_set_mask_and_coherent(&dev->dev, DMA_BIT_MASK(32)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: no 32 bit dma possible, using mmio\n", MDSIO_PCI_NAME);
+    return;
+  }
+  board->dma_buf = dma_alloc_coherent(&dev->dev, size, &board->dma_handle, GFP_KERNEL);
+  if (board->dma_buf == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: Unable to allocate dma buffer, using mmio\n", MDSIO_PCI_NAME);
+    return;
+  }
+  memset(board->dma_buf, 0, size);
+  board->dma_size = size;
+  board->dma_trailer = (volatile uint32_t *)(board->dma_buf + img_start + port->img_len + MDSIO_IMG_STAMP_LEN - 4);
+  board->dma_error = 0;
+
+  // pushes count from the current sequence number on
+  board->dma_last = (uint32_t)MDSIO_IMG_STAT_SEQ(*(rtapi_u32*)(board->base + port->img_ctrl)) << 16;
+
+  pci_set_master(dev);
+  *(rtapi_u32*)(board->base + port->img_dma) = board->dma_handle + img_start;
+
+  // modules parse straight from the dma buffer
+  mdsio_set_input_view(port, board->dma_buf);
+
+  rtapi_print_msg(RTAPI_MSG_INFO, "%s: image dma buffer of %d bytes at bus address 0x%08llx.\n",
+    MDSIO_PCI_NAME, (int)size, (unsigned long long)board->dma_handle);
+}
+
+// stop the snapshot timer and the push, and let a push already on the
+// bus finish before the buffer goes away
+static void mdsio_pci_free_dma(mdsio_pci_board_t *board, mdsio_port_t *port) {
+  long long timeout;
+
+  if (board->dma_buf == NULL) {
+    return;
+  }
+
+  *(rtapi_u32*)(board->base + port->img_ctrl + (MDSIO_IMG_PERIOD << 2)) = 0;
+  *(rtapi_u32*)(board->base + port->img_dma) = 0;
+
+  // the read flushes the posted writes
+  timeout = rtapi_get_time() + MDSIO_PCI_DMA_TIMEOUT;
+  while (*(rtapi_u32*)(board->base + port->img_ctrl) & MDSIO_IMG_STAT_BUSY) {
+    if (rtapi_get_time() > timeout) {
+      rtapi_print_msg(RTAPI_MSG_ERR, "%s: port %d image dma did not stop\n", MDSIO_PCI_NAME, port->index);
+      break;
+    }
+    cpu_relax();
+  }
+
+  pci_clear_master(board->pci_dev);
+  dma_free_coherent(&board->pci_dev->dev, board->dma_size, board->dma_buf, board->dma_handle);
+  board->dma_buf = NULL;
+}
+
 static int mdsio_pci_probe(struct rtapi_pci_dev *dev, const struct rtapi_pci_device_id *ent) {
   mdsio_pci_board_t *board;
   mdsio_port_t *port;
@@ -127,6 +449,9 @@ static int mdsio_pci_probe(struct rtapi_pci_dev *dev, const struct rtapi_pci_dev
   }
   rtapi_pci_set_drvdata(dev, port);
 
+  mdsio_pci_init_wc(board, port);
+  mdsio_pci_init_dma(board, port);
+
   return 0;
 
 fail3:
@@ -143,7 +468,9 @@ static void mdsio_pci_remove(struct rtapi_pci_dev *dev) {
   mdsio_port_t *port = dev->driver_data;
   mdsio_pci_board_t *board = (mdsio_pci_board_t *)(port->device_data);
 
+  mdsio_pci_free_dma(board, port);
   mdsio_destroy_port(port);
+  mdsio_pci_free_wc(board);
   rtapi_pci_set_drvdata(dev, NULL);
   rtapi_iounmap(board->base);
   rtapi_kfree(board);
@@ -20,20 +20,33 @@
 
 #include <rtapi_pci.h>
 
+#include "mdsio_board.h"
+
 #define MDSIO_PCI_VERSION "1.0.0"
 #define MDSIO_PCI_NAME    "mdsio_pci"
 
-#define MDSIO_PCI_OSC_FREQ 33333333
+#define MDSIO_PCI_OSC_FREQ MDSIO_BOARD_OSC_FREQ
+
+#define MDSIO_PCI_MAX_BOARDS MDSIO_BOARD_MAX
 
-#define MDSIO_PCILITE_VID 0x4150
-#define MDSIO_PCILITE_PID 0x0007
+// outputs use the first alias of the register space
+#define MDSIO_PCI_WC_OFFSET MDSIO_BOARD_REG_SIZE
+#define MDSIO_PCI_WC_SIZE   MDSIO_BOARD_REG_SIZE
 
-#define MDSIO_PCILITE_SUB_VID 0x1172
-#define MDSIO_PCILITE_SUB_PID 0x0202
+// max wait for the image dma trailer (ns)
+#define MDSIO_PCI_DMA_TIMEOUT 100000
 
 typedef struct mdsio_pci_board_t {
   struct rtapi_pci_dev *pci_dev;
   void rtapi__iomem *base;
+  void rtapi__iomem *wc_base;
+  void rtapi__iomem *out_base;
+  void *dma_buf;
+  dma_addr_t dma_handle;
+  size_t dma_size;
+  volatile uint32_t *dma_trailer;
+  uint32_t dma_last;
+  int dma_error;
 } mdsio_pci_board_t;
 
 #endif
@@ -44,6 +44,12 @@ typedef struct {
   hal_bit_t *area_state;
   hal_bit_t *area_ena;
   hal_float_t *area_pos;
+  hal_bit_t *probe_ena;
+  hal_float_t *probe_pos;
+  int probe_wait;
+  int resync;			// rebase on the restarted hardware counter
+  int32_t cnt;			// last position count, rebased
+  int32_t cnt_offset;		// rebase of the hardware counter after a reset
   hal_bit_t area_inv;
   hal_bit_t pos_inv;
   int area_init;
@@ -59,25 +65,50 @@ typedef struct {
   hal_u32_t time_scan;
   hal_u32_t time_disch;
   hal_u32_t time_take;
+  hal_u32_t old_time_top;
+  hal_u32_t old_time_scan;
+  hal_u32_t old_time_disch;
+  hal_u32_t old_time_take;
+  uint32_t timing[2];
   double factor_ns;
   double factor_sincos;
-  mdsio_phpe_channel_data_t channels[MDSIO_PHPE_CHANNELS];
+  mdsio_phpe_channel_data_t *channels;
 } mdsio_phpe_data_t;
 
+// intermediate values of the position calculation
+typedef struct {
+  double lores;
+  double sin;
+  double cos;
+  double level;
+  double hires;
+} mdsio_phpe_calc_t;
+
 int mdsio_phpe_export_pins(mdsio_mod_t *module);
-void mdsio_phpe_read(mdsio_mod_t *mod, long period, uint32_t *data);
-void mdsio_phpe_write(mdsio_mod_t *mod, long period, uint32_t *data);
+static double mdsio_phpe_calc_pos(mdsio_phpe_data_t *module_data, mdsio_phpe_channel_data_t *hal_data,
+  int32_t raw_cnt, int32_t raw_sin, int32_t raw_cos, mdsio_phpe_calc_t *calc);
+static void mdsio_phpe_read_chan(mdsio_phpe_data_t *module_data, mdsio_phpe_channel_data_t *hal_data,
+  uint32_t flags, uint32_t *data);
 
 int mdsio_phpe_init(mdsio_mod_t *module) {
   mdsio_port_t *port= module->port;
   mdsio_dev_t *device= port->device;
   mdsio_phpe_data_t *hal_data;
 
+  if (mdsio_mod_channels(module, "phpe", MDSIO_PHPE_VERSION, MDSIO_PHPE_CHANNELS, MDSIO_PHPE_MAX_CHANNELS) != 0) {
+    return -EINVAL;
+  }
+
   // initialize module
   module->index = mdsio_phpe_index;
-  module->data_len = MDSIO_PHPE_LEN;
+  module->data_len = MDSIO_PHPE_LEN(module->channels);
+  // flags and channel registers (pos cnt captures sin/cos)
+  module->rd_mask = MDSIO_MASK(0) | MDSIO_MASK_RANGE(3, MDSIO_PHPE_CHAN_WORDS * module->channels);
+  // area polarity, probe arm and timing registers
+  module->wr_mask = MDSIO_MASK_RANGE(0, 3);
   module->proc_read = mdsio_phpe_read;
   module->proc_write = mdsio_phpe_write;
+  module->proc_resync = mdsio_phpe_resync;
   mdsio_phpe_index++;
 
   if ((hal_data = hal_malloc(sizeof(mdsio_phpe_data_t))) == 0) {
@@ -87,6 +118,12 @@ int mdsio_phpe_init(mdsio_mod_t *module) {
   memset(hal_data, 0, sizeof(mdsio_phpe_data_t));
   module->hal_data = hal_data;
 
+  if ((hal_data->channels = hal_malloc(module->channels * sizeof(mdsio_phpe_channel_data_t))) == 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.phpe.%d: ERROR: hal_malloc() failed\n", device->name, port->index, module->index);
+    return -EIO;
+  }
+  memset(hal_data->channels, 0, module->channels * sizeof(mdsio_phpe_channel_data_t));
+
   // calculate time constants
   hal_data->factor_ns = (double)device->osc_freq / (double)1000000000;
 
@@ -104,6 +141,9 @@ int mdsio_phpe_init(mdsio_mod_t *module) {
   hal_data->time_disch = 28600;
   hal_data->time_take  = 28200;
 
+  // make the first write pack the timing registers
+  hal_data->old_time_top = ~0;
+
   // register pins
   if (mdsio_phpe_export_pins(module) != 0) {
     rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.phpe.%d: ERROR: export_pins() failed\n", device->name, port->index, module->index);
@@ -154,7 +194,7 @@ int mdsio_phpe_export_pins(mdsio_mod_t *module) {
   module_data->array_cnt_old = 0;
   module_data->factor_sincos = 0;
 
-  for(i=0; i<MDSIO_PHPE_CHANNELS; i++) {
+  for(i=0; i<module->channels; i++) {
     data = &(module_data->channels[i]);
 
     if ((err = hal_pin_s32_newf(HAL_OUT, &(data->raw_counts), comp_id, "%s.%d.phpe.%d.ch%d-raw-counts", dname, pidx, midx, i)) != 0) {
@@ -199,6 +239,12 @@ int mdsio_phpe_export_pins(mdsio_mod_t *module) {
     if ((err = hal_pin_float_newf(HAL_OUT, &(data->area_pos), comp_id, "%s.%d.phpe.%d.ch%d-area-pos", dname, pidx, midx, i)) != 0) {
       return err;
     }
+    if ((err = hal_pin_bit_newf(HAL_IO, &(data->probe_ena), comp_id, "%s.%d.phpe.%d.ch%d-probe-enable", dname, pidx, midx, i)) != 0) {
+      return err;
+    }
+    if ((err = hal_pin_float_newf(HAL_OUT, &(data->probe_pos), comp_id, "%s.%d.phpe.%d.ch%d-probe-pos", dname, pidx, midx, i)) != 0) {
+      return err;
+    }
     if ((err = hal_param_bit_newf(HAL_RW, &(data->area_inv), comp_id, "%s.%d.phpe.%d.ch%d-area-inv", dname, pidx, midx, i)) != 0) {
       return err;
     }
@@ -220,6 +266,8 @@ int mdsio_phpe_export_pins(mdsio_mod_t *module) {
     *(data->area_state) = 0;
     *(data->area_ena) = 0;
     *(data->area_pos) = 0.0;
+    *(data->probe_ena) = 0;
+    *(data->probe_pos) = 0.0;
 
     // init other fields
     data->area_inv = 0;
@@ -230,124 +278,132 @@ int mdsio_phpe_export_pins(mdsio_mod_t *module) {
   return 0;
 }
 
-void mdsio_phpe_read(mdsio_mod_t *mod, long period, uint32_t *data) {
-  mdsio_phpe_data_t *module_data = mod->hal_data;
-  mdsio_phpe_channel_data_t *hal_data;
-  int i, word, bit;
-  int32_t raw_cnt, raw_sin, raw_cos, int_pos;
-  double lores, sin, cos, level, cosphi, hires, pos;
-  hal_bit_t area_flag;
+// position from a captured count/sin/cos register triple
+static double mdsio_phpe_calc_pos(mdsio_phpe_data_t *module_data, mdsio_phpe_channel_data_t *hal_data,
+  int32_t raw_cnt, int32_t raw_sin, int32_t raw_cos, mdsio_phpe_calc_t *calc) {
+
+  double cosphi, pos;
+
+  // calculate lores part
+  calc->lores = (double)raw_cnt * module_data->array_len;
+
+  // get sin/cos values
+  calc->sin = (double)raw_sin * module_data->factor_sincos;
+  calc->cos = (double)raw_cos * module_data->factor_sincos;
 
-  // calculate sincos factor
+  // calculate level
+  calc->level = sqrt(calc->sin*calc->sin + calc->cos*calc->cos);
+
+  // calculate cosine phi
+  if (calc->level != 0) {
+    cosphi = calc->cos / calc->level;
+  } else {
+    cosphi = 1;
+  }
+
+  // calulate hires part
+  calc->hires = acos(cosphi) / (2*M_PI) * module_data->array_len;
+  if (calc->sin < 0) calc->hires = -calc->hires;
+
+  // calc position
+  pos = calc->lores + calc->hires;
+
+  // invert position
+  if (hal_data->pos_inv) {
+    pos = -pos;
+  }
+
+  return pos;
+}
+
+// calculate sincos factor
+static inline void mdsio_phpe_update_factor(mdsio_phpe_data_t *module_data) {
   if (module_data->factor_sincos == 0 || module_data->array_cnt != module_data->array_cnt_old) {
     module_data->array_cnt_old = module_data->array_cnt;
     module_data->factor_sincos = 1 / (double)(module_data->array_cnt << 16);
   }
+}
 
-  for (i=0, word=3, bit=0; i<MDSIO_PHPE_CHANNELS; i++, word+=6, bit+=8) {
-    hal_data = &(module_data->channels[i]);
-
-    // get bit flags
-    *(hal_data->area_state) = (data[0] >> (bit + 1)) & 0x1;
-    area_flag = (data[0] >> (bit + 2)) & 0x1;
-
-    // handle area flag
-    if (area_flag && *(hal_data->area_ena)) {
-      *(hal_data->area_ena) = 0;
-
-      // read area registers
-      raw_cnt = data[word + 3];
-      raw_sin = data[word + 4];
-      raw_cos = data[word + 5];
-
-      // calculate lores part
-      lores = (double)raw_cnt * module_data->array_len;
-
-      // get sin/cos values
-      sin = (double)raw_sin * module_data->factor_sincos;
-      cos = (double)raw_cos * module_data->factor_sincos;
-
-      // calculate level
-      level = sqrt(sin*sin + cos*cos);
-
-      // calculate cosine phi
-      if (level != 0) {
-        cosphi = cos / level;
-      } else {
-        cosphi = 1;
-      }
-
-      // calulate hires part
-      hires = acos(cosphi) / (2*M_PI) * module_data->array_len;
-      if (sin < 0) hires = -hires;
- 
-      // calc position
-      pos = lores+hires;
-
-      // invert position
-      if (hal_data->pos_inv) {
-        pos = -pos;
-      }
-
-      // set position
-      *(hal_data->area_pos) = pos;
-    }
+// decode one channel, flags are the channel bits of the flag word
+static void mdsio_phpe_read_chan(mdsio_phpe_data_t *module_data, mdsio_phpe_channel_data_t *hal_data,
+  uint32_t flags, uint32_t *data) {
+
+  mdsio_phpe_calc_t calc;
+  int32_t raw_cnt, int_pos;
+  double pos;
+  hal_bit_t area_flag, probe_flag;
+
+  // get bit flags
+  *(hal_data->area_state) = (flags >> 1) & 0x1;
+  area_flag = (flags >> 2) & 0x1;
+  probe_flag = (flags >> 3) & 0x1;
+
+  // handle board reset, keep the position continuous. the area
+  // position stays valid, the latches are rebased like the count
+  if (hal_data->resync) {
+    hal_data->resync = 0;
+    hal_data->cnt_offset = hal_data->cnt - (int32_t)data[0];
+    area_flag = 0;
+    probe_flag = 0;
+  }
 
-    // read registers
-    raw_cnt = data[word + 0];
-    raw_sin = data[word + 1];
-    raw_cos = data[word + 2];
+  // handle area flag
+  if (area_flag && *(hal_data->area_ena)) {
+    *(hal_data->area_ena) = 0;
 
-    // calculate lores part
-    lores = (double)raw_cnt * module_data->array_len;
+    // read area registers
+    *(hal_data->area_pos) = mdsio_phpe_calc_pos(module_data, hal_data, data[3] + hal_data->cnt_offset,
+      data[4], data[5], &calc);
+  }
 
-    // get sin/cos values
-    sin = (double)raw_sin * module_data->factor_sincos;
-    cos = (double)raw_cos * module_data->factor_sincos;
+  // handle probe flag, held by the hw until the arm bit is cleared
+  if (!probe_flag) {
+    hal_data->probe_wait = 0;
+  } else if (*(hal_data->probe_ena) && !hal_data->probe_wait) {
+    *(hal_data->probe_ena) = 0;
+    hal_data->probe_wait = 1;
 
-    // calculate level
-    level = sqrt(sin*sin + cos*cos);
+    // read probe registers
+    *(hal_data->probe_pos) = mdsio_phpe_calc_pos(module_data, hal_data, data[6] + hal_data->cnt_offset,
+      data[7], data[8], &calc) - *(hal_data->area_pos);
+  }
 
-    // calculate cosine phi
-    if (level != 0) {
-      cosphi = cos / level;
-    } else {
-      cosphi = 1;
-    }
+  // read registers
+  raw_cnt = data[0];
+  hal_data->cnt = raw_cnt + hal_data->cnt_offset;
+  pos = mdsio_phpe_calc_pos(module_data, hal_data, hal_data->cnt, data[1], data[2], &calc);
+
+  // update pins
+  *(hal_data->raw_counts) = raw_cnt;
+  *(hal_data->lores) = calc.lores;
+  *(hal_data->sin) = calc.sin;
+  *(hal_data->cos) = calc.cos;
+  *(hal_data->level) = calc.level;
+  *(hal_data->hires) = calc.hires;
+  *(hal_data->raw_pos) = pos;
+
+  // filter pos
+  if (fabs(*(hal_data->flt_pos) - pos) > 0.0005) {
+    int_pos = (int32_t)(pos * 1000);
+    *(hal_data->flt_pos) = (double)int_pos * 0.001;
+  }
 
-    // calulate hires part
-    hires = acos(cosphi) / (2*M_PI) * module_data->array_len;
-    if (sin < 0) hires = -hires;
- 
-    // calc position
-    pos = lores+hires;
+  // calculate area offset
+  *(hal_data->pos) = *(hal_data->flt_pos) - *(hal_data->area_pos);
 
-    // invert position
-    if (hal_data->pos_inv) {
-      pos = -pos;
-    }
+  // check level
+  *(hal_data->level_warn) = (module_data->level_warn_val > 0 && calc.level < module_data->level_warn_val);
+  *(hal_data->level_err) = (module_data->level_err_val > 0 && calc.level < module_data->level_err_val);
+}
 
-    // update pins
-    *(hal_data->raw_counts) = raw_cnt;
-    *(hal_data->lores) = lores;
-    *(hal_data->sin) = sin;
-    *(hal_data->cos) = cos;
-    *(hal_data->level) = level;
-    *(hal_data->hires) = hires;
-    *(hal_data->raw_pos) = pos;
-
-    // filter pos
-    if (fabs(*(hal_data->flt_pos) - pos) > 0.0005) {
-      int_pos = (int32_t)(pos * 1000);
-      *(hal_data->flt_pos) = (double)int_pos * 0.001;
-    }
+void mdsio_phpe_read(mdsio_mod_t *mod, long period, uint32_t *data) {
+  mdsio_phpe_data_t *module_data = mod->hal_data;
+  int i, word, bit;
 
-    // calculate area offset
-    *(hal_data->pos) = *(hal_data->flt_pos) - *(hal_data->area_pos);
+  mdsio_phpe_update_factor(module_data);
 
-    // check level
-    *(hal_data->level_warn) = (module_data->level_warn_val > 0 && level < module_data->level_warn_val);
-    *(hal_data->level_err) = (module_data->level_err_val > 0 && level < module_data->level_err_val);
+  for (i=0, word=3, bit=0; i<mod->channels; i++, word+=MDSIO_PHPE_CHAN_WORDS, bit+=8) {
+    mdsio_phpe_read_chan(module_data, &(module_data->channels[i]), data[0] >> bit, &data[word]);
   }
 }
 
@@ -357,25 +413,45 @@ void mdsio_phpe_write(mdsio_mod_t *mod, long period, uint32_t *data) {
   uint32_t top, scan, disch, take;
   int i, bit;
 
-  memset(data, 0, MDSIO_PHPE_LEN);
- 
-  // calculate timing periods
-  top   = (uint32_t)(module_data->factor_ns * (double)module_data->time_top);
-  scan  = (uint32_t)(module_data->factor_ns * (double)module_data->time_scan);
-  disch = (uint32_t)(module_data->factor_ns * (double)module_data->time_disch);
-  take  = (uint32_t)(module_data->factor_ns * (double)module_data->time_take);
+  memset(data, 0, mod->data_len);
+
+  // calculate timing periods, only when they change
+  if (MDSIO_CHANGED(module_data->old_time_top, module_data->time_top) |
+      MDSIO_CHANGED(module_data->old_time_scan, module_data->time_scan) |
+      MDSIO_CHANGED(module_data->old_time_disch, module_data->time_disch) |
+      MDSIO_CHANGED(module_data->old_time_take, module_data->time_take)) {
+    top   = (uint32_t)(module_data->factor_ns * (double)module_data->time_top);
+    scan  = (uint32_t)(module_data->factor_ns * (double)module_data->time_scan);
+    disch = (uint32_t)(module_data->factor_ns * (double)module_data->time_disch);
+    take  = (uint32_t)(module_data->factor_ns * (double)module_data->time_take);
+    module_data->timing[0] = (top & 0xffff) | ((scan & 0xffff) << 16);
+    module_data->timing[1] = (disch & 0xffff) | ((take & 0xffff) << 16);
+  }
 
   // write timing registers
-  data[1] = (top & 0xffff) | ((scan & 0xffff) << 16);
-  data[2] = (disch & 0xffff) | ((take & 0xffff) << 16);
+  data[1] = module_data->timing[0];
+  data[2] = module_data->timing[1];
 
-  for (i=0, bit=0; i<MDSIO_PHPE_CHANNELS; i++, bit+=8) {
+  for (i=0, bit=0; i<mod->channels; i++, bit+=8) {
     hal_data = &(module_data->channels[i]);
 
     // set bit flags
     if (hal_data->area_inv) {
       data[0] |= (1 << (bit + 0));
     }
+    if (*(hal_data->probe_ena) && !hal_data->probe_wait) {
+      data[0] |= (1 << (bit + 3));
+    }
   }
 }
 
+void mdsio_phpe_resync(mdsio_mod_t *mod) {
+  mdsio_phpe_data_t *module_data = mod->hal_data;
+  int i;
+
+  // hardware counters and latches restarted from zero
+  for (i=0; i<mod->channels; i++) {
+    module_data->channels[i].resync = 1;
+    module_data->channels[i].probe_wait = 0;
+  }
+}
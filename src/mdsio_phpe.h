@@ -21,10 +21,20 @@
 #include "mdsio.h"
 
 #define MDSIO_PHPE_TYPE 6
-#define MDSIO_PHPE_LEN 48
+#define MDSIO_PHPE_VERSION 1
 
+// default and max channel count, 8 flag bits per channel
 #define MDSIO_PHPE_CHANNELS 2
+#define MDSIO_PHPE_MAX_CHANNELS 4
+
+// flag and timing words, then per channel: position, area latch
+// and probe latch, each as count, sin and cos
+#define MDSIO_PHPE_CHAN_WORDS 9
+#define MDSIO_PHPE_LEN(channels) ((3 + MDSIO_PHPE_CHAN_WORDS * (channels)) << 2)
 
 int mdsio_phpe_init(mdsio_mod_t *module);
+void mdsio_phpe_read(mdsio_mod_t *mod, long period, uint32_t *data);
+void mdsio_phpe_write(mdsio_mod_t *mod, long period, uint32_t *data);
+void mdsio_phpe_resync(mdsio_mod_t *mod);
 
 #endif
@@ -0,0 +1,170 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+#ifdef MDSIO_PROFILE
+
+#include "rtapi.h"
+#include "rtapi_string.h"
+
+#include "hal.h"
+
+#include "mdsio.h"
+#include "mdsio_prof.h"
+
+#include "mdsio_bmon.h"
+#include "mdsio_dac.h"
+#include "mdsio_dio.h"
+#include "mdsio_enc.h"
+#include "mdsio_img.h"
+#include "mdsio_phpe.h"
+#include "mdsio_step.h"
+#include "mdsio_wdt.h"
+
+static const char *mdsio_prof_type_name(uint16_t type) {
+  switch (type) {
+    case MDSIO_WDT_TYPE:
+      return "wdt";
+    case MDSIO_DIO_TYPE:
+      return "dio";
+    case MDSIO_DAC_TYPE:
+      return "dac";
+    case MDSIO_ENC_TYPE:
+      return "enc";
+    case MDSIO_STEP_TYPE:
+      return "step";
+    case MDSIO_PHPE_TYPE:
+      return "phpe";
+    case MDSIO_IMG_TYPE:
+      return "img";
+    case MDSIO_BMON_TYPE:
+      return "bmon";
+  }
+  return "mod";
+}
+
+static mdsio_prof_t *mdsio_prof_create(mdsio_dev_t *device, const char *prefix) {
+  int comp_id = device->comp_id;
+  mdsio_prof_t *prof;
+  int i;
+
+  prof = hal_malloc(sizeof(mdsio_prof_t));
+  if (prof == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: Unable to allocate profiling memory\n", device->name);
+    return NULL;
+  }
+
+  if (hal_pin_u32_newf(HAL_OUT, &(prof->last), comp_id, "%s.last", prefix) != 0) {
+    goto fail;
+  }
+  if (hal_pin_u32_newf(HAL_OUT, &(prof->max), comp_id, "%s.max", prefix) != 0) {
+    goto fail;
+  }
+  if (hal_pin_u32_newf(HAL_OUT, &(prof->avg), comp_id, "%s.avg", prefix) != 0) {
+    goto fail;
+  }
+  for (i=0; i<MDSIO_PROF_BUCKETS; i++) {
+    if (hal_pin_u32_newf(HAL_OUT, &(prof->hist[i]), comp_id, "%s.hist-%02d", prefix, i) != 0) {
+      goto fail;
+    }
+    *(prof->hist[i]) = 0;
+  }
+  if (hal_pin_bit_newf(HAL_IN, &(prof->reset), comp_id, "%s.reset", prefix) != 0) {
+    goto fail;
+  }
+
+  *(prof->last) = 0;
+  *(prof->max) = 0;
+  *(prof->avg) = 0;
+  *(prof->reset) = 0;
+  prof->avg_acc = 0;
+  return prof;
+
+fail:
+  rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: profiling pin export for %s failed\n", device->name, prefix);
+  return NULL;
+}
+
+int mdsio_prof_dev_init(mdsio_dev_t *device) {
+  char name[HAL_NAME_LEN + 1];
+
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.prof-read-all", device->name);
+  if ((device->prof_read = mdsio_prof_create(device, name)) == NULL) {
+    return -EIO;
+  }
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.prof-read-all-bus", device->name);
+  if ((device->prof_read_bus = mdsio_prof_create(device, name)) == NULL) {
+    return -EIO;
+  }
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.prof-read-all-decode", device->name);
+  if ((device->prof_decode = mdsio_prof_create(device, name)) == NULL) {
+    return -EIO;
+  }
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.prof-write-all", device->name);
+  if ((device->prof_write = mdsio_prof_create(device, name)) == NULL) {
+    return -EIO;
+  }
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.prof-write-all-encode", device->name);
+  if ((device->prof_encode = mdsio_prof_create(device, name)) == NULL) {
+    return -EIO;
+  }
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.prof-write-all-bus", device->name);
+  if ((device->prof_write_bus = mdsio_prof_create(device, name)) == NULL) {
+    return -EIO;
+  }
+
+  return 0;
+}
+
+int mdsio_prof_port_init(mdsio_port_t *port) {
+  mdsio_dev_t *device = port->device;
+  mdsio_mod_t *module;
+  char name[HAL_NAME_LEN + 1];
+
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.%d.prof-read-bus", device->name, port->index);
+  if ((port->prof_read_bus = mdsio_prof_create(device, name)) == NULL) {
+    return -EIO;
+  }
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.%d.prof-read-decode", device->name, port->index);
+  if ((port->prof_decode = mdsio_prof_create(device, name)) == NULL) {
+    return -EIO;
+  }
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.%d.prof-write-encode", device->name, port->index);
+  if ((port->prof_encode = mdsio_prof_create(device, name)) == NULL) {
+    return -EIO;
+  }
+  rtapi_snprintf(name, HAL_NAME_LEN, "%s.%d.prof-write-bus", device->name, port->index);
+  if ((port->prof_write_bus = mdsio_prof_create(device, name)) == NULL) {
+    return -EIO;
+  }
+
+  // per module, next to the pins of the module
+  for (module = port->first_module; module != NULL; module = module->next) {
+    rtapi_snprintf(name, HAL_NAME_LEN, "%s.%d.%s.%d.prof-read", device->name, port->index, mdsio_prof_type_name(module->type), module->index);
+    if ((module->prof_read = mdsio_prof_create(device, name)) == NULL) {
+      return -EIO;
+    }
+    rtapi_snprintf(name, HAL_NAME_LEN, "%s.%d.%s.%d.prof-write", device->name, port->index, mdsio_prof_type_name(module->type), module->index);
+    if ((module->prof_write = mdsio_prof_create(device, name)) == NULL) {
+      return -EIO;
+    }
+  }
+
+  return 0;
+}
+
+#endif
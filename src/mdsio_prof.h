@@ -0,0 +1,90 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+#ifndef _MDSIO_PROF_H_
+#define _MDSIO_PROF_H_
+
+// execution time instrumentation, build with MDSIO_PROFILE=1.
+// times are in cpu clocks (rtapi_get_clocks), like the hal thread
+// time/tmax values. without MDSIO_PROFILE all of this compiles away.
+
+#ifdef MDSIO_PROFILE
+
+#include "mdsio.h"
+
+// log2 histogram, bucket 0 counts times below 256 clocks,
+// every further bucket doubles, the last one takes the rest
+#define MDSIO_PROF_BUCKETS 12
+#define MDSIO_PROF_BASE_SHIFT 8
+
+// average over about 16 samples
+#define MDSIO_PROF_AVG_SHIFT 4
+
+typedef struct mdsio_prof {
+  hal_u32_t *last;
+  hal_u32_t *max;
+  hal_u32_t *avg;
+  hal_u32_t *hist[MDSIO_PROF_BUCKETS];
+  hal_bit_t *reset;
+  uint64_t avg_acc;
+} mdsio_prof_t;
+
+#define MDSIO_PROF_VAR(t) long long t;
+#define MDSIO_PROF_START(t) do { t = rtapi_get_clocks(); } while (0)
+#define MDSIO_PROF_STOP(prof, t) mdsio_prof_add(prof, t)
+
+int mdsio_prof_dev_init(mdsio_dev_t *device);
+int mdsio_prof_port_init(mdsio_port_t *port);
+
+static inline void mdsio_prof_add(mdsio_prof_t *prof, long long start) {
+  long long clocks = rtapi_get_clocks() - start;
+  uint32_t t;
+  int i;
+
+  t = (clocks > 0xffffffffLL) ? 0xffffffff : (clocks < 0 ? 0 : (uint32_t)clocks);
+
+  if (*(prof->reset)) {
+    *(prof->max) = 0;
+    prof->avg_acc = (uint64_t)t << MDSIO_PROF_AVG_SHIFT;
+    for (i=0; i<MDSIO_PROF_BUCKETS; i++) {
+      *(prof->hist[i]) = 0;
+    }
+  }
+
+  *(prof->last) = t;
+  if (t > *(prof->max)) {
+    *(prof->max) = t;
+  }
+  prof->avg_acc += t - (prof->avg_acc >> MDSIO_PROF_AVG_SHIFT);
+  *(prof->avg) = prof->avg_acc >> MDSIO_PROF_AVG_SHIFT;
+
+  for (i=0, t >>= MDSIO_PROF_BASE_SHIFT; t != 0 && i < (MDSIO_PROF_BUCKETS - 1); i++, t >>= 1);
+  (*(prof->hist[i]))++;
+}
+
+#else
+
+#define MDSIO_PROF_VAR(t)
+#define MDSIO_PROF_START(t) do { } while (0)
+#define MDSIO_PROF_STOP(prof, t) do { } while (0)
+
+#define mdsio_prof_dev_init(device) (0)
+#define mdsio_prof_port_init(port) (0)
+
+#endif
+
+#endif
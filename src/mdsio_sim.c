@@ -0,0 +1,1234 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// simulated mdsio boards. every board is an in memory register file
+// with the conf words of the given layout and C models of the
+// gateware modules behind it. the models are advanced by the update
+// funct, one thread period times time-scale per call, so the
+// simulation can run faster than real time. an img module takes
+// its snapshots at the end of the update, and pushes them into a
+// host buffer that stands in for the dma memory of the pci board.
+
+#include "rtapi.h"
+#include "rtapi_app.h"
+#include "rtapi_string.h"
+#include "rtapi_slab.h"
+#include "rtapi_math.h"
+
+#include "hal.h"
+
+#include "mdsio_sim.h"
+#include "mdsio.h"
+#include "mdsio_dac.h"
+#include "mdsio_dio.h"
+#include "mdsio_wdt.h"
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Sascha Ittner <sascha.ittner@modusoft.de>");
+MODULE_DESCRIPTION("Simulated mdsIO boards");
+
+static int boards = 1;
+RTAPI_MP_INT(boards, "number of simulated boards");
+static char *layout = MDSIO_SIM_LAYOUT;
+RTAPI_MP_STRING(layout, "module layout, one letter per module (w=wdt, d=dio, a=dac, e=enc, s=step, p=phpe, i=img), optionally followed by its channel count");
+
+static mdsio_sim_board_t *mdsio_sim_boards[MDSIO_BOARD_MAX];
+static mdsio_sim_pins_t *mdsio_sim_pins;
+static unsigned long long mdsio_sim_clock;
+static double mdsio_sim_clock_frac;
+
+static uint16_t mdsio_sim_type(char c) {
+  switch (c) {
+    case 'w':
+      return MDSIO_WDT_TYPE;
+    case 'd':
+      return MDSIO_DIO_TYPE;
+    case 'a':
+      return MDSIO_DAC_TYPE;
+    case 'e':
+      return MDSIO_ENC_TYPE;
+    case 's':
+      return MDSIO_STEP_TYPE;
+    case 'p':
+      return MDSIO_PHPE_TYPE;
+    case 'i':
+      return MDSIO_IMG_TYPE;
+  }
+  return 0;
+}
+
+// default channel count, 0 for modules without channels
+static int mdsio_sim_channels(uint16_t type, int *max) {
+  switch (type) {
+    case MDSIO_DIO_TYPE:
+      *max = MDSIO_DIO_MAX_CHANNELS;
+      return MDSIO_DIO_CHANNELS;
+    case MDSIO_DAC_TYPE:
+      *max = MDSIO_DAC_MAX_CHANNELS;
+      return MDSIO_DAC_CHANNELS;
+    case MDSIO_ENC_TYPE:
+      *max = MDSIO_ENC_MAX_CHANNELS;
+      return MDSIO_ENC_CHANNELS;
+    case MDSIO_STEP_TYPE:
+      *max = MDSIO_STEP_MAX_CHANNELS;
+      return MDSIO_STEP_CHANNELS;
+    case MDSIO_PHPE_TYPE:
+      *max = MDSIO_PHPE_MAX_CHANNELS;
+      return MDSIO_PHPE_CHANNELS;
+  }
+  *max = 0;
+  return 0;
+}
+
+static int mdsio_sim_version(uint16_t type) {
+  switch (type) {
+    case MDSIO_ENC_TYPE:
+      return MDSIO_ENC_VERSION;
+    case MDSIO_PHPE_TYPE:
+      return MDSIO_PHPE_VERSION;
+    case MDSIO_STEP_TYPE:
+      return MDSIO_STEP_VERSION;
+    case MDSIO_IMG_TYPE:
+      return MDSIO_IMG_VERSION;
+  }
+  return 0;
+}
+
+static int mdsio_sim_words(uint16_t type, int channels) {
+  switch (type) {
+    case MDSIO_WDT_TYPE:
+      return MDSIO_WDT_LEN >> 2;
+    case MDSIO_DIO_TYPE:
+      return MDSIO_DIO_LEN >> 2;
+    case MDSIO_DAC_TYPE:
+      return MDSIO_DAC_LEN(channels) >> 2;
+    case MDSIO_ENC_TYPE:
+      return MDSIO_ENC_LEN(channels) >> 2;
+    case MDSIO_STEP_TYPE:
+      return MDSIO_STEP_LEN(channels) >> 2;
+    case MDSIO_PHPE_TYPE:
+      return MDSIO_PHPE_LEN(channels) >> 2;
+    case MDSIO_IMG_TYPE:
+      return MDSIO_IMG_LEN >> 2;
+  }
+  return 0;
+}
+
+//
+// wdt_mod.vhd
+//
+
+static void mdsio_sim_wdt_reset(mdsio_sim_wdt_t *wdt) {
+  wdt->rand = MDSIO_WDT_SEED;
+  wdt->out_en = 0;
+  wdt->boot = 1;
+  wdt->cycle_cnt = MDSIO_SIM_WDT_CYCLES;
+  wdt->timer = 0;
+}
+
+static void mdsio_sim_wdt_write(mdsio_sim_wdt_t *wdt, uint32_t val) {
+  wdt->out_en = (val >> 16) & 1;
+  if (val & MDSIO_WDT_BOOT) {
+    wdt->boot = 0;
+  }
+
+  // matching rand retriggers the timeout and counts the initial cycles
+  if ((val & 0xffff) == wdt->rand) {
+    wdt->timer = MDSIO_SIM_WDT_TIMER;
+    if (wdt->cycle_cnt > 0) {
+      wdt->cycle_cnt--;
+    }
+  }
+  wdt->rand = ((wdt->rand << 1) | (((wdt->rand >> 15) & 1) ^ ((wdt->rand >> 10) & 1))) & 0xffff;
+}
+
+static void mdsio_sim_wdt_advance(mdsio_sim_mod_t *mod, long long clocks) {
+  mdsio_sim_wdt_t *wdt = &mod->state.wdt;
+  mdsio_sim_wdt_pins_t *pins = mod->pins;
+
+  wdt->timer -= clocks;
+  if (wdt->timer <= 0) {
+    wdt->timer = 0;
+    wdt->cycle_cnt = MDSIO_SIM_WDT_CYCLES;
+  }
+
+  *(pins->run) = (wdt->cycle_cnt == 0);
+  *(pins->out_en) = wdt->out_en && (wdt->cycle_cnt == 0);
+}
+
+static void mdsio_sim_wdt_capture(mdsio_sim_board_t *board, mdsio_sim_mod_t *mod) {
+  mdsio_sim_wdt_t *wdt = &mod->state.wdt;
+  uint32_t val;
+
+  val = wdt->rand;
+  if (wdt->out_en) {
+    val |= (1 << 16);
+  }
+  if (wdt->cycle_cnt == 0) {
+    val |= (1 << 17);
+  }
+  if (wdt->boot) {
+    val |= MDSIO_WDT_BOOT;
+  }
+  board->rd[mod->word] = val;
+}
+
+//
+// step_chan.vhd, velocity ramp and dds accumulator per clock in closed form
+//
+
+static void mdsio_sim_step_ramp(mdsio_sim_step_t *step, int i, long long target, long long lim, long long clocks) {
+  long long delta, n, k, chunk, sum;
+  int sign;
+
+  for (n = clocks; n > 0; n -= chunk) {
+    // keep the sums below 64 bit
+    chunk = (n > 0x10000) ? 0x10000 : n;
+
+    delta = target - step->vel[i];
+    if (delta == 0 || lim == 0) {
+      step->accu[i] += chunk * (step->vel[i] >> 16);
+      continue;
+    }
+
+    sign = (delta < 0) ? -1 : 1;
+    k = (long long)((double)(sign * delta) / (double)lim);
+    if (k == 0) {
+      // last partial step reaches the target
+      step->accu[i] += step->vel[i] >> 16;
+      step->vel[i] = target;
+      chunk = 1;
+      continue;
+    }
+
+    // ramp with full accel for k clocks, accu sees the old vel in each clock
+    if (k > chunk) {
+      k = chunk;
+    }
+    sum = k * step->vel[i] + sign * lim * ((k * (k - 1)) >> 1);
+    step->accu[i] += sum >> 16;
+    step->vel[i] += sign * lim * k;
+    chunk = k;
+  }
+}
+
+// velocity target of the position loop: feed forward plus the
+// velocity it can brake from, sqrt(2 * deltalim * err)
+static long long mdsio_sim_step_loop(mdsio_sim_step_t *step, int i, long long ff, long long lim, long long maxvel) {
+  long long err, abs_err, target;
+  double root;
+
+  err = step->cmd[i] - step->accu[i];
+  abs_err = (err < 0) ? -err : err;
+  if (abs_err >> 56) {
+    abs_err = (1LL << 56) - 1;
+  }
+
+  root = floor(sqrt((double)lim * (double)((abs_err >> 16) << 1)));
+  if (root > (double)maxvel) {
+    root = (double)maxvel;
+  }
+  target = (ff << 16) + ((err < 0) ? -((long long)root << 16) : ((long long)root << 16));
+
+  if (target > (maxvel << 16)) {
+    target = maxvel << 16;
+  } else if (target < -(maxvel << 16)) {
+    target = -(maxvel << 16);
+  }
+  return target;
+}
+
+static void mdsio_sim_step_advance(mdsio_sim_board_t *board, mdsio_sim_mod_t *mod, long long clocks) {
+  mdsio_sim_step_t *step = &mod->state.step;
+  mdsio_sim_step_pins_t *pins = mod->pins;
+  uint32_t *regs = &board->wr[mod->word];
+  long long ff, lim, maxvel, n, chunk;
+  uint32_t posctl;
+  int i;
+
+  for (i=0; i<mod->channels; i++) {
+    ff = (int32_t)regs[4 + MDSIO_STEP_CHAN_WORDS * i];
+    lim = regs[5 + MDSIO_STEP_CHAN_WORDS * i];
+    posctl = regs[11 + MDSIO_STEP_CHAN_WORDS * i];
+
+    if (!(posctl & MDSIO_STEP_POS_MODE)) {
+      mdsio_sim_step_ramp(step, i, board->out_en ? (ff << 16) : 0, lim, clocks);
+    } else {
+      // the loop updates its target every MDSIO_SIM_STEP_PL_CLOCKS,
+      // the command runs on with the feed forward velocity
+      maxvel = posctl & MDSIO_STEP_MAXVEL_MASK;
+      for (n = clocks; n > 0; n -= chunk) {
+        if (step->pl_wait[i] <= 0) {
+          step->vel_pos[i] = mdsio_sim_step_loop(step, i, ff, lim, maxvel);
+          step->pl_wait[i] = MDSIO_SIM_STEP_PL_CLOCKS;
+        }
+        chunk = (n > step->pl_wait[i]) ? step->pl_wait[i] : n;
+        mdsio_sim_step_ramp(step, i, board->out_en ? step->vel_pos[i] : 0, lim, chunk);
+        if (board->out_en) {
+          step->cmd[i] += chunk * ff;
+        }
+        step->pl_wait[i] -= chunk;
+      }
+    }
+
+    *(pins->pos[i]) = (double)(step->accu[i] >> 32);
+    *(pins->freq[i]) = (double)(step->vel[i] >> 16) / 4294967296.0 * (double)MDSIO_BOARD_OSC_FREQ;
+  }
+}
+
+// writing cmd_lo loads the position command
+static void mdsio_sim_step_write(mdsio_sim_board_t *board, mdsio_sim_mod_t *mod, uint16_t start, uint16_t end) {
+  mdsio_sim_step_t *step = &mod->state.step;
+  uint32_t *wr;
+  uint16_t offset;
+  int i;
+
+  for (i=0; i<mod->channels; i++) {
+    wr = &board->wr[mod->word + 4 + MDSIO_STEP_CHAN_WORDS * i];
+    offset = (mod->word + 4 + MDSIO_STEP_CHAN_WORDS * i + 6) << 2;
+    if (offset >= start && offset < end) {
+      step->cmd[i] = (long long)(((uint64_t)wr[5] << 32) | wr[6]);
+    }
+  }
+}
+
+static void mdsio_sim_step_capture(mdsio_sim_board_t *board, mdsio_sim_mod_t *mod) {
+  mdsio_sim_step_t *step = &mod->state.step;
+  uint32_t *rd = &board->rd[mod->word];
+  uint32_t *wr = &board->wr[mod->word];
+  int i;
+
+  rd[0] = wr[0];
+  rd[1] = wr[1];
+  rd[2] = wr[2];
+  rd[3] = (uint32_t)mdsio_sim_clock;
+  for (i=0, rd+=4, wr+=4; i<mod->channels; i++, rd+=MDSIO_STEP_CHAN_WORDS, wr+=MDSIO_STEP_CHAN_WORDS) {
+    rd[0] = wr[0];
+    rd[1] = wr[1];
+    rd[2] = (uint32_t)(step->accu[i] >> 32);
+    rd[3] = (uint32_t)step->accu[i];
+    rd[4] = (uint32_t)(step->vel[i] >> 16);
+    rd[5] = wr[5];
+    rd[6] = wr[6];
+    rd[7] = wr[7];
+  }
+}
+
+//
+// enc_mod.vhd/enc_chan.vhd, one count per quadrature cycle
+//
+
+static void mdsio_sim_enc_advance(mdsio_sim_board_t *board, mdsio_sim_mod_t *mod, long long clocks) {
+  mdsio_sim_enc_t *enc = &mod->state.enc;
+  mdsio_sim_enc_pins_t *pins = mod->pins;
+  uint32_t arm = board->wr[mod->word];
+  double pos, old, edge;
+  int32_t cnt, old_cnt;
+  int i;
+
+  for (i=0; i<mod->channels; i++) {
+    pos = *(pins->pos[i]);
+    old = enc->pos[i];
+    cnt = (int32_t)floor(pos);
+    old_cnt = (int32_t)floor(old);
+
+    if (cnt != old_cnt) {
+      enc->cnt[i] += cnt - old_cnt;
+      enc->cnt_flag[i] = 1;
+
+      // time of the last edge, with linear motion over the period
+      edge = (cnt > old_cnt) ? (double)cnt : (double)(cnt + 1);
+      enc->ts[i] = (uint32_t)(mdsio_sim_clock - clocks + (long long)((edge - old) / (pos - old) * (double)clocks));
+    }
+    enc->pos[i] = pos;
+
+    // armed index latches count and time on its first rising edge,
+    // held until the arm bit is cleared
+    if (!(arm & MDSIO_ENC_ARM_IDX(i))) {
+      enc->idx_flag[i] = 0;
+    } else if (*(pins->index[i]) && !enc->idx_old[i] && !enc->idx_flag[i]) {
+      enc->idx[i] = enc->cnt[i];
+      enc->idx_ts[i] = (uint32_t)mdsio_sim_clock;
+      enc->idx_flag[i] = 1;
+    }
+
+    // probe strobe, same handshake
+    if (!(arm & MDSIO_ENC_ARM_PRB(i))) {
+      enc->prb_flag[i] = 0;
+    } else if (board->probe && !enc->prb_flag[i]) {
+      enc->prb[i] = enc->cnt[i];
+      enc->prb_ts[i] = (uint32_t)mdsio_sim_clock;
+      enc->prb_flag[i] = 1;
+    }
+    enc->idx_old[i] = *(pins->index[i]);
+  }
+}
+
+static void mdsio_sim_enc_capture(mdsio_sim_board_t *board, mdsio_sim_mod_t *mod) {
+  mdsio_sim_enc_t *enc = &mod->state.enc;
+  uint32_t *rd = &board->rd[mod->word];
+  int i;
+
+  rd[0] = (uint32_t)mdsio_sim_clock;
+  for (i=0, rd++; i<mod->channels; i++, rd+=MDSIO_ENC_CHAN_WORDS) {
+    rd[0] = (enc->cnt[i] & 0x7fffffff) | (enc->cnt_flag[i] << 31);
+    rd[1] = enc->ts[i];
+    rd[2] = (enc->idx[i] & 0x7fffffff) | (enc->idx_flag[i] << 31);
+    rd[3] = enc->idx_ts[i];
+    rd[4] = (enc->prb[i] & 0x7fffffff) | (enc->prb_flag[i] << 31);
+    rd[5] = enc->prb_ts[i];
+    enc->cnt_flag[i] = 0;
+  }
+}
+
+//
+// phpe_mod.vhd/phpe_chan.vhd, sin/cos correlation result of a virtual scale
+//
+
+static void mdsio_sim_phpe_advance(mdsio_sim_board_t *board, mdsio_sim_mod_t *mod) {
+  mdsio_sim_phpe_t *phpe = &mod->state.phpe;
+  mdsio_sim_phpe_pins_t *pins = mod->pins;
+  uint32_t pol = board->wr[mod->word];
+  double periods, phase, amp;
+  int i, area;
+
+  if (pins->array_len < 1e-20) {
+    pins->array_len = 1.0;
+  }
+
+  for (i=0; i<mod->channels; i++) {
+    // counter steps where the phase passes half a period,
+    // it starts from zero at the last board reset
+    periods = *(pins->pos[i]) / pins->array_len;
+    phpe->cnt[i] = (int32_t)floor(periods + 0.5);
+    phase = (periods - (double)phpe->cnt[i]) * 2 * M_PI;
+    phpe->cnt[i] -= phpe->cnt_base[i];
+    amp = *(pins->level[i]) * (double)(pins->array_cnt << 16);
+    phpe->sin[i] = (int32_t)(amp * sin(phase));
+    phpe->cos[i] = (int32_t)(amp * cos(phase));
+
+    // area switch, captured once until read
+    area = *(pins->area[i]) ^ ((pol >> (8 * i)) & 1);
+    if (area && !phpe->area_state[i] && !phpe->area_done[i]) {
+      phpe->area_done[i] = 1;
+      phpe->area_cnt[i] = phpe->cnt[i];
+      phpe->area_sin[i] = phpe->sin[i];
+      phpe->area_cos[i] = phpe->cos[i];
+    }
+    phpe->area_state[i] = area;
+
+    // probe strobe, held until the arm bit is cleared
+    if (!((pol >> (8 * i + 3)) & 1)) {
+      phpe->probe_done[i] = 0;
+    } else if (board->probe && !phpe->probe_done[i]) {
+      phpe->probe_done[i] = 1;
+      phpe->probe_cnt[i] = phpe->cnt[i];
+      phpe->probe_sin[i] = phpe->sin[i];
+      phpe->probe_cos[i] = phpe->cos[i];
+    }
+  }
+}
+
+static void mdsio_sim_phpe_capture(mdsio_sim_board_t *board, mdsio_sim_mod_t *mod) {
+  mdsio_sim_phpe_t *phpe = &mod->state.phpe;
+  uint32_t *rd = &board->rd[mod->word];
+  uint32_t *wr = &board->wr[mod->word];
+  int i;
+
+  rd[0] = 0;
+  rd[1] = wr[1];
+  rd[2] = wr[2];
+  for (i=0; i<mod->channels; i++) {
+    rd[0] |= ((wr[0] >> (8 * i)) & 1) << (8 * i);
+    rd[0] |= phpe->area_state[i] << (8 * i + 1);
+    rd[0] |= phpe->area_done[i] << (8 * i + 2);
+    rd[0] |= phpe->probe_done[i] << (8 * i + 3);
+  }
+  for (i=0, rd+=3; i<mod->channels; i++, rd+=MDSIO_PHPE_CHAN_WORDS) {
+    rd[0] = phpe->cnt[i];
+    rd[1] = phpe->sin[i];
+    rd[2] = phpe->cos[i];
+    rd[3] = phpe->area_cnt[i];
+    rd[4] = phpe->area_sin[i];
+    rd[5] = phpe->area_cos[i];
+    rd[6] = phpe->probe_cnt[i];
+    rd[7] = phpe->probe_sin[i];
+    rd[8] = phpe->probe_cos[i];
+    phpe->area_done[i] = 0;
+  }
+}
+
+//
+// img_mod.vhd
+//
+
+static void mdsio_sim_board_capture(mdsio_sim_board_t *board);
+
+static void mdsio_sim_img_regs(mdsio_sim_board_t *board) {
+  mdsio_sim_img_t *img = &board->img->state.img;
+  uint32_t *rd = &board->rd[board->img->word];
+
+  rd[MDSIO_IMG_CTRL] = MDSIO_IMG_STAT_DMA | MDSIO_IMG_STAT_LATCH | MDSIO_IMG_STAT_TIMER | ((uint32_t)img->seq << 16);
+  if (img->dma_err) {
+    rd[MDSIO_IMG_CTRL] |= MDSIO_IMG_STAT_DMA_ERR;
+  }
+  rd[MDSIO_IMG_SRC] = (board->img_src << 2) | ((uint32_t)(board->img_len << 2) << 16);
+  rd[MDSIO_IMG_TS] = img->ts;
+  rd[MDSIO_IMG_BASE] = board->img_base << 2;
+  rd[MDSIO_IMG_DMA] = img->dma_addr;
+  rd[MDSIO_IMG_PERIOD] = img->per;
+  rd[MDSIO_IMG_TIME] = (uint32_t)mdsio_sim_clock;
+}
+
+// the push is refused without bus master enable and aborted outside
+// of the host buffer, both show up as dma error. the trailer is
+// written last, as the gateware does.
+static void mdsio_sim_img_snap(mdsio_sim_board_t *board, unsigned long long clock, int dma) {
+  mdsio_sim_img_t *img = &board->img->state.img;
+  uint32_t *image = &board->rd[board->img_base];
+  int len = board->img_len;
+  uint32_t *dest;
+
+  mdsio_sim_board_capture(board);
+  memcpy(image, &board->rd[board->img_src], len * sizeof(uint32_t));
+  img->ts = (uint32_t)clock;
+  image[len] = img->ts;
+  image[len + 1] = ((uint32_t)(uint16_t)(img->seq + 1) << 16) | (img->latch ? MDSIO_IMG_TRAILER_LATCHED : 0);
+  img->seq++;
+  img->busy_until = clock + len + MDSIO_SIM_IMG_SNAP_CLOCKS;
+
+  // never push to the cleared address after a reset
+  if (!dma || img->dma_addr == 0) {
+    return;
+  }
+  if (!board->master || !*(board->pins->bus_master) || img->dma_addr < board->dma_handle ||
+      img->dma_addr - board->dma_handle + (len + 2) * sizeof(uint32_t) > board->dma_size) {
+    img->dma_err = 1;
+    return;
+  }
+  img->dma_err = 0;
+  dest = (uint32_t *)(board->dma_buf + (img->dma_addr - board->dma_handle));
+  memcpy(dest, image, (len + 1) * sizeof(uint32_t));
+  dest[len + 1] = image[len + 1];
+}
+
+static void mdsio_sim_img_write(mdsio_sim_board_t *board, mdsio_sim_mod_t *mod, uint16_t start, uint16_t end) {
+  mdsio_sim_img_t *img = &mod->state.img;
+  uint32_t *wr = &board->wr[mod->word];
+  uint16_t offset = mod->word << 2;
+
+  if (offset + (MDSIO_IMG_DMA << 2) >= start && offset + (MDSIO_IMG_DMA << 2) < end) {
+    img->dma_addr = wr[MDSIO_IMG_DMA] & ~3;
+  }
+  if (offset + (MDSIO_IMG_PERIOD << 2) >= start && offset + (MDSIO_IMG_PERIOD << 2) < end) {
+    img->per = wr[MDSIO_IMG_PERIOD];
+  }
+
+  // latch and dma bits also set the mode of periodic snapshots
+  if (offset >= start && offset < end) {
+    img->latch = (wr[MDSIO_IMG_CTRL] & MDSIO_IMG_CTRL_LATCH) != 0;
+    img->dma_en = (wr[MDSIO_IMG_CTRL] & MDSIO_IMG_CTRL_DMA) != 0;
+    if (wr[MDSIO_IMG_CTRL] & MDSIO_IMG_CTRL_TRIG) {
+      mdsio_sim_img_snap(board, mdsio_sim_clock, img->dma_en);
+    }
+  }
+
+  mdsio_sim_img_regs(board);
+}
+
+// snapshot timer, the first trigger comes one clock after the period
+// is set. triggers that find the last snapshot running are lost.
+static void mdsio_sim_img_advance(mdsio_sim_board_t *board, long long clocks) {
+  mdsio_sim_img_t *img = &board->img->state.img;
+  unsigned long long start = mdsio_sim_clock - clocks;
+  long long at;
+
+  if (img->per == 0) {
+    img->per_next = 1;
+    mdsio_sim_img_regs(board);
+    return;
+  }
+
+  for (at = img->per_next; at <= clocks; at += img->per) {
+    if (start + at >= img->busy_until) {
+      mdsio_sim_img_snap(board, start + at, img->dma_en);
+    }
+  }
+  img->per_next = at - clocks;
+  mdsio_sim_img_regs(board);
+}
+
+//
+// board
+//
+
+static void mdsio_sim_board_reset(mdsio_sim_board_t *board) {
+  mdsio_sim_mod_t *mod;
+  mdsio_sim_phpe_pins_t *phpe;
+  int i, k;
+
+  // registers behind the conf table come up cleared
+  memset(&board->rd[board->mod_count], 0, (MDSIO_SIM_WORDS - board->mod_count) * sizeof(uint32_t));
+  memset(board->wr, 0, sizeof(board->wr));
+
+  for (i=0, mod=board->mods; i<board->mod_count; i++, mod++) {
+    memset(&mod->state, 0, sizeof(mod->state));
+    if (mod->type == MDSIO_WDT_TYPE) {
+      mdsio_sim_wdt_reset(&mod->state.wdt);
+    }
+    // the phpe counters restart from the current scale position,
+    // at power up the pins are not there yet
+    if (mod->type == MDSIO_PHPE_TYPE && mod->pins != NULL) {
+      phpe = mod->pins;
+      for (k=0; k<mod->channels; k++) {
+        mod->state.phpe.cnt_base[k] = (int32_t)floor(*(phpe->pos[k]) / phpe->array_len + 0.5);
+      }
+    }
+  }
+  if (board->img != NULL) {
+    mdsio_sim_img_regs(board);
+  }
+}
+
+static void mdsio_sim_board_advance(mdsio_sim_board_t *board, long long clocks) {
+  mdsio_sim_mod_t *mod;
+  int i, wdt;
+
+  if (*(board->pins->reset) && !board->pins->reset_old) {
+    rtapi_print_msg(RTAPI_MSG_INFO, "%s.%d: simulated board reset\n", MDSIO_SIM_NAME, board->index);
+    mdsio_sim_board_reset(board);
+  }
+  board->pins->reset_old = *(board->pins->reset);
+
+  // probe pin stands for the selected dio probe source
+  board->probe = *(board->pins->probe) && !board->pins->probe_old;
+  board->pins->probe_old = *(board->pins->probe);
+
+  // outputs are enabled by the watchdog, if there is one
+  for (i=0, wdt=0, mod=board->mods; i<board->mod_count; i++, mod++) {
+    if (mod->type == MDSIO_WDT_TYPE) {
+      mdsio_sim_wdt_advance(mod, clocks);
+      wdt = 1;
+    }
+  }
+  board->out_en = !wdt;
+  for (i=0, mod=board->mods; i<board->mod_count; i++, mod++) {
+    if (mod->type == MDSIO_WDT_TYPE && mod->state.wdt.out_en && mod->state.wdt.cycle_cnt == 0) {
+      board->out_en = 1;
+    }
+  }
+
+  for (i=0, mod=board->mods; i<board->mod_count; i++, mod++) {
+    switch (mod->type) {
+      case MDSIO_STEP_TYPE:
+        mdsio_sim_step_advance(board, mod, clocks);
+        break;
+      case MDSIO_ENC_TYPE:
+        mdsio_sim_enc_advance(board, mod, clocks);
+        break;
+      case MDSIO_PHPE_TYPE:
+        mdsio_sim_phpe_advance(board, mod);
+        break;
+    }
+  }
+
+  if (board->img != NULL) {
+    mdsio_sim_img_advance(board, clocks);
+  }
+}
+
+// pin bits of the dio banks present in the given word
+static uint32_t mdsio_sim_dio_mask(mdsio_sim_mod_t *mod, int word) {
+  int pins = mod->channels * MDSIO_DIO_BANK_PINS - (word << 5);
+
+  if (pins <= 0) {
+    return 0;
+  }
+  if (pins >= 32) {
+    return 0xffffffff;
+  }
+  return (1U << pins) - 1;
+}
+
+// latch the read registers, as the capturing reads of the real board do
+static void mdsio_sim_board_capture(mdsio_sim_board_t *board) {
+  mdsio_sim_mod_t *mod;
+  int i;
+
+  for (i=0, mod=board->mods; i<board->mod_count; i++, mod++) {
+    switch (mod->type) {
+      case MDSIO_WDT_TYPE:
+        mdsio_sim_wdt_capture(board, mod);
+        break;
+      case MDSIO_DIO_TYPE:
+        // outputs of the present banks loop back to the inputs, no error flags
+        board->rd[mod->word] = board->wr[mod->word] & mdsio_sim_dio_mask(mod, 0);
+        board->rd[mod->word + 1] = board->wr[mod->word + 1] & mdsio_sim_dio_mask(mod, 1);
+        break;
+      case MDSIO_STEP_TYPE:
+        mdsio_sim_step_capture(board, mod);
+        break;
+      case MDSIO_ENC_TYPE:
+        mdsio_sim_enc_capture(board, mod);
+        break;
+      case MDSIO_PHPE_TYPE:
+        mdsio_sim_phpe_capture(board, mod);
+        break;
+    }
+  }
+}
+
+// register write strobes of the modules, for the span start..end
+static void mdsio_sim_board_strobe(mdsio_sim_board_t *board, uint16_t start, uint16_t end) {
+  mdsio_sim_mod_t *mod;
+  uint16_t offset;
+  int i;
+
+  // the watchdog, the step position command and the img registers act on the write strobe
+  for (i=0, mod=board->mods; i<board->mod_count; i++, mod++) {
+    offset = mod->word << 2;
+    if (mod->type == MDSIO_WDT_TYPE && offset >= start && offset < end) {
+      mdsio_sim_wdt_write(&mod->state.wdt, board->wr[mod->word]);
+    }
+    if (mod->type == MDSIO_STEP_TYPE) {
+      mdsio_sim_step_write(board, mod, start, end);
+    }
+    if (mod->type == MDSIO_IMG_TYPE) {
+      mdsio_sim_img_write(board, mod, start, end);
+    }
+  }
+}
+
+static void mdsio_sim_write_reg(mdsio_sim_board_t *board, uint16_t offset, uint32_t val) {
+  board->wr[offset >> 2] = val;
+  mdsio_sim_board_strobe(board, offset, offset + 4);
+}
+
+uint32_t mdsio_sim_read_conf(mdsio_port_t *port, int word) {
+  mdsio_sim_board_t *board = (mdsio_sim_board_t *)port->device_data;
+  return board->rd[word];
+}
+
+void mdsio_sim_request_data(mdsio_port_t *port) {
+  mdsio_sim_board_t *board = (mdsio_sim_board_t *)port->device_data;
+
+  // without process image the registers are captured while reading
+  if (port->img_len == 0) {
+    return;
+  }
+
+  // paced by the board timer, only keep the snapshot mode and note the arrival
+  if (port->img_pace) {
+    mdsio_sim_write_reg(board, port->img_ctrl, (port->img_trig & ~MDSIO_IMG_CTRL_TRIG) |
+      (board->dma_buf != NULL ? MDSIO_IMG_CTRL_DMA : 0));
+    port->img_arrival = board->rd[port->img_time >> 2];
+    return;
+  }
+
+  if (board->dma_buf != NULL) {
+    mdsio_sim_write_reg(board, port->img_ctrl, port->img_trig | MDSIO_IMG_CTRL_DMA);
+    return;
+  }
+  mdsio_sim_write_reg(board, port->img_ctrl, port->img_trig);
+}
+
+static void mdsio_sim_read_stamp(mdsio_sim_board_t *board, mdsio_port_t *port) {
+  uint32_t *stamp = &board->rd[(port->img_offset + port->img_len) >> 2];
+
+  port->img_ts = stamp[0];
+  port->img_trailer = stamp[1];
+}
+
+static void mdsio_sim_copy_image(mdsio_sim_board_t *board, mdsio_port_t *port, char *dest) {
+  mdsio_span_t *span = port->rd_spans;
+  int count = port->rd_span_count;
+  char *img = (char *)board->rd + port->img_offset - port->img_src + port->data_offset;
+
+  for (; count > 0; count--, span++) {
+    memcpy(dest + span->offset, img + span->offset, span->len);
+  }
+}
+
+// simulated time stands still while the host reads, so a paced
+// snapshot that did not come with the last update does not come
+// at all. the read takes one itself, as the pci backend does after
+// its wait.
+void mdsio_sim_read_image(mdsio_port_t *port) {
+  mdsio_sim_board_t *board = (mdsio_sim_board_t *)port->device_data;
+  uint32_t ctrl = board->rd[port->img_ctrl >> 2];
+
+  port->img_wait = 0;
+  port->img_late = 0;
+  if (port->img_pace && MDSIO_IMG_STAT_SEQ(ctrl) == MDSIO_IMG_TRAILER_SEQ(port->img_trailer)) {
+    port->img_late = 1;
+    mdsio_sim_write_reg(board, port->img_ctrl, port->img_trig);
+  }
+  mdsio_sim_copy_image(board, port, port->input_data);
+  mdsio_sim_read_stamp(board, port);
+}
+
+void mdsio_sim_read_dma(mdsio_port_t *port) {
+  mdsio_sim_board_t *board = (mdsio_sim_board_t *)port->device_data;
+  volatile uint32_t *trailer = board->dma_trailer;
+  uint16_t expect;
+
+  // only the snapshot after the last one read counts, as on the pci backend
+  port->img_wait = 0;
+  port->img_late = 0;
+  expect = MDSIO_IMG_TRAILER_SEQ(board->dma_last) + 1;
+  if ((int16_t)(MDSIO_IMG_TRAILER_SEQ(*trailer) - expect) >= 0) {
+    port->img_trailer = *trailer;
+    board->dma_last = port->img_trailer;
+    port->img_ts = trailer[-1];
+    if (port->input_view != board->dma_buf) {
+      mdsio_set_input_view(port, board->dma_buf);
+    }
+
+    if (board->dma_error) {
+      rtapi_print_msg(RTAPI_MSG_INFO, "%s: port %d image dma recovered\n", MDSIO_SIM_NAME, port->index);
+      board->dma_error = 0;
+    }
+    return;
+  }
+
+  if (port->img_pace && !(board->rd[port->img_ctrl >> 2] & MDSIO_IMG_STAT_DMA_ERR)) {
+    port->img_late = 1;
+    mdsio_sim_write_reg(board, port->img_ctrl, port->img_trig | MDSIO_IMG_CTRL_DMA);
+  } else if (!board->dma_error) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: port %d image dma timeout, copying image by mmio\n", MDSIO_SIM_NAME, port->index);
+    board->dma_error = 1;
+  }
+
+  // copy last snapshot into the input buffer, a late push may still overwrite the dma buffer
+  mdsio_sim_copy_image(board, port, port->input_data);
+  mdsio_sim_read_stamp(board, port);
+  if (port->input_view != port->input_data) {
+    mdsio_set_input_view(port, port->input_data);
+  }
+  board->dma_last = port->img_trailer;
+}
+
+void mdsio_sim_read_data(mdsio_port_t *port) {
+  mdsio_sim_board_t *board = (mdsio_sim_board_t *)port->device_data;
+  mdsio_span_t *span = port->rd_spans;
+  int count = port->rd_span_count;
+
+  // fetch from process image if available
+  if (board->dma_buf != NULL) {
+    mdsio_sim_read_dma(port);
+    return;
+  }
+  if (port->img_len > 0) {
+    mdsio_sim_read_image(port);
+    return;
+  }
+
+  mdsio_sim_board_capture(board);
+  for (; count > 0; count--, span++) {
+    memcpy(port->input_data + span->offset, (char *)board->rd + port->data_offset + span->offset, span->len);
+  }
+}
+
+void mdsio_sim_write_data(mdsio_port_t *port) {
+  mdsio_sim_board_t *board = (mdsio_sim_board_t *)port->device_data;
+  mdsio_span_t *span = port->wr_dirty;
+  int count = port->wr_dirty_count;
+  uint16_t start;
+
+  for (; count > 0; count--, span++) {
+    start = port->data_offset + span->offset;
+    memcpy((char *)board->wr + start, port->output_data + span->offset, span->len);
+    mdsio_sim_board_strobe(board, start, start + span->len);
+  }
+}
+
+void mdsio_sim_reset_port(mdsio_port_t *port) {
+  mdsio_sim_board_t *board = (mdsio_sim_board_t *)port->device_data;
+
+  // the board lost the dma address with its reset and restarted the sequence
+  if (board->dma_buf != NULL) {
+    mdsio_sim_write_reg(board, port->img_dma, board->dma_handle + (port->img_src - port->data_offset));
+    board->dma_last = 0;
+  }
+}
+
+static mdsio_dev_t mdsio_device = {
+  .name = MDSIO_SIM_NAME,
+  .osc_freq = MDSIO_BOARD_OSC_FREQ,
+  .proc_read_conf = mdsio_sim_read_conf,
+  .proc_request_input = mdsio_sim_request_data,
+  .proc_read_input = mdsio_sim_read_data,
+  .proc_write_output = mdsio_sim_write_data,
+  .proc_reset_port = mdsio_sim_reset_port
+};
+
+void mdsio_sim_update(void *arg, long period) {
+  double clocks;
+  long long n;
+  int i;
+
+  // simulated time of this period
+  clocks = (double)period * 1e-9 * (double)MDSIO_BOARD_OSC_FREQ * mdsio_sim_pins->time_scale + mdsio_sim_clock_frac;
+  if (clocks < 0) {
+    clocks = 0;
+  }
+  n = (long long)clocks;
+  mdsio_sim_clock_frac = clocks - (double)n;
+  mdsio_sim_clock += n;
+
+  for (i=0; i<boards; i++) {
+    mdsio_sim_board_advance(mdsio_sim_boards[i], n);
+  }
+
+  *(mdsio_sim_pins->time) = (double)mdsio_sim_clock / (double)MDSIO_BOARD_OSC_FREQ;
+}
+
+static int mdsio_sim_export_mod(mdsio_sim_board_t *board, mdsio_sim_mod_t *mod) {
+  const char *dname = MDSIO_SIM_NAME;
+  int comp_id = mdsio_device.comp_id;
+  int bidx = board->index;
+  int midx = mod->index;
+  mdsio_sim_wdt_pins_t *wdt;
+  mdsio_sim_step_pins_t *step;
+  mdsio_sim_enc_pins_t *enc;
+  mdsio_sim_phpe_pins_t *phpe;
+  int err, i;
+
+  switch (mod->type) {
+    case MDSIO_WDT_TYPE:
+      if ((wdt = hal_malloc(sizeof(mdsio_sim_wdt_pins_t))) == 0) {
+        return -ENOMEM;
+      }
+      mod->pins = wdt;
+      if ((err = hal_pin_bit_newf(HAL_OUT, &(wdt->run), comp_id, "%s.%d.sim.wdt.%d.run", dname, bidx, midx)) != 0) {
+        return err;
+      }
+      if ((err = hal_pin_bit_newf(HAL_OUT, &(wdt->out_en), comp_id, "%s.%d.sim.wdt.%d.out-en", dname, bidx, midx)) != 0) {
+        return err;
+      }
+      *(wdt->run) = 0;
+      *(wdt->out_en) = 0;
+      break;
+
+    case MDSIO_STEP_TYPE:
+      if ((step = hal_malloc(sizeof(mdsio_sim_step_pins_t))) == 0) {
+        return -ENOMEM;
+      }
+      mod->pins = step;
+      for (i=0; i<mod->channels; i++) {
+        if ((err = hal_pin_float_newf(HAL_OUT, &(step->pos[i]), comp_id, "%s.%d.sim.step.%d.ch%d-pos", dname, bidx, midx, i)) != 0) {
+          return err;
+        }
+        if ((err = hal_pin_float_newf(HAL_OUT, &(step->freq[i]), comp_id, "%s.%d.sim.step.%d.ch%d-freq", dname, bidx, midx, i)) != 0) {
+          return err;
+        }
+        *(step->pos[i]) = 0.0;
+        *(step->freq[i]) = 0.0;
+      }
+      break;
+
+    case MDSIO_ENC_TYPE:
+      if ((enc = hal_malloc(sizeof(mdsio_sim_enc_pins_t))) == 0) {
+        return -ENOMEM;
+      }
+      mod->pins = enc;
+      for (i=0; i<mod->channels; i++) {
+        if ((err = hal_pin_float_newf(HAL_IN, &(enc->pos[i]), comp_id, "%s.%d.sim.enc.%d.ch%d-pos", dname, bidx, midx, i)) != 0) {
+          return err;
+        }
+        if ((err = hal_pin_bit_newf(HAL_IN, &(enc->index[i]), comp_id, "%s.%d.sim.enc.%d.ch%d-index", dname, bidx, midx, i)) != 0) {
+          return err;
+        }
+        *(enc->pos[i]) = 0.0;
+        *(enc->index[i]) = 0;
+      }
+      break;
+
+    case MDSIO_PHPE_TYPE:
+      if ((phpe = hal_malloc(sizeof(mdsio_sim_phpe_pins_t))) == 0) {
+        return -ENOMEM;
+      }
+      mod->pins = phpe;
+      if ((err = hal_param_float_newf(HAL_RW, &(phpe->array_len), comp_id, "%s.%d.sim.phpe.%d.array-len", dname, bidx, midx)) != 0) {
+        return err;
+      }
+      if ((err = hal_param_u32_newf(HAL_RW, &(phpe->array_cnt), comp_id, "%s.%d.sim.phpe.%d.array-cnt", dname, bidx, midx)) != 0) {
+        return err;
+      }
+      for (i=0; i<mod->channels; i++) {
+        if ((err = hal_pin_float_newf(HAL_IN, &(phpe->pos[i]), comp_id, "%s.%d.sim.phpe.%d.ch%d-pos", dname, bidx, midx, i)) != 0) {
+          return err;
+        }
+        if ((err = hal_pin_float_newf(HAL_IN, &(phpe->level[i]), comp_id, "%s.%d.sim.phpe.%d.ch%d-level", dname, bidx, midx, i)) != 0) {
+          return err;
+        }
+        if ((err = hal_pin_bit_newf(HAL_IN, &(phpe->area[i]), comp_id, "%s.%d.sim.phpe.%d.ch%d-area", dname, bidx, midx, i)) != 0) {
+          return err;
+        }
+        *(phpe->pos[i]) = 0.0;
+        *(phpe->level[i]) = 1.0;
+        *(phpe->area[i]) = 0;
+      }
+
+      // same defaults as the driver
+      phpe->array_len = 0.635;
+      phpe->array_cnt = 10;
+      break;
+  }
+
+  return 0;
+}
+
+static int mdsio_sim_board_init(mdsio_sim_board_t *board) {
+  int counts[8] = { 0, };
+  mdsio_sim_mod_t *mod;
+  uint16_t type;
+  const char *p;
+  int i, word, max, err;
+
+  // parse layout, letters with optional channel count
+  board->mod_count = 0;
+  for (p = layout; *p != 0; ) {
+    type = mdsio_sim_type(*p++);
+    if (type == 0 || board->mod_count >= MDSIO_MAX_MODS_PER_PORT) {
+      rtapi_print_msg(RTAPI_MSG_ERR, "%s: invalid layout '%s'\n", MDSIO_SIM_NAME, layout);
+      return -EINVAL;
+    }
+
+    mod = &board->mods[board->mod_count++];
+    mod->type = type;
+    mod->index = counts[type]++;
+    mod->channels = mdsio_sim_channels(type, &max);
+    if (*p >= '0' && *p <= '9') {
+      for (mod->channels = 0; *p >= '0' && *p <= '9'; p++) {
+        mod->channels = mod->channels * 10 + (*p - '0');
+      }
+      if (mod->channels < 1 || mod->channels > max) {
+        rtapi_print_msg(RTAPI_MSG_ERR, "%s: invalid channel count in layout '%s'\n", MDSIO_SIM_NAME, layout);
+        return -EINVAL;
+      }
+    }
+  }
+
+  // conf table with eol marker, registers packed behind it
+  word = board->mod_count + 1;
+  board->img = NULL;
+  for (i=0, mod=board->mods; i<board->mod_count; i++, mod++) {
+    mod->word = word;
+    board->rd[i] = mod->type | (mdsio_sim_version(mod->type) << 8) | ((mod->channels & 0x0f) << 12) | ((word << 2) << 16);
+
+    word += mdsio_sim_words(mod->type, mod->channels);
+
+    // the image mirrors all registers behind the conf table, stamp and trailer follow it
+    if (mod->type == MDSIO_IMG_TYPE) {
+      if (i != board->mod_count - 1) {
+        rtapi_print_msg(RTAPI_MSG_ERR, "%s: img must be the last module in layout '%s'\n", MDSIO_SIM_NAME, layout);
+        return -EINVAL;
+      }
+      board->img = mod;
+      board->img_src = board->mod_count + 1;
+      board->img_len = mod->word - board->img_src;
+      board->img_base = word;
+      word += board->img_len + 2;
+    }
+    if (word > MDSIO_SIM_WORDS) {
+      rtapi_print_msg(RTAPI_MSG_ERR, "%s: layout '%s' too large\n", MDSIO_SIM_NAME, layout);
+      return -EINVAL;
+    }
+  }
+
+  mdsio_sim_board_reset(board);
+
+  // export model pins
+  if ((board->pins = hal_malloc(sizeof(mdsio_sim_board_pins_t))) == 0) {
+    return -ENOMEM;
+  }
+  if ((err = hal_pin_bit_newf(HAL_IN, &(board->pins->reset), mdsio_device.comp_id, "%s.%d.sim.reset", MDSIO_SIM_NAME, board->index)) != 0) {
+    return err;
+  }
+  if ((err = hal_pin_bit_newf(HAL_IN, &(board->pins->probe), mdsio_device.comp_id, "%s.%d.sim.probe", MDSIO_SIM_NAME, board->index)) != 0) {
+    return err;
+  }
+  if ((err = hal_pin_bit_newf(HAL_IN, &(board->pins->bus_master), mdsio_device.comp_id, "%s.%d.sim.bus-master", MDSIO_SIM_NAME, board->index)) != 0) {
+    return err;
+  }
+  *(board->pins->reset) = 0;
+  board->pins->reset_old = 0;
+  *(board->pins->probe) = 0;
+  board->pins->probe_old = 0;
+  *(board->pins->bus_master) = 1;
+
+  for (i=0, mod=board->mods; i<board->mod_count; i++, mod++) {
+    if ((err = mdsio_sim_export_mod(board, mod)) != 0) {
+      return err;
+    }
+  }
+
+  return 0;
+}
+
+// host buffer in place of the coherent dma memory, bus master
+// enable is set with it like pci_set_master() does
+static void mdsio_sim_init_dma(mdsio_sim_board_t *board, mdsio_port_t *port) {
+  uint16_t img_start;
+  size_t size;
+
+  if (port->img_len == 0 || port->img_dma == 0) {
+    return;
+  }
+  if (port->img_src < port->data_offset) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: process image starts before port data, dma disabled\n", MDSIO_SIM_NAME);
+    return;
+  }
+
+  // buffer mirrors the port data window, stamp and trailer follow the image
+  img_start = port->img_src - port->data_offset;
+  size = img_start + port->img_len + MDSIO_IMG_STAMP_LEN;
+  if (size < port->data_len) {
+    size = port->data_len;
+  }
+
+  board->dma_buf = rtapi_kzalloc(size, RTAPI_GFP_KERNEL);
+  if (board->dma_buf == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: Unable to allocate dma buffer, using mmio\n", MDSIO_SIM_NAME);
+    return;
+  }
+  board->dma_handle = MDSIO_SIM_DMA_BUS;
+  board->dma_size = size;
+  board->dma_trailer = (volatile uint32_t *)(board->dma_buf + img_start + port->img_len + MDSIO_IMG_STAMP_LEN - 4);
+  board->dma_error = 0;
+
+  // pushes count from the current sequence number on
+  board->dma_last = (uint32_t)MDSIO_IMG_STAT_SEQ(board->rd[port->img_ctrl >> 2]) << 16;
+
+  board->master = 1;
+  mdsio_sim_write_reg(board, port->img_dma, board->dma_handle + img_start);
+
+  // modules parse straight from the dma buffer
+  mdsio_set_input_view(port, board->dma_buf);
+
+  rtapi_print_msg(RTAPI_MSG_INFO, "%s: image dma buffer of %d bytes at bus address 0x%08x.\n",
+    MDSIO_SIM_NAME, (int)size, board->dma_handle);
+}
+
+// stop the snapshot timer and the push before the buffer goes away
+static void mdsio_sim_free_dma(mdsio_sim_board_t *board, mdsio_port_t *port) {
+  if (board->dma_buf == NULL) {
+    return;
+  }
+
+  mdsio_sim_write_reg(board, port->img_ctrl + (MDSIO_IMG_PERIOD << 2), 0);
+  mdsio_sim_write_reg(board, port->img_dma, 0);
+  board->master = 0;
+  rtapi_kfree(board->dma_buf);
+  board->dma_buf = NULL;
+  board->dma_size = 0;
+}
+
+static void mdsio_sim_cleanup(void) {
+  int i;
+
+  for (i=0; i<MDSIO_BOARD_MAX; i++) {
+    if (mdsio_sim_boards[i] == NULL) {
+      continue;
+    }
+    if (mdsio_sim_boards[i]->port != NULL) {
+      mdsio_sim_free_dma(mdsio_sim_boards[i], mdsio_sim_boards[i]->port);
+      mdsio_destroy_port(mdsio_sim_boards[i]->port);
+    }
+    rtapi_kfree(mdsio_sim_boards[i]);
+    mdsio_sim_boards[i] = NULL;
+  }
+}
+
+int rtapi_app_main(void) {
+  mdsio_sim_board_t *board;
+  int err = 0;
+  int i;
+
+  rtapi_print_msg(RTAPI_MSG_INFO, "%s: loading mdsIO simulator version %s\n", MDSIO_SIM_NAME, MDSIO_SIM_VERSION);
+
+  if (boards < 1 || boards > MDSIO_BOARD_MAX) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: boards must be between 1 and %d\n", MDSIO_SIM_NAME, MDSIO_BOARD_MAX);
+    return -EINVAL;
+  }
+
+  err = mdsio_init(&mdsio_device);
+  if (err < 0) {
+    return err;
+  }
+
+  // simulation time base
+  if (hal_export_funct(MDSIO_SIM_NAME ".update", mdsio_sim_update, NULL, 1, 0, mdsio_device.comp_id) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: update funct export failed\n", MDSIO_SIM_NAME);
+    err = -EIO;
+    goto fail0;
+  }
+  if ((mdsio_sim_pins = hal_malloc(sizeof(mdsio_sim_pins_t))) == 0) {
+    err = -ENOMEM;
+    goto fail0;
+  }
+  if ((err = hal_pin_float_newf(HAL_OUT, &(mdsio_sim_pins->time), mdsio_device.comp_id, "%s.time", MDSIO_SIM_NAME)) != 0) {
+    goto fail0;
+  }
+  if ((err = hal_param_float_newf(HAL_RW, &(mdsio_sim_pins->time_scale), mdsio_device.comp_id, "%s.time-scale", MDSIO_SIM_NAME)) != 0) {
+    goto fail0;
+  }
+  *(mdsio_sim_pins->time) = 0.0;
+  mdsio_sim_pins->time_scale = 1.0;
+  mdsio_sim_clock = 0;
+  mdsio_sim_clock_frac = 0;
+
+  for (i=0; i<boards; i++) {
+    board = rtapi_kzalloc(sizeof(mdsio_sim_board_t), RTAPI_GFP_KERNEL);
+    if (board == NULL) {
+      rtapi_print_msg(RTAPI_MSG_ERR, "%s: Unable to allocate memory\n", MDSIO_SIM_NAME);
+      err = -ENOMEM;
+      goto fail1;
+    }
+    board->index = i;
+    mdsio_sim_boards[i] = board;
+
+    if ((err = mdsio_sim_board_init(board)) != 0) {
+      goto fail1;
+    }
+
+    board->port = mdsio_create_port(&mdsio_device, board);
+    if (board->port == NULL) {
+      rtapi_print_msg(RTAPI_MSG_ERR, "%s: mdsio_create_port failed\n", MDSIO_SIM_NAME);
+      err = -ENOMEM;
+      goto fail1;
+    }
+    mdsio_sim_init_dma(board, board->port);
+  }
+
+  mdsio_ready(&mdsio_device);
+  return 0;
+
+fail1:
+  mdsio_sim_cleanup();
+fail0:
+  mdsio_exit(&mdsio_device);
+  return err;
+}
+
+void rtapi_app_exit(void) {
+  mdsio_sim_cleanup();
+  rtapi_print_msg(RTAPI_MSG_INFO, "%s: simulator unloaded\n", MDSIO_SIM_NAME);
+  mdsio_exit(&mdsio_device);
+}
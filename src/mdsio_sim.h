@@ -0,0 +1,187 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+#ifndef _MDSIO_SIM_H_
+#define _MDSIO_SIM_H_
+
+#include "mdsio.h"
+#include "mdsio_board.h"
+#include "mdsio_enc.h"
+#include "mdsio_img.h"
+#include "mdsio_phpe.h"
+#include "mdsio_step.h"
+
+#define MDSIO_SIM_VERSION "1.0.0"
+#define MDSIO_SIM_NAME    "mdsio_sim"
+
+// register file per board, in dwords
+#define MDSIO_SIM_WORDS (MDSIO_BOARD_REG_SIZE >> 2)
+
+// module order of pci_top.vhd: dio, dac, 2x phpe, 2x enc, step, wdt.
+// a letter may be followed by a channel count, e.g. "e6s8".
+// an img module must come last, its image mirrors all modules before it.
+#define MDSIO_SIM_LAYOUT "dappeesw"
+
+// bus address of the simulated image dma buffer
+#define MDSIO_SIM_DMA_BUS 0x10000000
+
+// wdt_mod.vhd
+#define MDSIO_SIM_WDT_TIMER 0xfffff
+#define MDSIO_SIM_WDT_CYCLES 15
+
+// img_mod.vhd, clocks of a snapshot besides its source reads
+#define MDSIO_SIM_IMG_SNAP_CLOCKS 5
+
+// step_chan.vhd, clocks per position loop update
+#define MDSIO_SIM_STEP_PL_CLOCKS 67
+
+typedef struct {
+  hal_bit_t *run;
+  hal_bit_t *out_en;
+} mdsio_sim_wdt_pins_t;
+
+typedef struct {
+  uint16_t rand;
+  int out_en;
+  int boot;
+  int cycle_cnt;
+  long long timer;
+} mdsio_sim_wdt_t;
+
+typedef struct {
+  hal_float_t *pos[MDSIO_STEP_MAX_CHANNELS];
+  hal_float_t *freq[MDSIO_STEP_MAX_CHANNELS];
+} mdsio_sim_step_pins_t;
+
+typedef struct {
+  long long vel[MDSIO_STEP_MAX_CHANNELS];
+  long long accu[MDSIO_STEP_MAX_CHANNELS];
+  long long cmd[MDSIO_STEP_MAX_CHANNELS];
+  long long vel_pos[MDSIO_STEP_MAX_CHANNELS];
+  int pl_wait[MDSIO_STEP_MAX_CHANNELS];
+} mdsio_sim_step_t;
+
+typedef struct {
+  hal_float_t *pos[MDSIO_ENC_MAX_CHANNELS];
+  hal_bit_t *index[MDSIO_ENC_MAX_CHANNELS];
+} mdsio_sim_enc_pins_t;
+
+typedef struct {
+  double pos[MDSIO_ENC_MAX_CHANNELS];
+  int32_t cnt[MDSIO_ENC_MAX_CHANNELS];
+  int cnt_flag[MDSIO_ENC_MAX_CHANNELS];
+  uint32_t ts[MDSIO_ENC_MAX_CHANNELS];
+  int32_t idx[MDSIO_ENC_MAX_CHANNELS];
+  int idx_flag[MDSIO_ENC_MAX_CHANNELS];
+  uint32_t idx_ts[MDSIO_ENC_MAX_CHANNELS];
+  int32_t prb[MDSIO_ENC_MAX_CHANNELS];
+  int prb_flag[MDSIO_ENC_MAX_CHANNELS];
+  uint32_t prb_ts[MDSIO_ENC_MAX_CHANNELS];
+  hal_bit_t idx_old[MDSIO_ENC_MAX_CHANNELS];
+} mdsio_sim_enc_t;
+
+typedef struct {
+  hal_float_t *pos[MDSIO_PHPE_MAX_CHANNELS];
+  hal_float_t *level[MDSIO_PHPE_MAX_CHANNELS];
+  hal_bit_t *area[MDSIO_PHPE_MAX_CHANNELS];
+  hal_float_t array_len;
+  hal_u32_t array_cnt;
+} mdsio_sim_phpe_pins_t;
+
+typedef struct {
+  int32_t cnt[MDSIO_PHPE_MAX_CHANNELS];
+  int32_t sin[MDSIO_PHPE_MAX_CHANNELS];
+  int32_t cos[MDSIO_PHPE_MAX_CHANNELS];
+  int area_state[MDSIO_PHPE_MAX_CHANNELS];
+  int area_done[MDSIO_PHPE_MAX_CHANNELS];
+  int32_t area_cnt[MDSIO_PHPE_MAX_CHANNELS];
+  int32_t area_sin[MDSIO_PHPE_MAX_CHANNELS];
+  int32_t area_cos[MDSIO_PHPE_MAX_CHANNELS];
+  int probe_done[MDSIO_PHPE_MAX_CHANNELS];
+  int32_t probe_cnt[MDSIO_PHPE_MAX_CHANNELS];
+  int32_t probe_sin[MDSIO_PHPE_MAX_CHANNELS];
+  int32_t probe_cos[MDSIO_PHPE_MAX_CHANNELS];
+  int32_t cnt_base[MDSIO_PHPE_MAX_CHANNELS];
+} mdsio_sim_phpe_t;
+
+typedef struct {
+  int latch;
+  int dma_en;
+  uint16_t seq;
+  uint32_t ts;
+  uint32_t dma_addr;
+  int dma_err;
+  uint32_t per;
+  long long per_next;
+  unsigned long long busy_until;
+} mdsio_sim_img_t;
+
+typedef struct mdsio_sim_mod {
+  uint16_t type;
+  uint16_t word;
+  int channels;
+  int index;
+  void *pins;
+  union {
+    mdsio_sim_wdt_t wdt;
+    mdsio_sim_step_t step;
+    mdsio_sim_enc_t enc;
+    mdsio_sim_phpe_t phpe;
+    mdsio_sim_img_t img;
+  } state;
+} mdsio_sim_mod_t;
+
+typedef struct {
+  hal_bit_t *reset;
+  hal_bit_t reset_old;
+  hal_bit_t *probe;
+  hal_bit_t probe_old;
+  hal_bit_t *bus_master;
+} mdsio_sim_board_pins_t;
+
+typedef struct mdsio_sim_board {
+  int index;
+  uint32_t rd[MDSIO_SIM_WORDS];
+  uint32_t wr[MDSIO_SIM_WORDS];
+  int out_en;
+  int probe;
+  int mod_count;
+  mdsio_sim_mod_t mods[MDSIO_MAX_MODS_PER_PORT];
+  mdsio_sim_mod_t *img;
+  uint16_t img_src;
+  uint16_t img_len;
+  uint16_t img_base;
+  mdsio_sim_board_pins_t *pins;
+  struct mdsio_port *port;
+
+  // host side of the image dma
+  int master;
+  char *dma_buf;
+  uint32_t dma_handle;
+  size_t dma_size;
+  volatile uint32_t *dma_trailer;
+  uint32_t dma_last;
+  int dma_error;
+} mdsio_sim_board_t;
+
+typedef struct {
+  hal_float_t *time;
+  hal_float_t time_scale;
+} mdsio_sim_pins_t;
+
+#endif
+
@@ -34,6 +34,8 @@ static int mdsio_step_index = 0;
 
 typedef struct {
   long long accum;		// frequency generator accumulator
+  long long accum_offset;	// rebase of the hardware accumulator after a reset
+  int resync;			// flag to rebase on next read
   hal_bit_t *enable;		// pin for enable stepgen
   double old_pos_cmd;		// previous position command (counts)
   hal_s32_t *count;		// pin: captured feedback in counts
@@ -41,19 +43,29 @@ typedef struct {
   double old_scale;		// stored scale value
   double scale_recip;		// reciprocal value used for scaling
   hal_bit_t pos_mode;		// param: 1 = position mode, 0 = velocity mode
+  hal_bit_t hw_loop;		// param: 1 = position loop in the gateware
   hal_float_t *vel_cmd;		// pin: velocity command (pos units/sec)
   hal_float_t *pos_cmd;		// pin: position command (position units)
   hal_float_t *pos_fb;		// pin: position feedback (position units)
   hal_float_t freq;		// param: frequency command
+  double act_freq;		// captured hardware velocity (counts/sec)
   hal_float_t maxvel;		// param: max velocity, (pos units/sec)
   hal_float_t maxaccel;		// param: max accel (pos units/sec^2)
   int printed_error;		// flag to avoid repeated printing
+  double old_limit_scale;	// scale the limits were derived with
+  double old_maxvel;		// used to detect parameter changes
+  double old_maxaccel;
+  uint32_t old_timing_gen;
+  double max_freq;		// derived frequency limit (counts/sec)
+  double max_ac;		// derived accel limit (counts/sec^2)
+  uint32_t deltalim;		// pre-packed deltalim register
 } mdsio_step_channel_data_t;
 
 typedef struct {
   long periodns;		// makepulses function period in nanosec
   double periodfp;		// makepulses function period in seconds
   double freqscale;		// conv. factor from Hz to addval counts
+  double freqscale_recip;	// conv. factor from addval counts to Hz
   double accelscale;		// conv. Hz/sec to addval cnts/period
   long old_dtns;		// update_freq funct period in nsec
   double dt;			// update_freq period in seconds
@@ -70,12 +82,19 @@ typedef struct {
   unsigned long step_len_cnt;
   unsigned long dir_hold_cnt;
   unsigned long dir_setup_cnt;
-  mdsio_step_channel_data_t channels[MDSIO_STEP_CHANNELS];
+  double max_freq;		// frequency limit from the step timing
+  uint32_t timing_gen;		// bumped on every timing/period change
+  hal_u32_t *timestamp;		// pin: capture time of pos/vel in osc clocks
+  uint32_t old_timestamp;	// previous capture time
+  int grid_valid;		// capture grid is tracking
+  double grid_period;		// average capture interval in osc clocks
+  double skew;			// capture time against the grid in osc clocks
+  uint64_t cmd_mask;		// cmd_lo words forced and fenced in the gateware loop
+  mdsio_step_channel_data_t *channels;
 } mdsio_step_data_t;
 
 int mdsio_step_export_pins(mdsio_mod_t *module);
-void mdsio_step_read(mdsio_mod_t *mod, long period, uint32_t *data);
-void mdsio_step_write(mdsio_mod_t *mod, long period, uint32_t *data);
+static void mdsio_step_grid(mdsio_step_data_t *module_data, long period, uint32_t timestamp);
 
 // helper function - computes integeral multiple of increment that is greater or equal to value
 unsigned long ulceil(unsigned long value, unsigned long increment) {
@@ -89,12 +108,32 @@ int mdsio_step_init(mdsio_mod_t *module) {
   mdsio_port_t *port= module->port;
   mdsio_dev_t *device= port->device;
   mdsio_step_data_t *hal_data;
+  int i, word;
+
+  if (mdsio_mod_channels(module, "step", MDSIO_STEP_VERSION, MDSIO_STEP_CHANNELS, MDSIO_STEP_MAX_CHANNELS) != 0) {
+    return -EINVAL;
+  }
 
   // initialize module
   module->index = mdsio_step_index;
-  module->data_len = MDSIO_STEP_LEN;
+  module->data_len = MDSIO_STEP_LEN(module->channels);
+  // timebase (captures all channels)
+  module->rd_mask = MDSIO_MASK(3);
+  module->wr_mask = MDSIO_MASK_RANGE(0, 3);
+  module->force_mask = 0;
+  for (i=0, word=4; i<module->channels; i++, word+=MDSIO_STEP_CHAN_WORDS) {
+    // targetvel, deltalim
+    module->wr_mask |= MDSIO_MASK_RANGE(word, 2);
+    module->force_mask |= MDSIO_MASK(word);
+    // pos_hi, pos_lo, vel
+    module->rd_mask |= MDSIO_MASK_RANGE(word + 2, 3);
+    // cmd_hi, cmd_lo (loads the command), posctl. forced and fenced
+    // by mdsio_step_write() while the channel runs the gateware loop
+    module->wr_mask |= MDSIO_MASK_RANGE(word + 5, 3);
+  }
   module->proc_read = mdsio_step_read;
   module->proc_write = mdsio_step_write;
+  module->proc_resync = mdsio_step_resync;
   mdsio_step_index++;
 
   if ((hal_data = hal_malloc(sizeof(mdsio_step_data_t))) == 0) {
@@ -104,15 +143,19 @@ int mdsio_step_init(mdsio_mod_t *module) {
   memset(hal_data, 0, sizeof(mdsio_step_data_t));
   module->hal_data = hal_data;
 
+  if ((hal_data->channels = hal_malloc(module->channels * sizeof(mdsio_step_channel_data_t))) == 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.step.%d: ERROR: hal_malloc() failed\n", device->name, port->index, module->index);
+    return -EIO;
+  }
+  memset(hal_data->channels, 0, module->channels * sizeof(mdsio_step_channel_data_t));
+
   // calculate time constants
   hal_data->periodns = 1000000000L / device->osc_freq;
   hal_data->periodfp = 1.0 / (double)device->osc_freq;
   hal_data->freqscale = (1LL << PICKOFF) * hal_data->periodfp;
+  hal_data->freqscale_recip = 1.0 / hal_data->freqscale;
   hal_data->accelscale = hal_data->freqscale * hal_data->periodfp * ACCEL_DIV;
   hal_data->max_ac_lim = (ACCEL_DIV - 1) / hal_data->accelscale;
-  hal_data->old_dtns = 1000000L;
-  hal_data->dt = hal_data->old_dtns * 0.000000001;
-  hal_data->recip_dt = 1.0 / hal_data->dt;
 
   // register pins
   if (mdsio_step_export_pins(module) != 0) {
@@ -162,8 +205,16 @@ int mdsio_step_export_pins(mdsio_mod_t *module) {
   module_data->old_step_space = ~0;
   module_data->old_dir_hold = ~0;
   module_data->old_dir_setup = ~0;
+  module_data->old_dtns = 0;
+
+  // export pin for the capture time
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(module_data->timestamp), comp_id, "%s.%d.step.%d.timestamp", dname, pidx, midx)) != 0) {
+    return err;
+  }
+  *(module_data->timestamp) = 0;
+  module_data->grid_valid = 0;
 
-  for(i=0; i<MDSIO_STEP_CHANNELS; i++) {
+  for(i=0; i<module->channels; i++) {
     data = &(module_data->channels[i]);
 
     // export pin for counts
@@ -178,6 +229,10 @@ int mdsio_step_export_pins(mdsio_mod_t *module) {
     if ((err = hal_param_bit_newf(HAL_RW, &(data->pos_mode), comp_id, "%s.%d.step.%d.ch%d-pos-mode", dname, pidx, midx, i)) != 0) {
       return err;
     }
+    // export param for the gateware position loop
+    if ((err = hal_param_bit_newf(HAL_RW, &(data->hw_loop), comp_id, "%s.%d.step.%d.ch%d-hw-loop", dname, pidx, midx, i)) != 0) {
+      return err;
+    }
     // export pin for command
     if ((err = hal_pin_float_newf(HAL_IN, &(data->pos_cmd), comp_id, "%s.%d.step.%d.ch%d-pos-cmd", dname, pidx, midx, i)) != 0) {
       return err;
@@ -214,6 +269,8 @@ int mdsio_step_export_pins(mdsio_mod_t *module) {
     data->maxvel = 0.0;
     data->maxaccel = 0.0;
     data->pos_mode = 0;
+    // the gateware loop is opt-in until it is proven on hardware
+    data->hw_loop = 0;
 
     // accumulator gets a half step offset, so it will step half
     // way between integer positions, not at the integer positions
@@ -234,19 +291,55 @@ int mdsio_step_export_pins(mdsio_mod_t *module) {
   return 0;
 }
 
+// tracks the capture times against a steady grid at the average
+// capture interval, skew is how late this capture came on the grid
+static void mdsio_step_grid(mdsio_step_data_t *module_data, long period, uint32_t timestamp) {
+  double nominal = (double)period * 1e-9 / module_data->periodfp;
+  double delta = (double)(int32_t)(timestamp - module_data->old_timestamp);
+
+  module_data->old_timestamp = timestamp;
+
+  // restart on the first capture, after a board reset or a lost cycle
+  if (!module_data->grid_valid || fabs(delta - nominal) > 0.5 * nominal) {
+    module_data->grid_valid = 1;
+    module_data->grid_period = nominal;
+    module_data->skew = 0.0;
+    return;
+  }
+
+  // the leak keeps the grid on the captures over the long run
+  module_data->grid_period += (delta - module_data->grid_period) / (1 << MDSIO_STEP_GRID_SHIFT);
+  module_data->skew += delta - module_data->grid_period;
+  module_data->skew -= module_data->skew / (1 << MDSIO_STEP_GRID_SHIFT);
+}
+
 void mdsio_step_read(mdsio_mod_t *mod, long period, uint32_t *data) {
   mdsio_step_data_t *module_data = mod->hal_data;
   mdsio_step_channel_data_t *hal_data;
   int i, word;
-  long long int accum_h, accum_l;
+  long long int accum_h, accum_l, accum;
+
+  // reading the timebase captured accumulators and velocities
+  *(module_data->timestamp) = data[3];
+  mdsio_step_grid(module_data, period, data[3]);
 
-  for (i=0, word=3; i<MDSIO_STEP_CHANNELS; i++, word+=4) {
+  for (i=0, word=4; i<mod->channels; i++, word+=MDSIO_STEP_CHAN_WORDS) {
     hal_data = &(module_data->channels[i]);
 
     // read accu
     accum_h = data[word + 2];
     accum_l = data[word + 3];
-    hal_data->accum = (accum_h << 32) + accum_l;
+    accum = (accum_h << 32) + accum_l;
+
+    // velocity the ramp had at the capture
+    hal_data->act_freq = (double)(int32_t)data[word + 4] * module_data->freqscale_recip;
+
+    // handle board reset, keep position continuous
+    if (hal_data->resync) {
+      hal_data->resync = 0;
+      hal_data->accum_offset = hal_data->accum - accum;
+    }
+    hal_data->accum = accum + hal_data->accum_offset;
 
     // compute integer counts
     *(hal_data->count) = hal_data->accum >> PICKOFF;
@@ -271,70 +364,140 @@ void mdsio_step_read(mdsio_mod_t *mod, long period, uint32_t *data) {
   }
 }
 
-void mdsio_step_write(mdsio_mod_t *mod, long period, uint32_t *data) {
-  mdsio_step_data_t *module_data = mod->hal_data;
-  mdsio_port_t *port= mod->port;
-  mdsio_dev_t *device= port->device;
-  mdsio_step_channel_data_t *hal_data;
-  int i, word;
+// step timing params and thread period
+static void mdsio_step_timing(mdsio_step_data_t *module_data, long period) {
   long min_step_period;
-  double pos_cmd, vel_cmd, curr_pos, curr_vel, avg_v, max_freq, max_ac;
-  double match_ac, match_time, est_out, est_cmd, est_err, dp, dv, new_vel;
-  double desired_freq;
 
-  memset(data, 0, MDSIO_STEP_LEN);
-
-  // process timing parameters
-  if (module_data->step_len != module_data->old_step_len) {
-    // must be non-zero
-    if (module_data->step_len == 0) {
-      module_data->step_len = 1;
-    }
-    // make integer multiple of periodns
-    module_data->old_step_len = ulceil(module_data->step_len, module_data->periodns);
-    module_data->step_len = module_data->old_step_len;
-    module_data->step_len_cnt = module_data->step_len / module_data->periodns;
+  // must be non-zero
+  if (module_data->step_len == 0) {
+    module_data->step_len = 1;
   }
+  // make integer multiple of periodns
+  module_data->step_len = ulceil(module_data->step_len, module_data->periodns);
+  module_data->step_len_cnt = module_data->step_len / module_data->periodns;
 
-  if (module_data->step_space != module_data->old_step_space) {
-    // make integer multiple of periodns
-    module_data->old_step_space = ulceil(module_data->step_space, module_data->periodns);
-    module_data->step_space = module_data->old_step_space;
+  // make integer multiple of periodns
+  module_data->step_space = ulceil(module_data->step_space, module_data->periodns);
+
+  // make integer multiple of periodns
+  module_data->dir_setup = ulceil(module_data->dir_setup, module_data->periodns);
+  module_data->dir_setup_cnt = module_data->dir_setup / module_data->periodns;
+
+  if ((module_data->dir_hold + module_data->dir_setup) == 0) {
+    // dirdelay must be non-zero
+    module_data->dir_hold = 1;
   }
+  module_data->dir_hold = ulceil(module_data->dir_hold, module_data->periodns);
+  module_data->dir_hold_cnt = module_data->dir_hold / module_data->periodns;
+
+  // keep the validated values
+  module_data->old_step_len = module_data->step_len;
+  module_data->old_step_space = module_data->step_space;
+  module_data->old_dir_setup = module_data->dir_setup;
+  module_data->old_dir_hold = module_data->dir_hold;
+
+  // calculate frequency limit
+  min_step_period = module_data->step_len + module_data->step_space;
+  module_data->max_freq = 1.0 / (min_step_period * 0.000000001);
+
+  // dT is the period of this thread, used for the position loop
+  module_data->dt = period * 0.000000001;
+  // calc the reciprocal once here, to avoid multiple divides later
+  module_data->recip_dt = 1.0 / module_data->dt;
+
+  // channel limits depend on all of this
+  module_data->timing_gen++;
+}
 
-  if (module_data->dir_setup != module_data->old_dir_setup) {
-    // make integer multiple of periodns
-    module_data->old_dir_setup = ulceil(module_data->dir_setup, module_data->periodns);
-    module_data->dir_setup = module_data->old_dir_setup;
-    module_data->dir_setup_cnt = module_data->dir_setup / module_data->periodns;
+// velocity and accel limits of one channel
+static void mdsio_step_limits(mdsio_mod_t *mod, mdsio_step_channel_data_t *hal_data) {
+  mdsio_step_data_t *module_data = mod->hal_data;
+  mdsio_port_t *port= mod->port;
+  mdsio_dev_t *device= port->device;
+  double max_freq, max_ac, desired_freq;
+
+  max_freq = module_data->max_freq;
+
+  // check for user specified frequency limit parameter
+  if (hal_data->maxvel <= 0.0) {
+    // set to zero if negative
+    hal_data->maxvel = 0.0;
+  } else {
+    // parameter is non-zero, compare to max_freq
+    desired_freq = hal_data->maxvel * fabs(hal_data->pos_scale);
+    if (desired_freq > max_freq) {
+      // parameter is too high, complain about it
+      if (!hal_data->printed_error) {
+        rtapi_print_msg(RTAPI_MSG_ERR, "%s.step.%d: The requested maximum velocity of %d steps/sec is too high.\n", device->name, port->index, (int)desired_freq);
+        rtapi_print_msg(RTAPI_MSG_ERR, "%s.step.%d: The maximum possible frequency is %d steps/second\n", device->name, port->index, (int)max_freq);
+        hal_data->printed_error = 1;
+      }
+      // parameter is too high, limit it
+      hal_data->maxvel = max_freq / fabs(hal_data->pos_scale);
+    } else {
+      // lower max_freq to match parameter
+      max_freq = hal_data->maxvel * fabs(hal_data->pos_scale);
+    }
   }
 
-  if (module_data->dir_hold != module_data->old_dir_hold) {
-    if ((module_data->dir_hold + module_data->dir_setup) == 0) {
-      // dirdelay must be non-zero
-      module_data->dir_hold = 1;
+  // set internal accel limit to its absolute max, which is
+  // zero to full speed in one thread period
+  max_ac = max_freq * module_data->recip_dt;
+
+  // check hardware limit
+  if (max_ac > module_data->max_ac_lim) max_ac = module_data->max_ac_lim;
+
+  // check for user specified accel limit parameter
+  if (hal_data->maxaccel <= 0.0) {
+    // set to zero if negative
+    hal_data->maxaccel = 0.0;
+  } else {
+    // parameter is non-zero, compare to max_ac
+    if ((hal_data->maxaccel * fabs(hal_data->pos_scale)) > max_ac) {
+      // parameter is too high, lower it
+      hal_data->maxaccel = max_ac / fabs(hal_data->pos_scale);
+    } else {
+      // lower limit to match parameter
+      max_ac = hal_data->maxaccel * fabs(hal_data->pos_scale);
     }
-    module_data->old_dir_hold = ulceil(module_data->dir_hold, module_data->periodns);
-    module_data->dir_hold = module_data->old_dir_hold;
-    module_data->dir_hold_cnt = module_data->dir_hold / module_data->periodns;
   }
 
-  // recalc constants related to the period of this funct
-  // only recalc constants if period changes
-  if (period != module_data->old_dtns) {
-    // get ready to detect future period changes
-    module_data->old_dtns = period;
-    // dT is the period of this thread, used for the position loop
-    module_data->dt = period * 0.000000001;
-    // calc the reciprocal once here, to avoid multiple divides later
-    module_data->recip_dt = 1.0 / module_data->dt;
+  // keep the clamped values
+  hal_data->old_maxvel = hal_data->maxvel;
+  hal_data->old_maxaccel = hal_data->maxaccel;
+
+  hal_data->max_freq = max_freq;
+  hal_data->max_ac = max_ac;
+  hal_data->deltalim = max_ac * module_data->accelscale;
+}
+
+void mdsio_step_write(mdsio_mod_t *mod, long period, uint32_t *data) {
+  mdsio_step_data_t *module_data = mod->hal_data;
+  mdsio_step_channel_data_t *hal_data;
+  int i, word;
+  double pos_cmd, vel_cmd, curr_pos, curr_vel, avg_v, max_freq, max_ac;
+  double match_ac, match_time, est_out, est_cmd, est_err, dp, dv, new_vel;
+  double maxvel;
+  long long cmd;
+  uint64_t cmd_mask;
+
+  memset(data, 0, mod->data_len);
+
+  // rebuild timing registers and limits only when timing or period changes
+  if (MDSIO_CHANGED(module_data->old_step_len, module_data->step_len) |
+      MDSIO_CHANGED(module_data->old_step_space, module_data->step_space) |
+      MDSIO_CHANGED(module_data->old_dir_hold, module_data->dir_hold) |
+      MDSIO_CHANGED(module_data->old_dir_setup, module_data->dir_setup) |
+      MDSIO_CHANGED(module_data->old_dtns, period)) {
+    mdsio_step_timing(module_data, period);
   }
 
   data[0] = module_data->step_len_cnt;
   data[1] = module_data->dir_hold_cnt;
   data[2] = module_data->dir_setup_cnt;
 
-  for (i=0, word=3; i<MDSIO_STEP_CHANNELS; i++, word+=4) {
+  cmd_mask = 0;
+  for (i=0, word=4; i<mod->channels; i++, word+=MDSIO_STEP_CHAN_WORDS) {
     hal_data = &(module_data->channels[i]);
 
     // check for scale change
@@ -351,56 +514,18 @@ void mdsio_step_write(mdsio_mod_t *mod, long period, uint32_t *data) {
       hal_data->scale_recip = (1.0 / (1LL << PICKOFF)) / hal_data->pos_scale;
     }
 
-    // calculate frequency limit
-    min_step_period = module_data->step_len + module_data->step_space;
-    max_freq = 1.0 / (min_step_period * 0.000000001);
-
-    // check for user specified frequency limit parameter
-    if (hal_data->maxvel <= 0.0) {
-      // set to zero if negative
-      hal_data->maxvel = 0.0;
-    } else {
-      // parameter is non-zero, compare to max_freq
-      desired_freq = hal_data->maxvel * fabs(hal_data->pos_scale);
-      if (desired_freq > max_freq) {
-        // parameter is too high, complain about it
-        if (!hal_data->printed_error) {
-          rtapi_print_msg(RTAPI_MSG_ERR, "%s.step.%d: The requested maximum velocity of %d steps/sec is too high.\n", device->name, port->index, (int)desired_freq);
-          rtapi_print_msg(RTAPI_MSG_ERR, "%s.step.%d: The maximum possible frequency is %d steps/second\n", device->name, port->index, (int)max_freq);
-          hal_data->printed_error = 1;
-        }
-        // parameter is too high, limit it
-        hal_data->maxvel = max_freq / fabs(hal_data->pos_scale);
-      } else {
-        // lower max_freq to match parameter
-        max_freq = hal_data->maxvel * fabs(hal_data->pos_scale);
-      }
-    }
-
-    // set internal accel limit to its absolute max, which is
-    // zero to full speed in one thread period
-    max_ac = max_freq * module_data->recip_dt;
-
-    // check hardware limit
-    if (max_ac > module_data->max_ac_lim) max_ac = module_data->max_ac_lim;
-
-    // check for user specified accel limit parameter
-    if (hal_data->maxaccel <= 0.0) {
-      // set to zero if negative
-      hal_data->maxaccel = 0.0;
-    } else {
-      // parameter is non-zero, compare to max_ac
-      if ((hal_data->maxaccel * fabs(hal_data->pos_scale)) > max_ac) {
-        // parameter is too high, lower it
-        hal_data->maxaccel = max_ac / fabs(hal_data->pos_scale);
-      } else {
-        // lower limit to match parameter
-        max_ac = hal_data->maxaccel * fabs(hal_data->pos_scale);
-      }
+    // recalc limits only if their inputs change
+    if (MDSIO_CHANGED(hal_data->old_limit_scale, hal_data->pos_scale) |
+        MDSIO_CHANGED(hal_data->old_maxvel, hal_data->maxvel) |
+        MDSIO_CHANGED(hal_data->old_maxaccel, hal_data->maxaccel) |
+        MDSIO_CHANGED(hal_data->old_timing_gen, module_data->timing_gen)) {
+      mdsio_step_limits(mod, hal_data);
     }
+    max_freq = hal_data->max_freq;
+    max_ac = hal_data->max_ac;
 
-    // calculate new deltalim
-    data[word + 1] = max_ac * module_data->accelscale;
+    // deltalim
+    data[word + 1] = hal_data->deltalim;
 
     // test for disabled stepgen
     if (*hal_data->enable == 0) {
@@ -416,6 +541,40 @@ void mdsio_step_write(mdsio_mod_t *mod, long period, uint32_t *data) {
 
     // at this point, all scaling, limits, and other parameter
     // changes have been handled - time for the main control
+    if (hal_data->pos_mode && hal_data->hw_loop) {
+      // the gateware closes the loop, it gets the position command
+      // and the commanded velocity as feed forward
+      pos_cmd = *hal_data->pos_cmd * hal_data->pos_scale;
+      vel_cmd = (pos_cmd - hal_data->old_pos_cmd) * module_data->recip_dt;
+      hal_data->old_pos_cmd = pos_cmd;
+
+      // apply frequency limit
+      if (vel_cmd > max_freq) {
+        vel_cmd = max_freq;
+      } else if (vel_cmd < -max_freq) {
+        vel_cmd = -max_freq;
+      }
+      hal_data->freq = vel_cmd;
+
+      // command in accumulator units, with the one-half step offset
+      // and relative to the hardware accumulator
+      cmd = (long long)floor(pos_cmd * (double)(1LL << PICKOFF) + 0.5) + (1LL << (PICKOFF - 1)) - hal_data->accum_offset;
+      maxvel = max_freq * module_data->freqscale;
+      if (maxvel > MDSIO_STEP_MAXVEL_MASK) {
+        maxvel = MDSIO_STEP_MAXVEL_MASK;
+      }
+
+      data[word + 0] = vel_cmd * module_data->freqscale;
+      data[word + 5] = (uint32_t)(cmd >> 32);
+      data[word + 6] = (uint32_t)cmd;
+      data[word + 7] = MDSIO_STEP_POS_MODE | (uint32_t)maxvel;
+
+      // the gateware extrapolates the command, reload it every cycle.
+      // cmd_hi must reach the board first, also on a wc mapping
+      cmd_mask |= MDSIO_MASK(word + 6);
+      continue;
+    }
+
     if (hal_data->pos_mode) {
       // calculate position command in counts
       pos_cmd = *hal_data->pos_cmd * hal_data->pos_scale;
@@ -427,8 +586,12 @@ void mdsio_step_write(mdsio_mod_t *mod, long period, uint32_t *data) {
       // convert from fixed point to double, after subtracting
       // the one-half step offset
       curr_pos = (hal_data->accum - (1LL << (PICKOFF - 1))) * (1.0 / (1LL << PICKOFF));
-      // get velocity in counts/sec
-      curr_vel = hal_data->freq;
+      // get velocity in counts/sec, as captured with the position.
+      // the last command is not reached yet while the ramp runs
+      curr_vel = hal_data->act_freq;
+      // refer the position to the capture grid, a capture delayed
+      // by thread jitter has already moved on by curr_vel * skew
+      curr_pos -= curr_vel * module_data->skew * module_data->periodfp;
 
       // At this point we have good values for pos_cmd, curr_pos,
       // vel_cmd, curr_vel, max_freq and max_ac, all in counts,
@@ -521,5 +684,24 @@ void mdsio_step_write(mdsio_mod_t *mod, long period, uint32_t *data) {
     // calculate new addval
     data[word + 0] = hal_data->freq * module_data->freqscale;
   }
+
+  // host loop channels write their zero command only once
+  if (cmd_mask != module_data->cmd_mask) {
+    mdsio_mod_set_force(mod, (mod->force_mask & ~module_data->cmd_mask) | cmd_mask, cmd_mask);
+    module_data->cmd_mask = cmd_mask;
+  }
 }
 
+void mdsio_step_resync(mdsio_mod_t *mod) {
+  mdsio_step_data_t *module_data = mod->hal_data;
+  int i;
+
+  // hardware accumulators and frequencies restarted from zero,
+  // the timebase too
+  module_data->grid_valid = 0;
+  for (i=0; i<mod->channels; i++) {
+    module_data->channels[i].resync = 1;
+    module_data->channels[i].freq = 0;
+    module_data->channels[i].act_freq = 0;
+  }
+}
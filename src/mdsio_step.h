@@ -21,10 +21,28 @@
 #include "mdsio.h"
 
 #define MDSIO_STEP_TYPE 5
-#define MDSIO_STEP_LEN 76
+#define MDSIO_STEP_VERSION 2
 
+// default and max channel count, limited by the module mask
 #define MDSIO_STEP_CHANNELS 4
+#define MDSIO_STEP_MAX_CHANNELS 7
+
+// timing words and the timebase (reading it captures all channels),
+// then per channel: targetvel, deltalim, pos_hi, pos_lo, vel, cmd_hi,
+// cmd_lo, posctl
+#define MDSIO_STEP_CHAN_WORDS 8
+#define MDSIO_STEP_LEN(channels) ((4 + MDSIO_STEP_CHAN_WORDS * (channels)) << 2)
+
+// posctl: position mode in the gateware, velocity limit in addval units
+#define MDSIO_STEP_POS_MODE (1U << 31)
+#define MDSIO_STEP_MAXVEL_MASK 0x7fffffff
+
+// filter of the capture grid in the host loop, 2^n cycles
+#define MDSIO_STEP_GRID_SHIFT 6
 
 int mdsio_step_init(mdsio_mod_t *module);
+void mdsio_step_read(mdsio_mod_t *mod, long period, uint32_t *data);
+void mdsio_step_write(mdsio_mod_t *mod, long period, uint32_t *data);
+void mdsio_step_resync(mdsio_mod_t *mod);
 
 #endif
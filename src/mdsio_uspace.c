@@ -0,0 +1,336 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// userspace backend for uspace/PREEMPT_RT builds. the boards are
+// found in sysfs and BAR0 is mapped through the resource0 file,
+// so the register access in the rt thread is plain memory access.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+
+#include "rtapi.h"
+#include "rtapi_app.h"
+#include "rtapi_string.h"
+
+#include "hal.h"
+
+#include "mdsio_uspace.h"
+#include "mdsio.h"
+#include "mdsio_img.h"
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Sascha Ittner <sascha.ittner@modusoft.de>");
+MODULE_DESCRIPTION("Userspace driver for mdsIO on FPGA based pci boards");
+
+static mdsio_uspace_board_t mdsio_uspace_boards[MDSIO_BOARD_MAX];
+static int mdsio_uspace_board_count = 0;
+
+uint32_t mdsio_uspace_read_conf(mdsio_port_t *port, int word) {
+  mdsio_uspace_board_t *board = (mdsio_uspace_board_t *)port->device_data;
+  return ((volatile uint32_t *)(board->base))[word];
+}
+
+void mdsio_uspace_request_data(mdsio_port_t *port) {
+  mdsio_uspace_board_t *board = (mdsio_uspace_board_t *)port->device_data;
+
+  // without process image the registers are captured while reading
+  if (port->img_len == 0) {
+    return;
+  }
+
+  // paced by the board timer, only keep the snapshot mode and note the arrival
+  if (port->img_pace) {
+    *(volatile uint32_t *)(board->base + port->img_ctrl) = port->img_trig & ~MDSIO_IMG_CTRL_TRIG;
+    port->img_arrival = *(volatile uint32_t *)(board->base + port->img_time);
+    port->img_due = mdsio_img_due(port, rtapi_get_time());
+    return;
+  }
+
+  // no bus master buffer in userspace, the image is read by mmio
+  *(volatile uint32_t *)(board->base + port->img_ctrl) = port->img_trig;
+}
+
+static void mdsio_uspace_wait_image(mdsio_uspace_board_t *board, mdsio_port_t *port) {
+  long long start, now, poll, timeout;
+  uint32_t ctrl;
+
+  // wait for the next timer snapshot, its sequence number shows up with the end of it.
+  // the uncached ctrl read stalls the bus, so it is polled from shortly before
+  // the snapshot is due only, and once more at the timeout.
+  start = rtapi_get_time();
+  timeout = start + port->img_timeout;
+  poll = port->img_due - MDSIO_IMG_PACE_POLL_MARGIN;
+  do {
+    now = rtapi_get_time();
+    if (now >= poll || now >= timeout) {
+      ctrl = *(volatile uint32_t *)(board->base + port->img_ctrl);
+      if (MDSIO_IMG_STAT_SEQ(ctrl) != MDSIO_IMG_TRAILER_SEQ(port->img_trailer) && !(ctrl & MDSIO_IMG_STAT_BUSY)) {
+        port->img_wait = rtapi_get_time() - start;
+        return;
+      }
+      poll = now + MDSIO_IMG_PACE_POLL_INTERVAL;
+    }
+  } while (now < timeout);
+  port->img_wait = now - start;
+
+  // late, take a snapshot now as in the unpaced mode
+  port->img_late = 1;
+  *(volatile uint32_t *)(board->base + port->img_ctrl) = port->img_trig;
+}
+
+void mdsio_uspace_read_data(mdsio_port_t *port) {
+  mdsio_uspace_board_t *board = (mdsio_uspace_board_t *)port->device_data;
+  mdsio_span_t *span = port->rd_spans;
+  int count = port->rd_span_count;
+  int size;
+  uint32_t *buffer;
+  volatile uint32_t *src;
+  volatile char *base;
+
+  // fetch from process image if available
+  base = board->base + port->data_offset;
+  port->img_late = 0;
+  if (port->img_len > 0) {
+    base += port->img_offset - port->img_src;
+    if (port->img_pace) {
+      mdsio_uspace_wait_image(board, port);
+    }
+  }
+
+  // dword accesses only, libc memcpy may split or merge them
+  for (; count > 0; count--, span++) {
+    size = span->len;
+    buffer = (uint32_t *)(port->input_data + span->offset);
+    src = (volatile uint32_t *)(base + span->offset);
+
+    while (size > 0) {
+      *(buffer++) = *(src++);
+      size -= 4;
+    }
+  }
+
+  // snapshot time and trailer behind the image
+  if (port->img_len > 0) {
+    src = (volatile uint32_t *)(board->base + port->img_offset + port->img_len);
+    port->img_ts = src[0];
+    port->img_trailer = src[1];
+  }
+}
+
+void mdsio_uspace_write_data(mdsio_port_t *port) {
+  mdsio_uspace_board_t *board = (mdsio_uspace_board_t *)port->device_data;
+  mdsio_span_t *span = port->wr_dirty;
+  int count = port->wr_dirty_count;
+  int size;
+  uint32_t *buffer;
+  volatile uint32_t *dest;
+
+  for (; count > 0; count--, span++) {
+    size = span->len;
+    buffer = (uint32_t *)(port->output_data + span->offset);
+    dest = (volatile uint32_t *)(board->base + port->data_offset + span->offset);
+
+    while (size > 0) {
+      *(dest++) = *(buffer++);
+      size -= 4;
+    }
+  }
+}
+
+static mdsio_dev_t mdsio_device = {
+  .name = MDSIO_USPACE_NAME,
+  .osc_freq = MDSIO_BOARD_OSC_FREQ,
+  .proc_read_conf = mdsio_uspace_read_conf,
+  .proc_request_input = mdsio_uspace_request_data,
+  .proc_read_input = mdsio_uspace_read_data,
+  .proc_write_output = mdsio_uspace_write_data
+};
+
+static int mdsio_uspace_read_id(const char *dev, const char *attr, unsigned int *val) {
+  char path[MDSIO_USPACE_PATH_LEN];
+  FILE *f;
+  int ret;
+
+  rtapi_snprintf(path, sizeof(path), "%s/%s/%s", MDSIO_USPACE_SYSFS, dev, attr);
+  f = fopen(path, "r");
+  if (f == NULL) {
+    return -errno;
+  }
+  ret = fscanf(f, "%x", val);
+  fclose(f);
+
+  return (ret == 1) ? 0 : -EINVAL;
+}
+
+static int mdsio_uspace_match(const char *dev) {
+  unsigned int vid, pid, sub_vid, sub_pid;
+
+  if (mdsio_uspace_read_id(dev, "vendor", &vid) < 0 ||
+      mdsio_uspace_read_id(dev, "device", &pid) < 0 ||
+      mdsio_uspace_read_id(dev, "subsystem_vendor", &sub_vid) < 0 ||
+      mdsio_uspace_read_id(dev, "subsystem_device", &sub_pid) < 0) {
+    return 0;
+  }
+
+  return vid == MDSIO_PCILITE_VID && pid == MDSIO_PCILITE_PID &&
+    sub_vid == MDSIO_PCILITE_SUB_VID && sub_pid == MDSIO_PCILITE_SUB_PID;
+}
+
+static int mdsio_uspace_enable(mdsio_uspace_board_t *board) {
+  char path[MDSIO_USPACE_PATH_LEN];
+  int fd, ret;
+
+  rtapi_snprintf(path, sizeof(path), "%s/enable", board->path);
+  fd = open(path, O_WRONLY);
+  if (fd < 0) {
+    return -errno;
+  }
+  ret = write(fd, "1", 1);
+  close(fd);
+
+  return (ret == 1) ? 0 : -EIO;
+}
+
+static int mdsio_uspace_probe(mdsio_uspace_board_t *board) {
+  char path[MDSIO_USPACE_PATH_LEN];
+  int err;
+
+  // Enabling PCI device
+  err = mdsio_uspace_enable(board);
+  if (err < 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: Enabling PCI device %s failed\n", MDSIO_USPACE_NAME, board->path);
+    goto fail0;
+  }
+
+  // Map controller memory area, page tables are populated and locked
+  // here, so the rt thread never faults on the registers. the mapping
+  // is uncached: sysfs offers resource0_wc for prefetchable bars only,
+  // and BAR0 is not marked prefetchable. the kernel driver may still map
+  // its output alias with ioremap_wc(), as it knows the register semantics.
+  rtapi_snprintf(path, sizeof(path), "%s/resource0", board->path);
+  board->fd = open(path, O_RDWR | O_SYNC);
+  if (board->fd < 0) {
+    err = -errno;
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: Unable to open %s\n", MDSIO_USPACE_NAME, path);
+    goto fail0;
+  }
+  board->map = mmap(NULL, MDSIO_USPACE_MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, board->fd, 0);
+  if (board->map == MAP_FAILED) {
+    err = -errno;
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: MMAP failed\n", MDSIO_USPACE_NAME);
+    goto fail1;
+  }
+  if (mlock(board->map, MDSIO_USPACE_MAP_SIZE) != 0) {
+    rtapi_print_msg(RTAPI_MSG_WARN, "%s: Unable to lock board mapping\n", MDSIO_USPACE_NAME);
+  }
+  board->base = board->map;
+  rtapi_print_msg(RTAPI_MSG_INFO, "%s: Board %s mapped to %p.\n", MDSIO_USPACE_NAME, board->path, board->map);
+
+  // create mdsio port
+  board->port = mdsio_create_port(&mdsio_device, board);
+  if (board->port == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: mdsio_create_port failed\n", MDSIO_USPACE_NAME);
+    err = -ENOMEM;
+    goto fail2;
+  }
+
+  return 0;
+
+fail2:
+  munmap(board->map, MDSIO_USPACE_MAP_SIZE);
+fail1:
+  close(board->fd);
+fail0:
+  return err;
+}
+
+static void mdsio_uspace_remove(mdsio_uspace_board_t *board) {
+  mdsio_destroy_port(board->port);
+  munmap(board->map, MDSIO_USPACE_MAP_SIZE);
+  close(board->fd);
+}
+
+static int mdsio_uspace_scan(void) {
+  mdsio_uspace_board_t *board;
+  struct dirent *ent;
+  DIR *dir;
+
+  dir = opendir(MDSIO_USPACE_SYSFS);
+  if (dir == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: Unable to open %s\n", MDSIO_USPACE_NAME, MDSIO_USPACE_SYSFS);
+    return -errno;
+  }
+
+  while ((ent = readdir(dir)) != NULL && mdsio_uspace_board_count < MDSIO_BOARD_MAX) {
+    if (ent->d_name[0] == '.' || !mdsio_uspace_match(ent->d_name)) {
+      continue;
+    }
+
+    board = &mdsio_uspace_boards[mdsio_uspace_board_count];
+    memset(board, 0, sizeof(mdsio_uspace_board_t));
+    rtapi_snprintf(board->path, sizeof(board->path), "%s/%s", MDSIO_USPACE_SYSFS, ent->d_name);
+    if (mdsio_uspace_probe(board) == 0) {
+      mdsio_uspace_board_count++;
+    }
+  }
+  closedir(dir);
+
+  return 0;
+}
+
+int rtapi_app_main(void) {
+  int err = 0;
+  int i;
+
+  rtapi_print_msg(RTAPI_MSG_INFO, "%s: loading mdsIO driver version %s\n", MDSIO_USPACE_NAME, MDSIO_USPACE_VERSION);
+
+  err = mdsio_init(&mdsio_device);
+  if (err < 0) {
+    return err;
+  }
+
+  err = mdsio_uspace_scan();
+  if (err != 0 || mdsio_uspace_board_count == 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: no board found\n", MDSIO_USPACE_NAME);
+    for (i = 0; i < mdsio_uspace_board_count; i++) {
+      mdsio_uspace_remove(&mdsio_uspace_boards[i]);
+    }
+    mdsio_exit(&mdsio_device);
+    return -ENODEV;
+  }
+
+  mdsio_ready(&mdsio_device);
+  return 0;
+}
+
+void rtapi_app_exit(void) {
+  int i;
+
+  for (i = 0; i < mdsio_uspace_board_count; i++) {
+    mdsio_uspace_remove(&mdsio_uspace_boards[i]);
+  }
+  mdsio_uspace_board_count = 0;
+  rtapi_print_msg(RTAPI_MSG_INFO, "%s: driver unloaded\n", MDSIO_USPACE_NAME);
+  mdsio_exit(&mdsio_device);
+}
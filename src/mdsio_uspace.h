@@ -0,0 +1,41 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+#ifndef _MDSIO_USPACE_H_
+#define _MDSIO_USPACE_H_
+
+#include "mdsio_board.h"
+
+#define MDSIO_USPACE_VERSION "1.0.0"
+#define MDSIO_USPACE_NAME    "mdsio_uspace"
+
+#define MDSIO_USPACE_SYSFS "/sys/bus/pci/devices"
+#define MDSIO_USPACE_PATH_LEN 256
+
+// only the first register alias of BAR0 is mapped
+#define MDSIO_USPACE_MAP_SIZE MDSIO_BOARD_REG_SIZE
+
+typedef struct mdsio_uspace_board_t {
+  char path[MDSIO_USPACE_PATH_LEN];
+  int fd;
+  void *map;
+  volatile char *base;
+  struct mdsio_port *port;
+} mdsio_uspace_board_t;
+
+#endif
+
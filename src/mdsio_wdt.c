@@ -31,21 +31,29 @@ typedef struct {
   hal_bit_t *com_error;
   hal_bit_t *reset_error;
   hal_u32_t *rand;
+  hal_u32_t *board_resets;
   uint32_t cmp_rand;
+  int boot_ack;
+  int layout_error;
 } mdsio_wdt_data_t;
 
 int mdsio_wdt_export_pins(mdsio_mod_t *module);
-void mdsio_wdt_read(mdsio_mod_t *mod, long period, uint32_t *data);
-void mdsio_wdt_write(mdsio_mod_t *mod, long period, uint32_t *data);
 
 int mdsio_wdt_init(mdsio_mod_t *module) {
   mdsio_port_t *port= module->port;
   mdsio_dev_t *device= port->device;
   mdsio_wdt_data_t *hal_data;
 
+  if (mdsio_mod_channels(module, "wdt", MDSIO_WDT_VERSION, 1, 1) != 0) {
+    return -EINVAL;
+  }
+
   // initialize module
   module->index = mdsio_wdt_index;
   module->data_len = MDSIO_WDT_LEN;
+  module->rd_mask = MDSIO_MASK(0);
+  module->wr_mask = MDSIO_MASK(0);
+  module->force_mask = MDSIO_MASK(0);
   module->proc_read = mdsio_wdt_read;
   module->proc_write = mdsio_wdt_write;
   mdsio_wdt_index++;
@@ -92,13 +100,20 @@ int mdsio_wdt_export_pins(mdsio_mod_t *module) {
     return err;
   }
 
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(data->board_resets), comp_id, "%s.%d.wdt.%d.board-resets", dname, pidx, midx)) != 0) {
+    return err;
+  }
+
   // initialize data
   *(data->enable) = 0;
   *(data->com_error) = 0;
   *(data->reset_error) = 0;
   *(data->rand) = 0;
+  *(data->board_resets) = 0;
 
   data->cmp_rand = 0;
+  data->boot_ack = 0;
+  data->layout_error = 0;
 
   return 0;
 }
@@ -108,16 +123,35 @@ void mdsio_wdt_read(mdsio_mod_t *mod, long period, uint32_t *data) {
   mdsio_port_t *port= mod->port;
   mdsio_dev_t *device= port->device;
   hal_bit_t com_error;
+  int boot;
 
   *(hal_data->rand) = data[0] & 0xffff;
 
+  // detect board reset by the boot flag, or by the lfsr restarting at
+  // its seed for gateware without the flag. the watchdog is decoded
+  // first, so the other modules of this port see the resync in the same cycle.
+  boot = (data[0] & MDSIO_WDT_BOOT) ||
+    (*(hal_data->rand) == MDSIO_WDT_SEED && hal_data->cmp_rand != 0 && hal_data->cmp_rand != MDSIO_WDT_SEED);
+  if (boot && hal_data->cmp_rand != 0 && !hal_data->layout_error) {
+    if (mdsio_resync_port(port) == 0) {
+      (*(hal_data->board_resets))++;
+      rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.wdt.%d: board reset detected, resynced\n", device->name, port->index, mod->index);
+    } else {
+      hal_data->layout_error = 1;
+      rtapi_print_msg(RTAPI_MSG_ERR, "%s.%d.wdt.%d: board reset detected, module layout changed!\n", device->name, port->index, mod->index);
+    }
+    hal_data->cmp_rand = *(hal_data->rand);
+    *(hal_data->com_error) = 1;
+  }
+  hal_data->boot_ack = boot;
+
   com_error = *(hal_data->com_error);
   if (hal_data->cmp_rand == 0 || *(hal_data->reset_error)) {
     hal_data->cmp_rand = *(hal_data->rand);
     com_error = 0;
   }
 
-  if (*(hal_data->rand) == 0 || hal_data->cmp_rand != *(hal_data->rand)) {
+  if (*(hal_data->rand) == 0 || hal_data->cmp_rand != *(hal_data->rand) || hal_data->layout_error) {
     com_error = 1;
   }
 
@@ -126,6 +160,12 @@ void mdsio_wdt_read(mdsio_mod_t *mod, long period, uint32_t *data) {
   }
 
   *(hal_data->com_error) = com_error;
+
+  // outputs are cleared by the hardware while the watchdog
+  // is not running, so send the full output image again
+  if (com_error || !(data[0] & (1 << 17))) {
+    mdsio_invalidate_output(port);
+  }
 }
 
 void mdsio_wdt_write(mdsio_mod_t *mod, long period, uint32_t *data) {
@@ -135,10 +175,15 @@ void mdsio_wdt_write(mdsio_mod_t *mod, long period, uint32_t *data) {
 
   data[0] = *(hal_data->rand) & 0xffff;
 
-  if (*(hal_data->enable)) {
+  // keep outputs off on a board that came back with another layout
+  if (*(hal_data->enable) && !hal_data->layout_error) {
     data[0] |= (1 << 16);
   }
 
+  if (hal_data->boot_ack) {
+    data[0] |= MDSIO_WDT_BOOT;
+  }
+
   hal_data->cmp_rand = (((hal_data->cmp_rand) << 1) | ((((hal_data->cmp_rand) >> 15) & 1) ^ (((hal_data->cmp_rand) >> 10) & 1))) & 0xffff;
 }
 
@@ -21,8 +21,14 @@
 #include "mdsio.h"
 
 #define MDSIO_WDT_TYPE 1
+#define MDSIO_WDT_VERSION 0
 #define MDSIO_WDT_LEN 4
 
+#define MDSIO_WDT_SEED 0xfff8
+#define MDSIO_WDT_BOOT (1 << 18)
+
 int mdsio_wdt_init(mdsio_mod_t *module);
+void mdsio_wdt_read(mdsio_mod_t *mod, long period, uint32_t *data);
+void mdsio_wdt_write(mdsio_mod_t *mod, long period, uint32_t *data);
 
 #endif
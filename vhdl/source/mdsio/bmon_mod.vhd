@@ -0,0 +1,164 @@
+library ieee;
+  use ieee.std_logic_1164.all;
+  use ieee.std_logic_unsigned.all;
+  use ieee.numeric_std.all;
+
+library UNISIM;
+  use UNISIM.Vcomponents.all;
+
+-- wishbone bus monitor. counts the target accesses of one servo
+-- cycle and latches the counts with the watchdog handshake, so the
+-- driver reads the totals of the previous cycle. a free running
+-- timestamp is read live and latched with the handshake, to get
+-- the board side time of the read and of the last write.
+entity BMON_MOD is
+  generic (
+    -- IO-REQ: 7 DWORD
+    WB_CONF_OFFSET: std_logic_vector(15 downto 2) := "00000000000000";
+    WB_CONF_DATA:   std_logic_vector(15 downto 0) := "0000000000001000";
+    WB_ADDR_OFFSET: std_logic_vector(15 downto 2) := "00000000000000"
+  );
+  port (
+    WB_CLK: in std_logic;
+    WB_RST: in std_logic;
+    WB_ADDR: in std_logic_vector(15 downto 2);
+    WB_DATA_OUT: out std_logic_vector(31 downto 0);
+    WB_STB_RD: in std_logic;
+
+    -- monitored bus, wishbone side of the pci target
+    MON_CYC: in std_logic;
+    MON_WE: in std_logic;
+    MON_ACK: in std_logic;
+    MON_RTY: in std_logic;
+
+    -- watchdog write strobe, ends a cycle
+    LATCH: in std_logic
+  );
+end;
+
+architecture rtl of BMON_MOD is
+  signal wb_data_mux : std_logic_vector(31 downto 0);
+
+  signal rd_cnt: std_logic_vector(31 downto 0);
+  signal wr_cnt: std_logic_vector(31 downto 0);
+  signal wait_cnt: std_logic_vector(31 downto 0);
+  signal busy_cnt: std_logic_vector(31 downto 0);
+  signal rty_cnt: std_logic_vector(31 downto 0);
+
+  signal rd_reg: std_logic_vector(31 downto 0);
+  signal wr_reg: std_logic_vector(31 downto 0);
+  signal wait_reg: std_logic_vector(31 downto 0);
+  signal busy_reg: std_logic_vector(31 downto 0);
+  signal rty_reg: std_logic_vector(31 downto 0);
+
+  signal timestamp: std_logic_vector(31 downto 0);
+  signal wr_ts_reg: std_logic_vector(31 downto 0);
+
+begin
+  ----------------------------------------------------------
+  --- bus logic
+  ----------------------------------------------------------
+  P_WB_RD : process(WB_ADDR, rd_reg, wr_reg, wait_reg, busy_reg, rty_reg, timestamp, wr_ts_reg)
+  begin
+    case WB_ADDR is
+      when WB_CONF_OFFSET =>
+        wb_data_mux(15 downto 0) <= WB_CONF_DATA;
+        wb_data_mux(31 downto 16) <= WB_ADDR_OFFSET & "00";
+      when WB_ADDR_OFFSET =>
+        wb_data_mux <= rd_reg;
+      when WB_ADDR_OFFSET + 1 =>
+        wb_data_mux <= wr_reg;
+      when WB_ADDR_OFFSET + 2 =>
+        wb_data_mux <= wait_reg;
+      when WB_ADDR_OFFSET + 3 =>
+        wb_data_mux <= busy_reg;
+      when WB_ADDR_OFFSET + 4 =>
+        wb_data_mux <= rty_reg;
+      when WB_ADDR_OFFSET + 5 =>
+        wb_data_mux <= timestamp;
+      when WB_ADDR_OFFSET + 6 =>
+        wb_data_mux <= wr_ts_reg;
+      when others =>
+        wb_data_mux <= (others => '0');
+    end case;
+  end process;
+
+  P_WB_RD_REG : process(WB_RST, WB_CLK)
+  begin
+    if WB_RST = '1' then
+      WB_DATA_OUT <= (others => '0');
+    elsif rising_edge(WB_CLK) then
+      if WB_STB_RD = '1' then
+        WB_DATA_OUT <= wb_data_mux;
+      end if;
+    end if;
+  end process;
+
+  ----------------------------------------------------------
+  --- timestamps
+  ----------------------------------------------------------
+  P_TS : process(WB_RST, WB_CLK)
+  begin
+    if WB_RST = '1' then
+      timestamp <= (others => '0');
+      wr_ts_reg <= (others => '0');
+    elsif rising_edge(WB_CLK) then
+      timestamp <= timestamp + 1;
+      if LATCH = '1' then
+        wr_ts_reg <= timestamp;
+      end if;
+    end if;
+  end process;
+
+  ----------------------------------------------------------
+  --- counters
+  ----------------------------------------------------------
+  P_CNT : process(WB_RST, WB_CLK)
+  begin
+    if WB_RST = '1' then
+      rd_cnt <= (others => '0');
+      wr_cnt <= (others => '0');
+      wait_cnt <= (others => '0');
+      busy_cnt <= (others => '0');
+      rty_cnt <= (others => '0');
+      rd_reg <= (others => '0');
+      wr_reg <= (others => '0');
+      wait_reg <= (others => '0');
+      busy_reg <= (others => '0');
+      rty_reg <= (others => '0');
+    elsif rising_edge(WB_CLK) then
+      if LATCH = '1' then
+        -- latch the totals, the strobe clock starts the next cycle
+        rd_reg <= rd_cnt;
+        wr_reg <= wr_cnt;
+        wait_reg <= wait_cnt;
+        busy_reg <= busy_cnt;
+        rty_reg <= rty_cnt;
+        rd_cnt <= (others => '0');
+        wr_cnt <= (others => '0');
+        wait_cnt <= (others => '0');
+        busy_cnt <= (others => '0');
+        rty_cnt <= (others => '0');
+        if MON_CYC = '1' then
+          busy_cnt <= std_logic_vector(to_unsigned(1, 32));
+        end if;
+      else
+        if MON_CYC = '1' then
+          busy_cnt <= busy_cnt + 1;
+          if MON_ACK = '1' then
+            if MON_WE = '1' then
+              wr_cnt <= wr_cnt + 1;
+            else
+              rd_cnt <= rd_cnt + 1;
+            end if;
+          elsif MON_RTY = '1' then
+            rty_cnt <= rty_cnt + 1;
+          else
+            wait_cnt <= wait_cnt + 1;
+          end if;
+        end if;
+      end if;
+    end if;
+  end process;
+
+end;
@@ -8,10 +8,11 @@ library UNISIM;
 
 entity DAC_MOD is
   generic (
-    -- IO-REQ: 3 DWORD
+    -- IO-REQ: (CHANNELS + 1) / 2 DWORD
     WB_CONF_OFFSET: std_logic_vector(15 downto 2) := "00000000000000";
     WB_CONF_DATA:   std_logic_vector(15 downto 0) := "0000000000000011";
-    WB_ADDR_OFFSET: std_logic_vector(15 downto 2) := "00000000000000"
+    WB_ADDR_OFFSET: std_logic_vector(15 downto 2) := "00000000000000";
+    CHANNELS: integer range 1 to 6 := 6
   );
   port (
     OUT_EN: in std_logic;
@@ -35,52 +36,48 @@ architecture rtl of DAC_MOD is
   constant CMD_WriteA:        std_logic_vector(7 downto 0) := "00000000";
   constant CMD_WriteB_LoadAB: std_logic_vector(7 downto 0) := "00110100";
 
+  -- one dual dac per serial line, channel 2n on A, 2n+1 on B.
+  -- all lines keep running, missing channels send mid scale.
+  constant PAIRS: integer := (CHANNELS + 1) / 2;
+  constant DAC_MID: std_logic_vector(15 downto 0) := x"8000";
+
+  type dac_array_t is array (0 to 5) of std_logic_vector(15 downto 0);
+  type reg_array_t is array (0 to 2) of std_logic_vector(15 downto 0);
+  type shift_array_t is array (0 to 2) of std_logic_vector(23 downto 0);
+
   signal wb_data_mux : std_logic_vector(31 downto 0);
 
   signal shift_cnt: std_logic_vector(4 downto 0);
   signal bitcnt_sync: std_logic;
   signal bitcnt_top: std_logic;
 
-  signal dac1_data: std_logic_vector(15 downto 0);
-  signal dac2_data: std_logic_vector(15 downto 0);
-  signal dac2_reg: std_logic_vector(15 downto 0);
-  signal dac3_data: std_logic_vector(15 downto 0);
-  signal dac4_data: std_logic_vector(15 downto 0);
-  signal dac4_reg: std_logic_vector(15 downto 0);
-  signal dac5_data: std_logic_vector(15 downto 0);
-  signal dac6_data: std_logic_vector(15 downto 0);
-  signal dac6_reg: std_logic_vector(15 downto 0);
+  signal dac_data: dac_array_t;
+  signal dacb_reg: reg_array_t;
 
   signal ssync: std_logic;
   signal sclk: std_logic;
 
   signal select_ab: std_logic;
-  signal dac12_shift: std_logic_vector(23 downto 0);
-  signal dac34_shift: std_logic_vector(23 downto 0);
-  signal dac56_shift: std_logic_vector(23 downto 0);
+  signal dac_shift: shift_array_t;
 begin
 
   ----------------------------------------------------------
   --- bus logic
   ----------------------------------------------------------
-  P_WB_RD : process(WB_ADDR)
+  -- conf word: channels(15..12), layout version(11..8), type(7..0)
+  P_WB_RD : process(WB_ADDR, dac_data)
+    variable word: std_logic_vector(15 downto 2);
   begin
-    case WB_ADDR is
-      when WB_CONF_OFFSET =>
-        wb_data_mux(15 downto 0) <= WB_CONF_DATA;
-        wb_data_mux(31 downto 16) <= WB_ADDR_OFFSET & "00";
-      when WB_ADDR_OFFSET =>
-        wb_data_mux(15 downto 0)  <= dac1_data;
-        wb_data_mux(31 downto 16) <= dac2_data;
-      when WB_ADDR_OFFSET + 1 =>
-        wb_data_mux(15 downto 0)  <= dac3_data;
-        wb_data_mux(31 downto 16) <= dac4_data;
-      when WB_ADDR_OFFSET + 2 =>
-        wb_data_mux(15 downto 0)  <= dac5_data;
-        wb_data_mux(31 downto 16) <= dac6_data;
-      when others => 
-        wb_data_mux <= (others => '0');
-    end case;
+    word := WB_ADDR - WB_ADDR_OFFSET;
+    if WB_ADDR = WB_CONF_OFFSET then
+      wb_data_mux(15 downto 0) <= std_logic_vector(to_unsigned(CHANNELS, 4)) & WB_CONF_DATA(11 downto 0);
+      wb_data_mux(31 downto 16) <= WB_ADDR_OFFSET & "00";
+    elsif WB_ADDR >= WB_ADDR_OFFSET and WB_ADDR < WB_ADDR_OFFSET + PAIRS then
+      wb_data_mux(15 downto 0)  <= dac_data(2 * conv_integer(word));
+      wb_data_mux(31 downto 16) <= dac_data(2 * conv_integer(word) + 1);
+    else
+      wb_data_mux <= (others => '0');
+    end if;
   end process;
 
   P_WB_RD_REG : process(WB_RST, WB_CLK)
@@ -95,28 +92,23 @@ begin
   end process;
 
   P_PE_REG_WR : process(WB_RST, WB_CLK)
+    variable word: std_logic_vector(15 downto 2);
   begin
     if WB_RST = '1' then
-      dac1_data <= (others => '0');
-      dac2_data <= (others => '0');
-      dac3_data <= (others => '0');
-      dac4_data <= (others => '0');
-      dac5_data <= (others => '0');
-      dac6_data <= (others => '0');
+      for i in 0 to 5 loop
+        if i < CHANNELS then
+          dac_data(i) <= (others => '0');
+        else
+          dac_data(i) <= DAC_MID;
+        end if;
+      end loop;
     elsif rising_edge(WB_CLK) then
-      if WB_STB_WR = '1' then
-        case WB_ADDR is
-          when WB_ADDR_OFFSET =>
-            dac1_data <= WB_DATA_IN(15 downto 0);
-            dac2_data <= WB_DATA_IN(31 downto 16);
-          when WB_ADDR_OFFSET + 1 =>
-            dac3_data <= WB_DATA_IN(15 downto 0);
-            dac4_data <= WB_DATA_IN(31 downto 16);
-          when WB_ADDR_OFFSET + 2 =>
-            dac5_data <= WB_DATA_IN(15 downto 0);
-            dac6_data <= WB_DATA_IN(31 downto 16);
-          when others =>
-        end case;
+      word := WB_ADDR - WB_ADDR_OFFSET;
+      if WB_STB_WR = '1' and WB_ADDR >= WB_ADDR_OFFSET and WB_ADDR < WB_ADDR_OFFSET + PAIRS then
+        dac_data(2 * conv_integer(word)) <= WB_DATA_IN(15 downto 0);
+        if 2 * conv_integer(word) + 1 < CHANNELS then
+          dac_data(2 * conv_integer(word) + 1) <= WB_DATA_IN(31 downto 16);
+        end if;
       end if;
     end if;
   end process;
@@ -170,33 +162,27 @@ begin
   p_so_out_shift: process(WB_CLK, WB_RST)
   begin
     if (WB_RST = '1') then
-      dac12_shift <= (others => '0');
-      dac34_shift <= (others => '0');
-      dac56_shift <= (others => '0');
-      dac2_reg <= (others => '0');
-      dac4_reg <= (others => '0');
-      dac6_reg <= (others => '0');
+      for i in 0 to 2 loop
+        dac_shift(i) <= (others => '0');
+        dacb_reg(i) <= (others => '0');
+      end loop;
       select_ab <= '0';
     elsif rising_edge(WB_CLK) then
       if SCLK_EDGE = '1' and SCLK_STATE = '0' then
-        if bitcnt_top = '1' then
-          if select_ab = '0' then
-            dac12_shift <= CMD_WriteA & dac1_data;
-            dac34_shift <= CMD_WriteA & dac3_data;
-            dac56_shift <= CMD_WriteA & dac5_data;
-            dac2_reg <= dac2_data;
-            dac4_reg <= dac4_data;
-            dac6_reg <= dac6_data;
+        for i in 0 to 2 loop
+          if bitcnt_top = '1' then
+            if select_ab = '0' then
+              dac_shift(i) <= CMD_WriteA & dac_data(2 * i);
+              dacb_reg(i) <= dac_data(2 * i + 1);
+            else
+              dac_shift(i) <= CMD_WriteB_LoadAB & dacb_reg(i);
+            end if;
           else
-            dac12_shift <= CMD_WriteB_LoadAB & dac2_reg;
-            dac34_shift <= CMD_WriteB_LoadAB & dac4_reg;
-            dac56_shift <= CMD_WriteB_LoadAB & dac6_reg;
+            dac_shift(i) <= dac_shift(i)(22 downto 0) & "1";
           end if;
+        end loop;
+        if bitcnt_top = '1' then
           select_ab <= not select_ab;
-        else
-          dac12_shift <= dac12_shift(22 downto 0) & "1";
-          dac34_shift <= dac34_shift(22 downto 0) & "1";
-          dac56_shift <= dac56_shift(22 downto 0) & "1";
         end if;
       end if;
     end if;
@@ -209,9 +195,9 @@ begin
   SV(4)  <= '0';
   SV(5)  <= not ssync;
   SV(6)  <= not sclk;
-  SV(7)  <= not dac56_shift(23);
-  SV(8)  <= not dac34_shift(23);
-  SV(9)  <= not dac12_shift(23);
+  SV(7)  <= not dac_shift(2)(23);
+  SV(8)  <= not dac_shift(1)(23);
+  SV(9)  <= not dac_shift(0)(23);
   SV(10) <= OUT_EN;
 
 end;
@@ -11,7 +11,9 @@ entity DIO_MOD is
     -- IO-REQ: 2 DWORD
     WB_CONF_OFFSET: std_logic_vector(15 downto 2) := "00000000000000";
     WB_CONF_DATA:   std_logic_vector(15 downto 0) := "0000000000000010";
-    WB_ADDR_OFFSET: std_logic_vector(15 downto 2) := "00000000000000"
+    WB_ADDR_OFFSET: std_logic_vector(15 downto 2) := "00000000000000";
+    -- banks of 8 inputs and 8 outputs on the serial chain
+    CHANNELS: integer range 1 to 5 := 5
   );
   port (
     OUT_EN: in std_logic;
@@ -26,6 +28,12 @@ entity DIO_MOD is
     WB_STB_RD: in std_logic;
     WB_STB_WR: in std_logic;
 
+    SNAP: in std_logic;
+    SNAP_EN: in std_logic;
+
+    PROBE_IN: in std_logic;
+    PROBE: out std_logic;
+
     SV : inout std_logic_vector(10 downto 3)
   );
 end;
@@ -35,6 +43,9 @@ architecture rtl of DIO_MOD is
   constant OUT_TEST_PATTERN: std_logic_vector(7 downto 0) := "10110010";
   constant IN_TEST_PATTERN:  std_logic_vector(7 downto 0) := "10101100";
 
+  -- pins on the chain, the test pattern follows them
+  constant PINS: integer := 8 * CHANNELS;
+
   signal wb_data_mux : std_logic_vector(31 downto 0);
 
   signal shift_cnt: std_logic_vector(5 downto 0);
@@ -52,36 +63,46 @@ architecture rtl of DIO_MOD is
   signal si_out: std_logic;
   signal so_out: std_logic;
   signal so_out_data: std_logic_vector(39 downto 0);
-  signal so_out_shift: std_logic_vector(47 downto 0);
+  signal so_out_shift: std_logic_vector(PINS + 7 downto 0);
   signal si_out_shift: std_logic_vector(7 downto 0);
   signal out_data_error: std_logic;
 
   signal si_in: std_logic;
   signal so_in: std_logic;
   signal so_in_shift: std_logic_vector(7 downto 0);
-  signal si_in_shift: std_logic_vector(47 downto 0);
+  signal si_in_shift: std_logic_vector(PINS + 7 downto 0);
   signal si_in_data: std_logic_vector(39 downto 0);
+  signal in_data_snap: std_logic_vector(39 downto 0);
+  signal in_data: std_logic_vector(39 downto 0);
   signal in_data_error: std_logic;
 
   signal output_fault_reg: std_logic;
   signal out_data_error_reg: std_logic;
   signal in_data_error_reg: std_logic;
 
+  signal probe_sel: std_logic_vector(5 downto 0);
+  signal probe_inv: std_logic;
+  signal probe_sync: std_logic_vector(1 downto 0);
+  signal probe_lvl: std_logic;
+  signal probe_dly: std_logic;
+  signal probe_reg: std_logic;
+
 begin
   ----------------------------------------------------------
   --- bus logic
   ----------------------------------------------------------
+  -- conf word: channels(15..12), layout version(11..8), type(7..0)
   P_WB_RD : process(WB_ADDR)
   begin
     case WB_ADDR is
       when WB_CONF_OFFSET =>
-        wb_data_mux(15 downto 0) <= WB_CONF_DATA;
+        wb_data_mux(15 downto 0) <= std_logic_vector(to_unsigned(CHANNELS, 4)) & WB_CONF_DATA(11 downto 0);
         wb_data_mux(31 downto 16) <= WB_ADDR_OFFSET & "00";
       when WB_ADDR_OFFSET =>
-        wb_data_mux <= si_in_data(31 downto 0);
+        wb_data_mux <= in_data(31 downto 0);
       when WB_ADDR_OFFSET + 1 =>
         wb_data_mux <= (others => '0');
-        wb_data_mux(7 downto 0) <= si_in_data(39 downto 32);
+        wb_data_mux(7 downto 0) <= in_data(39 downto 32);
         wb_data_mux(16) <= output_fault_reg;
         wb_data_mux(17) <= out_data_error_reg;
         wb_data_mux(18) <= in_data_error_reg;
@@ -90,6 +111,20 @@ begin
     end case;
   end process;
 
+  -- inputs as of the snapshot strobe with the global latch
+  in_data <= in_data_snap when SNAP_EN = '1' else si_in_data;
+
+  P_SNAP : process(WB_RST, WB_CLK)
+  begin
+    if WB_RST = '1' then
+      in_data_snap <= (others => '0');
+    elsif rising_edge(WB_CLK) then
+      if SNAP = '1' then
+        in_data_snap <= si_in_data;
+      end if;
+    end if;
+  end process;
+
   P_WB_RD_REG : process(WB_RST, WB_CLK)
   begin
     if WB_RST = '1' then
@@ -108,6 +143,8 @@ begin
       output_fault_reg <= '0';
       out_data_error_reg <= '0';
       in_data_error_reg <= '0';
+      probe_sel <= (others => '0');
+      probe_inv <= '0';
     elsif rising_edge(WB_CLK) then
       -- reset error flags when  output is disabled
       if OUT_EN = '0' then
@@ -143,6 +180,8 @@ begin
             if WB_DATA_IN(18) = '1' then
               in_data_error_reg <= '0';
             end if;      
+            probe_sel <= WB_DATA_IN(29 downto 24);
+            probe_inv <= WB_DATA_IN(30);
           when others =>
         end case;
       end if;
@@ -189,8 +228,8 @@ begin
       end if;
     end if;
   end process;
-  bitcnt_sync <= '1' when shift_cnt = 47 else '0'; 
-  bitcnt_top  <= '1' when shift_cnt = 48 else '0'; 
+  bitcnt_sync <= '1' when shift_cnt = PINS + 7 else '0'; 
+  bitcnt_top  <= '1' when shift_cnt = PINS + 8 else '0'; 
 
   ----------------------------------------------------------
   --- output shift registers
@@ -202,14 +241,14 @@ begin
     elsif rising_edge(WB_CLK) then
       if SCLK_EDGE = '1' and SCLK_STATE = '0' then
         if bitcnt_top = '1' then
-          so_out_shift <= OUT_TEST_PATTERN & so_out_data;
+          so_out_shift <= OUT_TEST_PATTERN & so_out_data(PINS - 1 downto 0);
         else
-          so_out_shift <= so_out_shift(46 downto 0) & "1";
+          so_out_shift <= so_out_shift(PINS + 6 downto 0) & "1";
         end if;
       end if;
     end if;
   end process;
-  so_out <= so_out_shift(47);
+  so_out <= so_out_shift(PINS + 7);
 
   p_si_out_shift: process(WB_CLK, WB_RST)
   begin
@@ -264,17 +303,57 @@ begin
             in_data_error <= '1';
           else
             in_data_error <= '0';
-            si_in_data <= si_in_shift(47 downto 8);
+            si_in_data(PINS - 1 downto 0) <= si_in_shift(PINS + 7 downto 8);
           end if;
           si_in_shift <= (others => '0');
         else
-          si_in_shift <= si_in_shift(46 downto 0) & si_in;
+          si_in_shift <= si_in_shift(PINS + 6 downto 0) & si_in;
         end if;
       end if;
     end if;
   end process;
 
 
+  ----------------------------------------------------------
+  --- probe trigger
+  ----------------------------------------------------------
+  -- source 0 is the probe input, n selects input bit n-1.
+  -- one clock strobe on the active edge for the enc/phpe latches.
+  p_probe_sync: process(WB_CLK, WB_RST)
+  begin
+    if (WB_RST = '1') then
+      probe_sync <= (others => '0');
+    elsif rising_edge(WB_CLK) then
+      probe_sync <= PROBE_IN & probe_sync(1);
+    end if;
+  end process;
+
+  p_probe_src: process(probe_sel, probe_sync, si_in_data)
+    variable n: integer range 0 to 63;
+  begin
+    n := conv_integer(probe_sel);
+    if n = 0 then
+      probe_lvl <= probe_sync(0);
+    elsif n <= PINS then
+      probe_lvl <= si_in_data(n - 1);
+    else
+      probe_lvl <= '0';
+    end if;
+  end process;
+
+  p_probe_edge: process(WB_CLK, WB_RST)
+  begin
+    if (WB_RST = '1') then
+      probe_dly <= '0';
+      probe_reg <= '0';
+    elsif rising_edge(WB_CLK) then
+      probe_dly <= probe_lvl xor probe_inv;
+      probe_reg <= (probe_lvl xor probe_inv) and not probe_dly;
+    end if;
+  end process;
+
+  PROBE <= probe_reg;
+
   ----------------------------------------------------------
   --- output fault delay
   ----------------------------------------------------------
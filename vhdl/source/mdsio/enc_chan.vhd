@@ -11,12 +11,18 @@ entity ENC_CHAN is
     RESET: in std_logic;
     CLK: in std_logic;
     CAPTURE: in std_logic;
+    IDX_ARM: in std_logic;
+    PROBE: in std_logic;
+    PRB_ARM: in std_logic;
 
     TIMESTAMP: in std_logic_vector(31 downto 0);
 
     CNT_REG: out std_logic_vector(31 downto 0);
     TS_REG: out std_logic_vector(31 downto 0);
     IDX_REG: out std_logic_vector(31 downto 0);
+    IDX_TS_REG: out std_logic_vector(31 downto 0);
+    PRB_REG: out std_logic_vector(31 downto 0);
+    PRB_TS_REG: out std_logic_vector(31 downto 0);
 
     ENC_A: in std_logic;
     ENC_B: in std_logic;
@@ -38,6 +44,11 @@ architecture rtl of ENC_CHAN is
   
   signal enc_idx: std_logic_vector(30 downto 0);
   signal enc_idx_flag: std_logic;
+  signal enc_idx_ts: std_logic_vector(31 downto 0);
+
+  signal enc_prb: std_logic_vector(30 downto 0);
+  signal enc_prb_flag: std_logic;
+  signal enc_prb_ts: std_logic_vector(31 downto 0);
 
 begin
   capture_proc: process(RESET, CLK)
@@ -46,11 +57,17 @@ begin
       CNT_REG <= (others => '0');
       TS_REG <= (others => '0');
       IDX_REG <= (others => '0');
+      IDX_TS_REG <= (others => '0');
+      PRB_REG <= (others => '0');
+      PRB_TS_REG <= (others => '0');
     elsif rising_edge(CLK) then
       if CAPTURE = '1' then
         CNT_REG <= enc_cnt_flag & enc_cnt;
         TS_REG <= enc_ts;
         IDX_REG <= enc_idx_flag & enc_idx;
+        IDX_TS_REG <= enc_idx_ts;
+        PRB_REG <= enc_prb_flag & enc_prb;
+        PRB_TS_REG <= enc_prb_ts;
       end if;
     end if;
   end process;
@@ -80,10 +97,13 @@ begin
       enc_idx <= (others => '0');
       enc_cnt_flag <= '0';
       enc_idx_flag <= '0';
+      enc_idx_ts <= (others => '0');
+      enc_prb <= (others => '0');
+      enc_prb_flag <= '0';
+      enc_prb_ts <= (others => '0');
     elsif rising_edge(CLK) then
       if CAPTURE = '1' then
         enc_cnt_flag <= '0';
-        enc_idx_flag <= '0';
       end if;
 
       enc_dly <= enc_q(0);
@@ -99,10 +119,24 @@ begin
         end if;
       end if;
 
-      if enc_idx_in = "011" and enc_idx_flag = '0' then
+      -- first index edge while armed, the flag holds the latch
+      -- until the host drops the arm bit
+      if IDX_ARM = '0' then
+        enc_idx_flag <= '0';
+      elsif enc_idx_in = "011" and enc_idx_flag = '0' then
         enc_idx <= enc_cnt;
+        enc_idx_ts <= TIMESTAMP;
         enc_idx_flag <= '1';
       end if;
+
+      -- probe strobe, same handshake as the index
+      if PRB_ARM = '0' then
+        enc_prb_flag <= '0';
+      elsif PROBE = '1' and enc_prb_flag = '0' then
+        enc_prb <= enc_cnt;
+        enc_prb_ts <= TIMESTAMP;
+        enc_prb_flag <= '1';
+      end if;
     end if;
   end process;
 
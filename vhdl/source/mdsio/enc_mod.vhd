@@ -8,65 +8,74 @@ library UNISIM;
 
 entity ENC_MOD is
   generic (
-    -- IO-REQ: 7 DWORD
+    -- IO-REQ: 1 + 6 * CHANNELS DWORD
     WB_CONF_OFFSET: std_logic_vector(15 downto 2) := "00000000000000";
-    WB_CONF_DATA:   std_logic_vector(15 downto 0) := "0000000000000100";
-    WB_ADDR_OFFSET: std_logic_vector(15 downto 2) := "00000000000000"
+    WB_CONF_DATA:   std_logic_vector(15 downto 0) := "0000000100000100";
+    WB_ADDR_OFFSET: std_logic_vector(15 downto 2) := "00000000000000";
+    CHANNELS: integer range 1 to 10 := 2
   );
   port (
     WB_CLK: in std_logic;
     WB_RST: in std_logic;
     WB_ADDR: in std_logic_vector(15 downto 2);
     WB_DATA_OUT: out std_logic_vector(31 downto 0);
+    WB_DATA_IN: in std_logic_vector(31 downto 0);
     WB_STB_RD: in std_logic;
+    WB_STB_WR: in std_logic;
 
-    SV : inout std_logic_vector(10 downto 3)
+    SNAP: in std_logic;
+    SNAP_EN: in std_logic;
+    PROBE: in std_logic;
+
+    ENC_A: in std_logic_vector(CHANNELS - 1 downto 0);
+    ENC_B: in std_logic_vector(CHANNELS - 1 downto 0);
+    ENC_I: in std_logic_vector(CHANNELS - 1 downto 0)
   );
 end;
 
 architecture rtl of ENC_MOD is
+  -- per channel: cnt, ts, idx, idx_ts, prb, prb_ts
+  constant CHAN_WORDS: integer := 6;
+
+  type reg_array_t is array (0 to CHAN_WORDS * CHANNELS - 1) of std_logic_vector(31 downto 0);
+
   signal wb_data_mux : std_logic_vector(31 downto 0);
 
   signal capture: std_logic;
+  signal capture_rd: std_logic;
   signal timestamp: std_logic_vector(31 downto 0);
+  signal snap_ts: std_logic_vector(31 downto 0);
+  signal idx_arm: std_logic_vector(CHANNELS - 1 downto 0);
+  signal prb_arm: std_logic_vector(CHANNELS - 1 downto 0);
 
-  signal cnt_reg_a: std_logic_vector(31 downto 0);
-  signal ts_reg_a: std_logic_vector(31 downto 0);
-  signal idx_reg_a: std_logic_vector(31 downto 0);
-  signal cnt_reg_b: std_logic_vector(31 downto 0);
-  signal ts_reg_b: std_logic_vector(31 downto 0);
-  signal idx_reg_b: std_logic_vector(31 downto 0);
+  signal regs: reg_array_t;
 
 begin
 
   ----------------------------------------------------------
   --- bus logic
   ----------------------------------------------------------
-  P_WB_RD : process(WB_ADDR, WB_STB_RD, timestamp, cnt_reg_a, idx_reg_a, cnt_reg_b, idx_reg_b)
+  -- conf word: channels(15..12), layout version(11..8), type(7..0)
+  P_WB_RD : process(WB_ADDR, WB_STB_RD, SNAP_EN, timestamp, snap_ts, regs)
+    variable word: std_logic_vector(15 downto 2);
   begin
-    capture <= '0';
-    case WB_ADDR is
-      when WB_CONF_OFFSET =>
-        wb_data_mux(15 downto 0) <= WB_CONF_DATA;
-        wb_data_mux(31 downto 16) <= WB_ADDR_OFFSET & "00";
-      when WB_ADDR_OFFSET =>
-        capture <= WB_STB_RD;
+    capture_rd <= '0';
+    word := WB_ADDR - WB_ADDR_OFFSET;
+    if WB_ADDR = WB_CONF_OFFSET then
+      wb_data_mux(15 downto 0) <= std_logic_vector(to_unsigned(CHANNELS, 4)) & WB_CONF_DATA(11 downto 0);
+      wb_data_mux(31 downto 16) <= WB_ADDR_OFFSET & "00";
+    elsif WB_ADDR = WB_ADDR_OFFSET then
+      capture_rd <= WB_STB_RD;
+      if SNAP_EN = '1' then
+        wb_data_mux <= snap_ts;
+      else
         wb_data_mux <= timestamp;
-      when WB_ADDR_OFFSET + 1 =>
-        wb_data_mux <= cnt_reg_a;
-      when WB_ADDR_OFFSET + 2 =>
-        wb_data_mux <= ts_reg_a;
-      when WB_ADDR_OFFSET + 3 =>
-        wb_data_mux <= idx_reg_a;
-      when WB_ADDR_OFFSET + 4 =>
-        wb_data_mux <= cnt_reg_b;
-      when WB_ADDR_OFFSET + 5 =>
-        wb_data_mux <= ts_reg_b;
-      when WB_ADDR_OFFSET + 6 =>
-        wb_data_mux <= idx_reg_b;
-      when others => 
-        wb_data_mux <= (others => '0');
-    end case;
+      end if;
+    elsif WB_ADDR > WB_ADDR_OFFSET and WB_ADDR <= WB_ADDR_OFFSET + CHAN_WORDS * CHANNELS then
+      wb_data_mux <= regs(conv_integer(word) - 1);
+    else
+      wb_data_mux <= (others => '0');
+    end if;
   end process;
 
   P_WB_RD_REG : process(WB_RST, WB_CLK)
@@ -80,6 +89,36 @@ begin
     end if;
   end process;
 
+  -- index latch arm bits from bit 0, probe latch arm bits
+  -- from bit 16, one per channel
+  P_WB_WR : process(WB_RST, WB_CLK)
+  begin
+    if WB_RST = '1' then
+      idx_arm <= (others => '0');
+      prb_arm <= (others => '0');
+    elsif rising_edge(WB_CLK) then
+      if WB_STB_WR = '1' and WB_ADDR = WB_ADDR_OFFSET then
+        idx_arm <= WB_DATA_IN(CHANNELS - 1 downto 0);
+        prb_arm <= WB_DATA_IN(CHANNELS + 15 downto 16);
+      end if;
+    end if;
+  end process;
+
+  -- with the global latch the channels are captured by the
+  -- snapshot strobe, the timebase word returns its time
+  capture <= SNAP when SNAP_EN = '1' else capture_rd;
+
+  P_SNAP_TS : process(WB_RST, WB_CLK)
+  begin
+    if WB_RST = '1' then
+      snap_ts <= (others => '0');
+    elsif rising_edge(WB_CLK) then
+      if SNAP = '1' then
+        snap_ts <= timestamp;
+      end if;
+    end if;
+  end process;
+
   ----------------------------------------------------------
   --- timestamp generator
   ----------------------------------------------------------
@@ -95,41 +134,29 @@ begin
   ----------------------------------------------------------
   --- encoder instances
   ----------------------------------------------------------
-  U_ENC_A: entity work.ENC_CHAN
-    port map (
-      RESET => WB_RST,
-      CLK => WB_CLK,
-      CAPTURE => capture,
-
-      TIMESTAMP => timestamp,
-
-      CNT_REG => cnt_reg_a,
-      TS_REG => ts_reg_a,
-      IDX_REG => idx_reg_a,
-
-      ENC_A => not SV(10),
-      ENC_B => not SV(8),
-      ENC_I => not SV(6)
-    );
-
-  U_ENC_B: entity work.ENC_CHAN
-    port map (
-      RESET => WB_RST,
-      CLK => WB_CLK,
-      CAPTURE => capture,
-
-      TIMESTAMP => timestamp,
-
-      CNT_REG => cnt_reg_b,
-      TS_REG => ts_reg_b,
-      IDX_REG => idx_reg_b,
-
-      ENC_A => not SV(9),
-      ENC_B => not SV(7),
-      ENC_I => not SV(5)
-    );
-
-  -- hold unused pins to GND
-  SV(4 downto 3) <= (others => '0');
+  G_ENC_CHAN: for i in 0 to CHANNELS - 1 generate
+    U_ENC: entity work.ENC_CHAN
+      port map (
+        RESET => WB_RST,
+        CLK => WB_CLK,
+        CAPTURE => capture,
+        IDX_ARM => idx_arm(i),
+        PROBE => PROBE,
+        PRB_ARM => prb_arm(i),
+
+        TIMESTAMP => timestamp,
+
+        CNT_REG => regs(CHAN_WORDS * i),
+        TS_REG => regs(CHAN_WORDS * i + 1),
+        IDX_REG => regs(CHAN_WORDS * i + 2),
+        IDX_TS_REG => regs(CHAN_WORDS * i + 3),
+        PRB_REG => regs(CHAN_WORDS * i + 4),
+        PRB_TS_REG => regs(CHAN_WORDS * i + 5),
+
+        ENC_A => ENC_A(i),
+        ENC_B => ENC_B(i),
+        ENC_I => ENC_I(i)
+      );
+  end generate;
 
 end;
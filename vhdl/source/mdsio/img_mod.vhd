@@ -0,0 +1,329 @@
+library ieee;
+  use ieee.std_logic_1164.all;
+  use ieee.std_logic_unsigned.all;
+  use ieee.numeric_std.all;
+
+library UNISIM;
+  use UNISIM.Vcomponents.all;
+
+entity IMG_MOD is
+  generic (
+    -- IO-REQ: 8 DWORD + SRC_LEN DWORD process image + 2 DWORD stamp
+    WB_CONF_OFFSET: std_logic_vector(15 downto 2) := "00000000000000";
+    WB_CONF_DATA:   std_logic_vector(15 downto 0) := "0000000100000111";
+    WB_ADDR_OFFSET: std_logic_vector(15 downto 2) := "00000000000000";
+    SRC_OFFSET:     std_logic_vector(15 downto 2) := "00000000000000";
+    SRC_LEN:        integer := 1;
+    DMA_EN:         boolean := false
+  );
+  port (
+    WB_CLK: in std_logic;
+    WB_RST: in std_logic;
+    WB_ADDR: in std_logic_vector(15 downto 2);
+    WB_DATA_OUT: out std_logic_vector(31 downto 0);
+    WB_DATA_IN: in std_logic_vector(31 downto 0);
+    WB_STB_RD: in std_logic;
+    WB_STB_WR: in std_logic;
+
+    -- global input latch, all modules capture on SNAP while SNAP_EN is set
+    SNAP: out std_logic;
+    SNAP_EN: out std_logic;
+
+    -- snapshot master, owns the mdsio bus while BUSY is set
+    BUSY: out std_logic;
+    SRC_ADDR: out std_logic_vector(15 downto 2);
+    SRC_STB_RD: out std_logic;
+    SRC_DATA: in std_logic_vector(31 downto 0);
+
+    -- image push to host memory, see PCI_MWR
+    DMA_START: out std_logic;
+    DMA_ADDR: out std_logic_vector(31 downto 2);
+    DMA_LEN: out std_logic_vector(15 downto 0);
+    DMA_BUSY: in std_logic;
+    DMA_ERR: in std_logic;
+    DMA_IDX: in std_logic_vector(15 downto 0);
+    DMA_DATA: out std_logic_vector(31 downto 0)
+  );
+end;
+
+architecture rtl of IMG_MOD is
+  constant IMG_OFFSET: std_logic_vector(15 downto 2) := WB_ADDR_OFFSET + 8;
+  constant SRC_BYTES: std_logic_vector(15 downto 0) := std_logic_vector(to_unsigned(SRC_LEN * 4, 16));
+
+  -- image is followed by the snapshot time and the trailer,
+  -- the trailer is the last word for dma completion
+  type img_ram_t is array (0 to SRC_LEN + 1) of std_logic_vector(31 downto 0);
+  signal img_ram: img_ram_t;
+  signal ram_we: std_logic;
+  signal ram_addr: std_logic_vector(15 downto 0);
+  signal ram_wr_data: std_logic_vector(31 downto 0);
+
+  signal wb_data_mux : std_logic_vector(31 downto 0);
+  signal wb_data_reg : std_logic_vector(31 downto 0);
+
+  signal img_sel: std_logic;
+  signal img_sel_reg: std_logic;
+  signal img_rd_idx: std_logic_vector(15 downto 2);
+  signal img_rd_data: std_logic_vector(31 downto 0);
+
+  signal timestamp: std_logic_vector(31 downto 0);
+  signal snap_ts: std_logic_vector(31 downto 0);
+  signal snap_seq: std_logic_vector(15 downto 0);
+  signal snap_trig: std_logic;
+  signal snap_en_reg: std_logic;
+  signal snap_latch: std_logic;
+  signal snap_latched: std_logic;
+  signal snap_busy: std_logic;
+  signal snap_stb: std_logic;
+  signal snap_idx: std_logic_vector(15 downto 2);
+  signal snap_we: std_logic;
+  signal snap_we_idx: std_logic_vector(15 downto 2);
+  signal snap_st: std_logic;
+  signal snap_tr: std_logic;
+  signal snap_dma: std_logic;
+  signal snap_ctrl: std_logic_vector(31 downto 0);
+
+  signal dma_trig: std_logic;
+  signal dma_en_reg: std_logic;
+  signal dma_start_reg: std_logic;
+  signal dma_addr_reg: std_logic_vector(31 downto 2);
+
+  signal per_reg: std_logic_vector(31 downto 0);
+  signal per_cnt: std_logic_vector(31 downto 0);
+  signal per_trig: std_logic;
+
+begin
+  ----------------------------------------------------------
+  --- bus logic
+  ----------------------------------------------------------
+  img_sel <= '1' when WB_ADDR >= IMG_OFFSET and WB_ADDR < IMG_OFFSET + SRC_LEN + 2 else '0';
+  img_rd_idx <= WB_ADDR - IMG_OFFSET;
+
+  -- ctrl word: busy, dma capable, dma error, latch capable,
+  -- timer capable and sequence number
+  snap_ctrl(0) <= snap_busy or DMA_BUSY;
+  snap_ctrl(1) <= '1' when DMA_EN else '0';
+  snap_ctrl(2) <= DMA_ERR;
+  snap_ctrl(3) <= '1';
+  snap_ctrl(4) <= '1';
+  snap_ctrl(15 downto 5) <= (others => '0');
+  snap_ctrl(31 downto 16) <= snap_seq;
+
+  P_WB_RD : process(WB_ADDR, snap_ctrl, snap_ts, dma_addr_reg, per_reg, timestamp)
+  begin
+    case WB_ADDR is
+      when WB_CONF_OFFSET =>
+        wb_data_mux(15 downto 0) <= WB_CONF_DATA;
+        wb_data_mux(31 downto 16) <= WB_ADDR_OFFSET & "00";
+      when WB_ADDR_OFFSET =>
+        wb_data_mux <= snap_ctrl;
+      when WB_ADDR_OFFSET + 1 =>
+        wb_data_mux(15 downto 0) <= SRC_OFFSET & "00";
+        wb_data_mux(31 downto 16) <= SRC_BYTES;
+      when WB_ADDR_OFFSET + 2 =>
+        wb_data_mux <= snap_ts;
+      when WB_ADDR_OFFSET + 3 =>
+        wb_data_mux <= (others => '0');
+        wb_data_mux(15 downto 0) <= IMG_OFFSET & "00";
+      when WB_ADDR_OFFSET + 4 =>
+        wb_data_mux <= dma_addr_reg & "00";
+      when WB_ADDR_OFFSET + 5 =>
+        wb_data_mux <= per_reg;
+      when WB_ADDR_OFFSET + 7 =>
+        wb_data_mux <= timestamp;
+      when others =>
+        wb_data_mux <= (others => '0');
+    end case;
+  end process;
+
+  P_WB_RD_REG : process(WB_RST, WB_CLK)
+  begin
+    if WB_RST = '1' then
+      wb_data_reg <= (others => '0');
+      img_sel_reg <= '0';
+    elsif rising_edge(WB_CLK) then
+      if WB_STB_RD = '1' then
+        wb_data_reg <= wb_data_mux;
+        img_sel_reg <= img_sel;
+      end if;
+    end if;
+  end process;
+
+  WB_DATA_OUT <= img_rd_data when img_sel_reg = '1' else wb_data_reg;
+
+  P_WB_WR : process(WB_RST, WB_CLK)
+  begin
+    if WB_RST = '1' then
+      snap_trig <= '0';
+      snap_en_reg <= '0';
+      dma_trig <= '0';
+      dma_en_reg <= '0';
+      dma_addr_reg <= (others => '0');
+      per_reg <= (others => '0');
+    elsif rising_edge(WB_CLK) then
+      snap_trig <= '0';
+      dma_trig <= '0';
+      if WB_STB_WR = '1' then
+        case WB_ADDR is
+          when WB_ADDR_OFFSET =>
+            -- latch and dma bits also set the mode of periodic snapshots
+            snap_trig <= WB_DATA_IN(0);
+            snap_en_reg <= WB_DATA_IN(2);
+            if DMA_EN then
+              dma_trig <= WB_DATA_IN(1);
+              dma_en_reg <= WB_DATA_IN(1);
+            end if;
+          when WB_ADDR_OFFSET + 4 =>
+            dma_addr_reg <= WB_DATA_IN(31 downto 2);
+          when WB_ADDR_OFFSET + 5 =>
+            per_reg <= WB_DATA_IN;
+          when others =>
+        end case;
+      end if;
+    end if;
+  end process;
+
+  ----------------------------------------------------------
+  --- process image ram
+  ----------------------------------------------------------
+  -- port a is shared by the sequencer and the dma source,
+  -- they never run at the same time. port b serves pci reads.
+  ram_we <= snap_we or snap_st or snap_tr;
+  ram_addr <= std_logic_vector(to_unsigned(SRC_LEN + 1, 16)) when snap_tr = '1' else
+              std_logic_vector(to_unsigned(SRC_LEN, 16)) when snap_st = '1' else
+              "00" & snap_we_idx when snap_we = '1' else
+              DMA_IDX;
+  ram_wr_data <= (snap_seq + 1) & x"000" & "000" & snap_latched when snap_tr = '1' else
+                 snap_ts when snap_st = '1' else
+                 SRC_DATA;
+
+  P_IMG_RAM : process(WB_CLK)
+  begin
+    if rising_edge(WB_CLK) then
+      if ram_we = '1' then
+        img_ram(conv_integer(ram_addr)) <= ram_wr_data;
+      end if;
+      DMA_DATA <= img_ram(conv_integer(ram_addr));
+      if img_sel = '1' then
+        img_rd_data <= img_ram(conv_integer(img_rd_idx));
+      end if;
+    end if;
+  end process;
+
+  ----------------------------------------------------------
+  --- timestamp generator
+  ----------------------------------------------------------
+  P_TIMESTAMP : process(WB_RST, WB_CLK)
+  begin
+    if WB_RST = '1' then
+      timestamp <= (others => '0');
+    elsif rising_edge(WB_CLK) then
+      timestamp <= timestamp + 1;
+    end if;
+  end process;
+
+  ----------------------------------------------------------
+  --- snapshot timer
+  ----------------------------------------------------------
+  -- triggers a snapshot every per_reg clocks, off while zero.
+  -- a new period applies with the next reload, so the host
+  -- may trim it every cycle.
+  P_PERIOD : process(WB_RST, WB_CLK)
+  begin
+    if WB_RST = '1' then
+      per_cnt <= (others => '0');
+      per_trig <= '0';
+    elsif rising_edge(WB_CLK) then
+      per_trig <= '0';
+      if per_reg = 0 then
+        per_cnt <= (others => '0');
+      elsif per_cnt = 0 then
+        per_cnt <= per_reg - 1;
+        per_trig <= '1';
+      else
+        per_cnt <= per_cnt - 1;
+      end if;
+    end if;
+  end process;
+
+  ----------------------------------------------------------
+  --- snapshot sequencer
+  ----------------------------------------------------------
+  -- pulses SNAP one clock ahead of the first read, so with
+  -- SNAP_EN the modules hold inputs of that very clock. then
+  -- reads all source registers back to back in ascending
+  -- address order, so capture registers keep their meaning.
+  -- read data appears one clock after the strobe. snapshot
+  -- time and the new ctrl word are stored behind the image,
+  -- the trailer flags latched images in bit 0. the dma push
+  -- is started if requested.
+  P_SNAP : process(WB_RST, WB_CLK)
+  begin
+    if WB_RST = '1' then
+      snap_busy <= '0';
+      snap_latch <= '0';
+      snap_latched <= '0';
+      snap_stb <= '0';
+      snap_idx <= (others => '0');
+      snap_we <= '0';
+      snap_we_idx <= (others => '0');
+      snap_st <= '0';
+      snap_tr <= '0';
+      snap_dma <= '0';
+      snap_seq <= (others => '0');
+      snap_ts <= (others => '0');
+      dma_start_reg <= '0';
+    elsif rising_edge(WB_CLK) then
+      snap_we <= snap_stb;
+      snap_we_idx <= snap_idx;
+      snap_st <= '0';
+      snap_tr <= '0';
+      dma_start_reg <= '0';
+
+      if snap_busy = '0' then
+        if (snap_trig = '1' or per_trig = '1') and DMA_BUSY = '0' then
+          snap_busy <= '1';
+          snap_latch <= '1';
+          snap_latched <= snap_en_reg;
+          snap_idx <= (others => '0');
+          -- never push to the cleared address after a reset
+          if dma_addr_reg /= 0 then
+            snap_dma <= dma_trig or (per_trig and dma_en_reg);
+          else
+            snap_dma <= '0';
+          end if;
+        end if;
+      elsif snap_latch = '1' then
+        snap_latch <= '0';
+        snap_stb <= '1';
+        snap_ts <= timestamp;
+      elsif snap_stb = '1' then
+        if snap_idx = SRC_LEN - 1 then
+          snap_stb <= '0';
+        else
+          snap_idx <= snap_idx + 1;
+        end if;
+      elsif snap_we = '1' then
+        snap_st <= '1';
+      elsif snap_st = '1' then
+        snap_tr <= '1';
+      elsif snap_tr = '1' then
+        snap_busy <= '0';
+        snap_seq <= snap_seq + 1;
+        dma_start_reg <= snap_dma;
+      end if;
+    end if;
+  end process;
+
+  SNAP <= snap_latch and snap_latched;
+  SNAP_EN <= snap_en_reg;
+
+  BUSY <= snap_busy;
+  SRC_ADDR <= SRC_OFFSET + snap_idx;
+  SRC_STB_RD <= snap_stb;
+
+  DMA_START <= dma_start_reg;
+  DMA_ADDR <= dma_addr_reg;
+  DMA_LEN <= std_logic_vector(to_unsigned(SRC_LEN + 2, 16));
+
+end;
@@ -27,6 +27,7 @@ entity PHPE_CHAN is
     pe_cos: in signed(15 downto 0);
 
     pe_pos_capt: in std_logic;
+    pe_pos_hold: in std_logic;
     pe_pos_cnt: out std_logic_vector(31 downto 0);
     pe_pos_sin: out std_logic_vector(31 downto 0);
     pe_pos_cos: out std_logic_vector(31 downto 0);
@@ -37,7 +38,14 @@ entity PHPE_CHAN is
 
     pe_area_cnt: out std_logic_vector(31 downto 0);
     pe_area_sin: out std_logic_vector(31 downto 0);
-    pe_area_cos: out std_logic_vector(31 downto 0)
+    pe_area_cos: out std_logic_vector(31 downto 0);
+
+    pe_probe: in std_logic;
+    pe_probe_arm: in std_logic;
+    pe_probe_flag: out std_logic;
+    pe_probe_cnt: out std_logic_vector(31 downto 0);
+    pe_probe_sin: out std_logic_vector(31 downto 0);
+    pe_probe_cos: out std_logic_vector(31 downto 0)
   );
 end;
 
@@ -55,6 +63,8 @@ architecture rtl of PHPE_CHAN is
   signal pe_ipol_step : std_logic_vector(16 downto 0);
 
   signal pe_enc_cnt: std_logic_vector(31 downto 0);
+  signal pe_pos_cnt_reg: std_logic_vector(31 downto 0);
+  signal pe_area_state_reg: std_logic;
   signal pe_sin_prod : signed(33 downto 0);
   signal pe_cos_prod : signed(33 downto 0);
   signal pe_sin_accu : signed(33 downto 0);
@@ -69,6 +79,11 @@ architecture rtl of PHPE_CHAN is
   signal pe_area_sin_reg: std_logic_vector(31 downto 0);
   signal pe_area_cos_reg: std_logic_vector(31 downto 0);
 
+  signal pe_probe_done: std_logic;
+  signal pe_probe_cnt_reg: std_logic_vector(31 downto 0);
+  signal pe_probe_sin_reg: std_logic_vector(31 downto 0);
+  signal pe_probe_cos_reg: std_logic_vector(31 downto 0);
+
 begin
 
   ----------------------------------------------------------
@@ -182,24 +197,37 @@ begin
   pe_sin_prod <= unsigned(pe_ipol_reg) * pe_sin;
   pe_cos_prod <= unsigned(pe_ipol_reg) * pe_cos;
 
-  pe_pos_cnt <= pe_enc_cnt;
+  -- count and area state are live unless held for the global latch
+  pe_pos_cnt <= pe_pos_cnt_reg when pe_pos_hold = '1' else pe_enc_cnt;
 
   P_PE_POS_CAPT : process(RESET, WB_CLK)
   begin
     if RESET = '1' then
+      pe_pos_cnt_reg <= (others => '0');
       pe_pos_sin <= (others => '0');
       pe_pos_cos <= (others => '0');
+      pe_area_state_reg <= '0';
       pe_area_cnt <= (others => '0');
       pe_area_sin <= (others => '0');
       pe_area_cos <= (others => '0');
+      pe_probe_flag <= '0';
+      pe_probe_cnt <= (others => '0');
+      pe_probe_sin <= (others => '0');
+      pe_probe_cos <= (others => '0');
     elsif rising_edge(WB_CLK) then
       if pe_pos_capt = '1' then
+        pe_pos_cnt_reg <= pe_enc_cnt;
         pe_pos_sin <= pe_sin_reg;
         pe_pos_cos <= pe_cos_reg;
         pe_area_flag <= pe_area_done;
+        pe_area_state_reg <= pe_area_sync(0);
         pe_area_cnt <= pe_area_cnt_reg;
         pe_area_sin <= pe_area_sin_reg;
         pe_area_cos <= pe_area_cos_reg;
+        pe_probe_flag <= pe_probe_done;
+        pe_probe_cnt <= pe_probe_cnt_reg;
+        pe_probe_sin <= pe_probe_sin_reg;
+        pe_probe_cos <= pe_probe_cos_reg;
       end if;
     end if;
   end process;
@@ -228,7 +256,30 @@ begin
     end if;
   end process;
 
-  pe_area_state <= pe_area_sync(0);
+  ----------------------------------------------------------
+  --- probe latch
+  ----------------------------------------------------------
+  -- first probe strobe while armed, held until the arm bit is cleared
+  P_PE_PROBE : process(RESET, WB_CLK)
+  begin
+    if RESET = '1' then
+      pe_probe_done <= '0';
+      pe_probe_cnt_reg <= (others => '0');
+      pe_probe_sin_reg <= (others => '0');
+      pe_probe_cos_reg <= (others => '0');
+    elsif rising_edge(WB_CLK) then
+      if pe_probe_arm = '0' then
+        pe_probe_done <= '0';
+      elsif pe_probe_done = '0' and pe_probe = '1' then
+        pe_probe_done <= '1';
+        pe_probe_cnt_reg <= pe_enc_cnt;
+        pe_probe_sin_reg <= pe_sin_reg;
+        pe_probe_cos_reg <= pe_cos_reg;
+      end if;
+    end if;
+  end process;
+
+  pe_area_state <= pe_area_state_reg when pe_pos_hold = '1' else pe_area_sync(0);
 
 end;
 
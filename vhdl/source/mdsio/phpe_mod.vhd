@@ -8,10 +8,11 @@ library UNISIM;
 
 entity PHPE_MOD is
   generic (
-    -- IO-REQ: 15 DWORD
+    -- IO-REQ: 3 + 9 * CHANNELS DWORD
     WB_CONF_OFFSET: std_logic_vector(15 downto 2) := "00000000000000";
-    WB_CONF_DATA:   std_logic_vector(15 downto 0) := "0000000000000110";
-    WB_ADDR_OFFSET: std_logic_vector(15 downto 2) := "00000000000000"
+    WB_CONF_DATA:   std_logic_vector(15 downto 0) := "0000000100000110";
+    WB_ADDR_OFFSET: std_logic_vector(15 downto 2) := "00000000000000";
+    CHANNELS: integer range 1 to 4 := 2
   );
   port (
     CLK100: in std_logic;
@@ -24,11 +25,23 @@ entity PHPE_MOD is
     WB_STB_RD: in std_logic;
     WB_STB_WR: in std_logic;
 
-    SV : inout std_logic_vector(10 downto 3)
+    SNAP: in std_logic;
+    SNAP_EN: in std_logic;
+    PROBE: in std_logic;
+
+    TRAMS: in std_logic_vector(CHANNELS - 1 downto 0);
+    AREA: in std_logic_vector(CHANNELS - 1 downto 0);
+    SCAN_OUT: out std_logic;
+    TRARS_OUT: out std_logic
   );
 end;
 
 architecture rtl of PHPE_MOD is
+  -- per channel: pos cnt/sin/cos, area cnt/sin/cos, probe cnt/sin/cos
+  constant CHAN_WORDS: integer := 9;
+
+  type reg_array_t is array (0 to CHAN_WORDS * CHANNELS - 1) of std_logic_vector(31 downto 0);
+
   signal wb_data_mux : std_logic_vector(31 downto 0);
 
   signal pe_reg_top   : std_logic_vector(15 downto 0);
@@ -36,27 +49,14 @@ architecture rtl of PHPE_MOD is
   signal pe_reg_disch : std_logic_vector(15 downto 0);
   signal pe_reg_take  : std_logic_vector(15 downto 0);
 
-  signal pe_pos_capt_a : std_logic;
-  signal pe_pos_cnt_a : std_logic_vector(31 downto 0);
-  signal pe_pos_sin_a : std_logic_vector(31 downto 0);
-  signal pe_pos_cos_a : std_logic_vector(31 downto 0);
-  signal pe_area_cnt_a : std_logic_vector(31 downto 0);
-  signal pe_area_sin_a : std_logic_vector(31 downto 0);
-  signal pe_area_cos_a : std_logic_vector(31 downto 0);
-  signal pe_area_pol_a : std_logic;
-  signal pe_area_flag_a : std_logic;
-  signal pe_area_state_a : std_logic;
-
-  signal pe_pos_capt_b : std_logic;
-  signal pe_pos_cnt_b : std_logic_vector(31 downto 0);
-  signal pe_pos_sin_b : std_logic_vector(31 downto 0);
-  signal pe_pos_cos_b : std_logic_vector(31 downto 0);
-  signal pe_area_cnt_b : std_logic_vector(31 downto 0);
-  signal pe_area_sin_b : std_logic_vector(31 downto 0);
-  signal pe_area_cos_b : std_logic_vector(31 downto 0);
-  signal pe_area_pol_b : std_logic;
-  signal pe_area_flag_b : std_logic;
-  signal pe_area_state_b : std_logic;
+  signal pe_regs : reg_array_t;
+  signal pe_pos_rd : std_logic_vector(CHANNELS - 1 downto 0);
+  signal pe_pos_capt : std_logic_vector(CHANNELS - 1 downto 0);
+  signal pe_area_pol : std_logic_vector(CHANNELS - 1 downto 0);
+  signal pe_area_flag : std_logic_vector(CHANNELS - 1 downto 0);
+  signal pe_area_state : std_logic_vector(CHANNELS - 1 downto 0);
+  signal pe_probe_arm : std_logic_vector(CHANNELS - 1 downto 0);
+  signal pe_probe_flag : std_logic_vector(CHANNELS - 1 downto 0);
 
   signal pe_scan_cnt  : std_logic_vector(15 downto 0);
   signal pe_scan_cnt_ena : std_logic;
@@ -93,61 +93,46 @@ begin
   ----------------------------------------------------------
   --- bus logic
   ----------------------------------------------------------
+  -- conf word: channels(15..12), layout version(11..8), type(7..0)
   P_WB_RD : process(WB_ADDR, WB_STB_RD, pe_reg_top, pe_reg_scan, pe_reg_disch, pe_reg_take,
-    pe_pos_cnt_a, pe_pos_sin_a, pe_pos_cos_a, pe_area_cnt_a, pe_area_sin_a, pe_area_cos_a, pe_area_pol_a, pe_area_flag_a, pe_area_state_a,
-    pe_pos_cnt_b, pe_pos_sin_b, pe_pos_cos_b, pe_area_cnt_b, pe_area_sin_b, pe_area_cos_b, pe_area_pol_b, pe_area_flag_b, pe_area_state_b)
+    pe_regs, pe_area_pol, pe_area_flag, pe_area_state, pe_probe_flag)
+    variable word: integer;
   begin
-    pe_pos_capt_a <= '0';
-    pe_pos_capt_b <= '0';
-    case WB_ADDR is
-      when WB_CONF_OFFSET =>
-        wb_data_mux(15 downto 0) <= WB_CONF_DATA;
-        wb_data_mux(31 downto 16) <= WB_ADDR_OFFSET & "00";
-      when WB_ADDR_OFFSET =>
-        wb_data_mux     <= (others => '0');
-        wb_data_mux(0)  <= pe_area_pol_a;
-        wb_data_mux(1)  <= pe_area_state_a;
-        wb_data_mux(2)  <= pe_area_flag_a;
-        wb_data_mux(8)  <= pe_area_pol_b;
-        wb_data_mux(9)  <= pe_area_state_b;
-        wb_data_mux(10) <= pe_area_flag_b;
-      when WB_ADDR_OFFSET + 1 =>
-        wb_data_mux(15 downto 0)  <= pe_reg_top;
-        wb_data_mux(31 downto 16) <= pe_reg_scan;
-      when WB_ADDR_OFFSET + 2 =>
-        wb_data_mux(15 downto 0)  <= pe_reg_disch;
-        wb_data_mux(31 downto 16) <= pe_reg_take;
-      when WB_ADDR_OFFSET + 3 =>
-        pe_pos_capt_a <= WB_STB_RD;
-        wb_data_mux <= pe_pos_cnt_a;
-      when WB_ADDR_OFFSET + 4 =>
-        wb_data_mux <= pe_pos_sin_a;
-      when WB_ADDR_OFFSET + 5 =>
-        wb_data_mux <= pe_pos_cos_a;
-      when WB_ADDR_OFFSET + 6 =>
-        wb_data_mux <= pe_area_cnt_a;
-      when WB_ADDR_OFFSET + 7 =>
-        wb_data_mux <= pe_area_sin_a;
-      when WB_ADDR_OFFSET + 8 =>
-        wb_data_mux <= pe_area_cos_a;
-      when WB_ADDR_OFFSET + 9 =>
-        pe_pos_capt_b <= WB_STB_RD;
-        wb_data_mux <= pe_pos_cnt_b;
-      when WB_ADDR_OFFSET + 10 =>
-        wb_data_mux <= pe_pos_sin_b;
-      when WB_ADDR_OFFSET + 11 =>
-        wb_data_mux <= pe_pos_cos_b;
-      when WB_ADDR_OFFSET + 12 =>
-        wb_data_mux <= pe_area_cnt_b;
-      when WB_ADDR_OFFSET + 13 =>
-        wb_data_mux <= pe_area_sin_b;
-      when WB_ADDR_OFFSET + 14 =>
-        wb_data_mux <= pe_area_cos_b;
-      when others => 
-        wb_data_mux <= (others => '0');
-    end case;
+    pe_pos_rd <= (others => '0');
+    word := conv_integer(WB_ADDR - WB_ADDR_OFFSET) - 3;
+    if WB_ADDR = WB_CONF_OFFSET then
+      wb_data_mux(15 downto 0) <= conv_std_logic_vector(CHANNELS, 4) & WB_CONF_DATA(11 downto 0);
+      wb_data_mux(31 downto 16) <= WB_ADDR_OFFSET & "00";
+    elsif WB_ADDR = WB_ADDR_OFFSET then
+      -- 8 flag bits per channel
+      wb_data_mux <= (others => '0');
+      for i in 0 to CHANNELS - 1 loop
+        wb_data_mux(8 * i)     <= pe_area_pol(i);
+        wb_data_mux(8 * i + 1) <= pe_area_state(i);
+        wb_data_mux(8 * i + 2) <= pe_area_flag(i);
+        wb_data_mux(8 * i + 3) <= pe_probe_flag(i);
+      end loop;
+    elsif WB_ADDR = WB_ADDR_OFFSET + 1 then
+      wb_data_mux(15 downto 0)  <= pe_reg_top;
+      wb_data_mux(31 downto 16) <= pe_reg_scan;
+    elsif WB_ADDR = WB_ADDR_OFFSET + 2 then
+      wb_data_mux(15 downto 0)  <= pe_reg_disch;
+      wb_data_mux(31 downto 16) <= pe_reg_take;
+    elsif WB_ADDR > WB_ADDR_OFFSET + 2 and WB_ADDR < WB_ADDR_OFFSET + 3 + CHAN_WORDS * CHANNELS then
+      -- reading the count word captures the channel
+      if word mod CHAN_WORDS = 0 then
+        pe_pos_rd(word / CHAN_WORDS) <= WB_STB_RD;
+      end if;
+      wb_data_mux <= pe_regs(word);
+    else
+      wb_data_mux <= (others => '0');
+    end if;
   end process;
 
+  -- with the global latch all channels are captured by the
+  -- snapshot strobe instead of the count word reads
+  pe_pos_capt <= (others => SNAP) when SNAP_EN = '1' else pe_pos_rd;
+
   P_WB_RD_REG : process(WB_RST, WB_CLK)
   begin
     if WB_RST = '1' then
@@ -166,22 +151,22 @@ begin
       pe_reg_scan <= (others => '0');
       pe_reg_disch <= (others => '0');
       pe_reg_take <= (others => '0');
-      pe_area_pol_a   <= '0';
-      pe_area_pol_b   <= '0';
+      pe_area_pol <= (others => '0');
+      pe_probe_arm <= (others => '0');
     elsif rising_edge(WB_CLK) then
       if WB_STB_WR = '1' then
-        case WB_ADDR is
-          when WB_ADDR_OFFSET =>
-            pe_area_pol_a   <= WB_DATA_IN(0);
-            pe_area_pol_b   <= WB_DATA_IN(8);
-          when WB_ADDR_OFFSET + 1 =>
-            pe_reg_top <= WB_DATA_IN(15 downto 0);
-            pe_reg_scan <= WB_DATA_IN(31 downto 16);
-          when WB_ADDR_OFFSET + 2 =>
-            pe_reg_disch <= WB_DATA_IN(15 downto 0);
-            pe_reg_take <= WB_DATA_IN(31 downto 16);
-          when others =>
-        end case;
+        if WB_ADDR = WB_ADDR_OFFSET then
+          for i in 0 to CHANNELS - 1 loop
+            pe_area_pol(i)  <= WB_DATA_IN(8 * i);
+            pe_probe_arm(i) <= WB_DATA_IN(8 * i + 3);
+          end loop;
+        elsif WB_ADDR = WB_ADDR_OFFSET + 1 then
+          pe_reg_top <= WB_DATA_IN(15 downto 0);
+          pe_reg_scan <= WB_DATA_IN(31 downto 16);
+        elsif WB_ADDR = WB_ADDR_OFFSET + 2 then
+          pe_reg_disch <= WB_DATA_IN(15 downto 0);
+          pe_reg_take <= WB_DATA_IN(31 downto 16);
+        end if;
       end if;
     end if;
   end process;
@@ -383,81 +368,55 @@ begin
   ----------------------------------------------------------
   --- channel instances
   ----------------------------------------------------------
-  U_PECHAN_A: entity work.PHPE_CHAN
-    port map (
-      RESET => WB_RST,
-      CLK100 => CLK100,
-      WB_CLK => WB_CLK,
-
-      TRAMS => not SV(8),
-      AREA => not SV(10),
-
-      pe_scan_cnt_top => pe_scan_cnt_top,
-      pe_scan_ovs_top => pe_scan_ovs_top,
-      pe_scan_ovs => pe_scan_ovs,
-      pe_trars_cnt_bot => pe_trars_cnt_bot,
-
-      pe_disch_int => pe_disch_int,
-      pe_take_int => pe_take_int,
-
-      pe_sin => pe_sin,
-      pe_cos => pe_cos,
-
-      pe_pos_capt => pe_pos_capt_a,
-      pe_pos_cnt => pe_pos_cnt_a,
-      pe_pos_sin => pe_pos_sin_a,
-      pe_pos_cos => pe_pos_cos_a,
-
-      pe_area_pol => pe_area_pol_a,
-      pe_area_flag => pe_area_flag_a,
-      pe_area_state => pe_area_state_a,
-
-      pe_area_cnt => pe_area_cnt_a,
-      pe_area_sin => pe_area_sin_a,
-      pe_area_cos => pe_area_cos_a
-    );
-
-  U_PECHAN_B: entity work.PHPE_CHAN
-    port map (
-      RESET => WB_RST,
-      CLK100 => CLK100,
-      WB_CLK => WB_CLK,
-
-      TRAMS => not SV(7),
-      AREA => not SV(9),
-
-      pe_scan_cnt_top => pe_scan_cnt_top,
-      pe_scan_ovs_top => pe_scan_ovs_top,
-      pe_scan_ovs => pe_scan_ovs,
-      pe_trars_cnt_bot => pe_trars_cnt_bot,
-
-      pe_disch_int => pe_disch_int,
-      pe_take_int => pe_take_int,
-
-      pe_sin => pe_sin,
-      pe_cos => pe_cos,
-
-      pe_pos_capt => pe_pos_capt_b,
-      pe_pos_cnt => pe_pos_cnt_b,
-      pe_pos_sin => pe_pos_sin_b,
-      pe_pos_cos => pe_pos_cos_b,
-
-      pe_area_pol => pe_area_pol_b,
-      pe_area_flag => pe_area_flag_b,
-      pe_area_state => pe_area_state_b,
-
-      pe_area_cnt => pe_area_cnt_b,
-      pe_area_sin => pe_area_sin_b,
-      pe_area_cos => pe_area_cos_b
-    );
+  G_PECHAN: for i in 0 to CHANNELS - 1 generate
+    U_PECHAN: entity work.PHPE_CHAN
+      port map (
+        RESET => WB_RST,
+        CLK100 => CLK100,
+        WB_CLK => WB_CLK,
+
+        TRAMS => TRAMS(i),
+        AREA => AREA(i),
+
+        pe_scan_cnt_top => pe_scan_cnt_top,
+        pe_scan_ovs_top => pe_scan_ovs_top,
+        pe_scan_ovs => pe_scan_ovs,
+        pe_trars_cnt_bot => pe_trars_cnt_bot,
+
+        pe_disch_int => pe_disch_int,
+        pe_take_int => pe_take_int,
+
+        pe_sin => pe_sin,
+        pe_cos => pe_cos,
+
+        pe_pos_capt => pe_pos_capt(i),
+        pe_pos_hold => SNAP_EN,
+        pe_pos_cnt => pe_regs(CHAN_WORDS * i),
+        pe_pos_sin => pe_regs(CHAN_WORDS * i + 1),
+        pe_pos_cos => pe_regs(CHAN_WORDS * i + 2),
+
+        pe_area_pol => pe_area_pol(i),
+        pe_area_flag => pe_area_flag(i),
+        pe_area_state => pe_area_state(i),
+
+        pe_area_cnt => pe_regs(CHAN_WORDS * i + 3),
+        pe_area_sin => pe_regs(CHAN_WORDS * i + 4),
+        pe_area_cos => pe_regs(CHAN_WORDS * i + 5),
+
+        pe_probe => PROBE,
+        pe_probe_arm => pe_probe_arm(i),
+        pe_probe_flag => pe_probe_flag(i),
+        pe_probe_cnt => pe_regs(CHAN_WORDS * i + 6),
+        pe_probe_sin => pe_regs(CHAN_WORDS * i + 7),
+        pe_probe_cos => pe_regs(CHAN_WORDS * i + 8)
+      );
+  end generate;
 
   ----------------------------------------------------------
   --- output mapping
   ----------------------------------------------------------
-  SV(3) <= '0';
-  SV(4) <= '0';
-  SV(5) <= pe_scan_cnt_ena and (not pe_scan);
-  SV(6) <= pe_scan_cnt_ena and (not pe_trars);
+  SCAN_OUT <= pe_scan_cnt_ena and (not pe_scan);
+  TRARS_OUT <= pe_scan_cnt_ena and (not pe_trars);
 
 end;
 
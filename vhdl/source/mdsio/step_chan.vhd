@@ -14,9 +14,14 @@ entity STEP_CHAN is
     pos_capt: in std_logic;
     pos_hi: out std_logic_vector(31 downto 0);
     pos_lo: out std_logic_vector(31 downto 0);
+    vel_capt: out std_logic_vector(31 downto 0);
 
     targetvel: in std_logic_vector(31 downto 0);
     deltalim: in std_logic_vector(31 downto 0);
+    pos_mode: in std_logic;
+    maxvel: in std_logic_vector(30 downto 0);
+    cmd_load: in std_logic;
+    cmd_pos: in std_logic_vector(63 downto 0);
     step_len: in std_logic_vector(31 downto 0);
     dir_hold_dly: in std_logic_vector(31 downto 0);
     dir_setup_dly: in std_logic_vector(31 downto 0);
@@ -30,12 +35,27 @@ entity STEP_CHAN is
 end;
 
 architecture rtl of STEP_CHAN is
+  -- position loop update: sample, 32 multiply steps, 32 root steps
+  constant PL_CLOCKS: integer := 67;
 
   signal vel: std_logic_vector(47 downto 0);
   signal vel_target: std_logic_vector(47 downto 0);
   signal vel_delta_lim_pos: std_logic_vector(47 downto 0);
   signal vel_delta_lim_neg: std_logic_vector(47 downto 0);
   signal vel_delta: std_logic_vector(47 downto 0);
+  signal vel_pos: std_logic_vector(47 downto 0);
+
+  signal cmd: std_logic_vector(63 downto 0);
+  signal cmd_inc: std_logic_vector(63 downto 0);
+  signal pos_err: std_logic_vector(63 downto 0);
+  signal pl_cnt: integer range 0 to PL_CLOCKS - 1;
+  signal pl_neg: std_logic;
+  signal pl_err: std_logic_vector(40 downto 0);
+  signal pl_lim: std_logic_vector(31 downto 0);
+  signal pl_prod: std_logic_vector(72 downto 0);
+  signal pl_rad: std_logic_vector(63 downto 0);
+  signal pl_rem: std_logic_vector(33 downto 0);
+  signal pl_root: std_logic_vector(31 downto 0);
 
   signal timer_step_len: std_logic_vector(31 downto 0);
   signal timer_step_len_run: std_logic;
@@ -54,16 +74,19 @@ architecture rtl of STEP_CHAN is
   signal stepflag: std_logic;
 
 begin
-  -- set position output
-  pos_hi <= accu(63 downto 32);
-
+  -- capture the whole accumulator and the current velocity
+  -- (addval units, like targetvel) in the same clock
   capture_proc: process(RESET, CLK)
   begin
     if RESET = '1' then
+        pos_hi <= (others => '0');
         pos_lo <= (others => '0');
+        vel_capt <= (others => '0');
     elsif rising_edge(CLK) then
       if pos_capt = '1' then
+        pos_hi <= accu(63 downto 32);
         pos_lo <= accu(31 downto 0);
+        vel_capt <= vel(47 downto 16);
       end if;
     end if;
   end process;
@@ -73,8 +96,11 @@ begin
   timer_dir_hold_dly_run  <= '1' when timer_dir_hold_dly /= 0 else '0';
   timer_dir_setup_dly_run <= '1' when timer_dir_setup_dly /= 0 else '0';
   
-  -- calc velocity delta limit
-  vel_target <= targetvel & "0000000000000000" when OUT_EN = '1' else (others => '0');
+  -- calc velocity delta limit, the target comes from the
+  -- position loop in position mode
+  vel_target <= (others => '0') when OUT_EN = '0' else
+                vel_pos when pos_mode = '1' else
+                targetvel & "0000000000000000";
   vel_delta_lim_pos <= "0000000000000000" & deltalim;
   vel_delta_lim_neg <= 0 - vel_delta_lim_pos;
   vel_delta <= vel_target - vel;
@@ -139,6 +165,130 @@ begin
     end if;
   end process;
 
+  ----------------------------------------------------------
+  --- position mode
+  ----------------------------------------------------------
+  -- the command is loaded with the position the host wrote for
+  -- this servo cycle and extrapolated with the feed forward
+  -- velocity (targetvel) on every clock.
+  cmd_inc(63 downto 32) <= (others => targetvel(31));
+  cmd_inc(31 downto 0) <= targetvel;
+  pos_err <= cmd - accu;
+
+  cmd_proc: process(RESET, CLK)
+  begin
+    if RESET = '1' then
+      cmd <= (others => '0');
+    elsif rising_edge(CLK) then
+      if cmd_load = '1' then
+        cmd <= cmd_pos;
+      elsif pos_mode = '1' and OUT_EN = '1' then
+        cmd <= cmd + cmd_inc;
+      end if;
+    end if;
+  end process;
+
+  -- the loop corrects the error with the velocity it can still
+  -- brake from at deltalim: v = sqrt(2 * deltalim * err), in vel
+  -- units (err scaled down by 2^16, the root scaled up by 2^16).
+  -- feed forward plus correction is limited to maxvel, the ramp
+  -- above applies the accel limit.
+  pos_loop_proc: process(RESET, CLK)
+    variable abs_err: std_logic_vector(63 downto 0);
+    variable prod: std_logic_vector(72 downto 0);
+    variable rem_v: std_logic_vector(33 downto 0);
+    variable corr: std_logic_vector(48 downto 0);
+    variable sum: std_logic_vector(48 downto 0);
+    variable lim: std_logic_vector(48 downto 0);
+    variable lim_neg: std_logic_vector(48 downto 0);
+  begin
+    if RESET = '1' then
+      pl_cnt <= 0;
+      pl_neg <= '0';
+      pl_err <= (others => '0');
+      pl_lim <= (others => '0');
+      pl_prod <= (others => '0');
+      pl_rad <= (others => '0');
+      pl_rem <= (others => '0');
+      pl_root <= (others => '0');
+      vel_pos <= (others => '0');
+    elsif rising_edge(CLK) then
+      if pl_cnt = PL_CLOCKS - 1 then
+        pl_cnt <= 0;
+      else
+        pl_cnt <= pl_cnt + 1;
+      end if;
+
+      if pl_cnt = 0 then
+        -- sample error and accel limit
+        if pos_err(63) = '1' then
+          abs_err := 0 - pos_err;
+        else
+          abs_err := pos_err;
+        end if;
+        pl_neg <= pos_err(63);
+        if abs_err(63 downto 56) /= 0 then
+          pl_err <= (others => '1');
+        else
+          pl_err <= abs_err(55 downto 16) & '0';
+        end if;
+        pl_lim <= deltalim;
+        pl_prod <= (others => '0');
+
+      elsif pl_cnt <= 32 then
+        -- shift and add multiply, msb of deltalim first
+        prod := pl_prod(71 downto 0) & '0';
+        if pl_lim(31) = '1' then
+          prod := prod + pl_err;
+        end if;
+        pl_prod <= prod;
+        pl_lim <= pl_lim(30 downto 0) & '0';
+
+      elsif pl_cnt = 33 then
+        -- saturate to the root input
+        if pl_prod(72 downto 64) /= 0 then
+          pl_rad <= (others => '1');
+        else
+          pl_rad <= pl_prod(63 downto 0);
+        end if;
+        pl_rem <= (others => '0');
+        pl_root <= (others => '0');
+
+      elsif pl_cnt <= 65 then
+        -- restoring square root, two radicand bits per step
+        rem_v := pl_rem(31 downto 0) & pl_rad(63 downto 62);
+        pl_rad <= pl_rad(61 downto 0) & "00";
+        if rem_v >= (pl_root & "01") then
+          pl_rem <= rem_v - (pl_root & "01");
+          pl_root <= pl_root(30 downto 0) & '1';
+        else
+          pl_rem <= rem_v;
+          pl_root <= pl_root(30 downto 0) & '0';
+        end if;
+
+      else
+        -- new velocity target
+        lim := "00" & maxvel & "0000000000000000";
+        lim_neg := 0 - lim;
+        if pl_root > ('0' & maxvel) then
+          corr := lim;
+        else
+          corr := '0' & pl_root & "0000000000000000";
+        end if;
+        if pl_neg = '1' then
+          corr := 0 - corr;
+        end if;
+        sum := (targetvel(31) & targetvel & "0000000000000000") + corr;
+        if signed(sum) > signed(lim) then
+          sum := lim;
+        elsif signed(sum) < signed(lim_neg) then
+          sum := lim_neg;
+        end if;
+        vel_pos <= sum(47 downto 0);
+      end if;
+    end if;
+  end process;
+
   -- generate step pulse
   STP_OUT <= timer_step_len_run;
 
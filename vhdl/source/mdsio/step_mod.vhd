@@ -8,10 +8,11 @@ library UNISIM;
 
 entity STEP_MOD is
   generic (
-    -- IO-REQ: 19 DWORD
+    -- IO-REQ: 4 + 8 * CHANNELS DWORD
     WB_CONF_OFFSET: std_logic_vector(15 downto 2) := "00000000000000";
-    WB_CONF_DATA:   std_logic_vector(15 downto 0) := "0000000000000101";
-    WB_ADDR_OFFSET: std_logic_vector(15 downto 2) := "00000000000000"
+    WB_CONF_DATA:   std_logic_vector(15 downto 0) := "0000001000000101";
+    WB_ADDR_OFFSET: std_logic_vector(15 downto 2) := "00000000000000";
+    CHANNELS: integer range 1 to 7 := 4
   );
   port (
     OUT_EN: in std_logic;
@@ -25,11 +26,21 @@ entity STEP_MOD is
     WB_STB_RD: in std_logic;
     WB_STB_WR: in std_logic;
 
-    SV : inout std_logic_vector(10 downto 3)
+    SNAP: in std_logic;
+    SNAP_EN: in std_logic;
+
+    STP_OUT: out std_logic_vector(CHANNELS - 1 downto 0);
+    STP_DIR: out std_logic_vector(CHANNELS - 1 downto 0)
   );
 end;
 
 architecture rtl of STEP_MOD is
+  -- timing words and the timebase, then per channel: targetvel,
+  -- deltalim, pos_hi, pos_lo, vel, cmd_hi, cmd_lo,
+  -- posctl (position mode(31), maxvel(30..0))
+  constant CHAN_WORDS: integer := 8;
+
+  type reg_array_t is array (0 to CHANNELS - 1) of std_logic_vector(31 downto 0);
 
   signal wb_data_mux : std_logic_vector(31 downto 0);
 
@@ -37,93 +48,97 @@ architecture rtl of STEP_MOD is
   signal dir_hold_dly: std_logic_vector(31 downto 0);
   signal dir_setup_dly: std_logic_vector(31 downto 0);
 
-  signal targetvel_a: std_logic_vector(31 downto 0);
-  signal deltalim_a: std_logic_vector(31 downto 0);
-  signal pos_capt_a: std_logic;
-  signal pos_hi_a: std_logic_vector(31 downto 0);
-  signal pos_lo_a: std_logic_vector(31 downto 0);
-  signal idle_a: std_logic;
-
-  signal targetvel_b: std_logic_vector(31 downto 0);
-  signal deltalim_b: std_logic_vector(31 downto 0);
-  signal pos_capt_b: std_logic;
-  signal pos_hi_b: std_logic_vector(31 downto 0);
-  signal pos_lo_b: std_logic_vector(31 downto 0);
-  signal idle_b: std_logic;
-
-  signal targetvel_c: std_logic_vector(31 downto 0);
-  signal deltalim_c: std_logic_vector(31 downto 0);
-  signal pos_capt_c: std_logic;
-  signal pos_hi_c: std_logic_vector(31 downto 0);
-  signal pos_lo_c: std_logic_vector(31 downto 0);
-  signal idle_c: std_logic;
-
-  signal targetvel_d: std_logic_vector(31 downto 0);
-  signal deltalim_d: std_logic_vector(31 downto 0);
-  signal pos_capt_d: std_logic;
-  signal pos_hi_d: std_logic_vector(31 downto 0);
-  signal pos_lo_d: std_logic_vector(31 downto 0);
-  signal idle_d: std_logic;
+  signal capture: std_logic;
+  signal capture_rd: std_logic;
+  signal timestamp: std_logic_vector(31 downto 0);
+  signal snap_ts: std_logic_vector(31 downto 0);
+
+  signal targetvel: reg_array_t;
+  signal deltalim: reg_array_t;
+  signal pos_hi: reg_array_t;
+  signal pos_lo: reg_array_t;
+  signal vel: reg_array_t;
+  signal cmd_hi: reg_array_t;
+  signal cmd_lo: reg_array_t;
+  signal cmd_load: std_logic_vector(CHANNELS - 1 downto 0);
+  signal posctl: reg_array_t;
+  signal idle_chan: std_logic_vector(CHANNELS - 1 downto 0);
 
 begin
   ----------------------------------------------------------
   --- bus logic
   ----------------------------------------------------------
-  P_WB_RD : process(WB_ADDR)
+  -- conf word: channels(15..12), layout version(11..8), type(7..0)
+  P_WB_RD : process(WB_ADDR, WB_STB_RD, SNAP_EN, timestamp, snap_ts, step_len, dir_hold_dly, dir_setup_dly, targetvel, deltalim, pos_hi, pos_lo, vel, cmd_hi, cmd_lo, posctl)
+    variable word: integer;
+    variable chan: integer;
   begin
-    pos_capt_a <= '0';
-    pos_capt_b <= '0';
-    pos_capt_c <= '0';
-    pos_capt_d <= '0';
-    case WB_ADDR is
-      when WB_CONF_OFFSET =>
-        wb_data_mux(15 downto 0) <= WB_CONF_DATA;
-        wb_data_mux(31 downto 16) <= WB_ADDR_OFFSET & "00";
-      when WB_ADDR_OFFSET =>
-        wb_data_mux <= step_len;
-      when WB_ADDR_OFFSET + 1 =>
-        wb_data_mux <= dir_hold_dly;
-      when WB_ADDR_OFFSET + 2 =>
-        wb_data_mux <= dir_setup_dly;
-      when WB_ADDR_OFFSET + 3 =>
-        wb_data_mux <= targetvel_a;
-      when WB_ADDR_OFFSET + 4 =>
-        wb_data_mux <= deltalim_a;
-      when WB_ADDR_OFFSET + 5 =>
-        pos_capt_a <= WB_STB_RD;
-        wb_data_mux <= pos_hi_a;
-      when WB_ADDR_OFFSET + 6 =>
-        wb_data_mux <= pos_lo_a;
-      when WB_ADDR_OFFSET + 7 =>
-        wb_data_mux <= targetvel_b;
-      when WB_ADDR_OFFSET + 8 =>
-        wb_data_mux <= deltalim_b;
-      when WB_ADDR_OFFSET + 9 =>
-        pos_capt_b <= WB_STB_RD;
-        wb_data_mux <= pos_hi_b;
-      when WB_ADDR_OFFSET + 10 =>
-        wb_data_mux <= pos_lo_b;
-      when WB_ADDR_OFFSET + 11 =>
-        wb_data_mux <= targetvel_c;
-      when WB_ADDR_OFFSET + 12 =>
-        wb_data_mux <= deltalim_c;
-      when WB_ADDR_OFFSET + 13 =>
-        pos_capt_c <= WB_STB_RD;
-        wb_data_mux <= pos_hi_c;
-      when WB_ADDR_OFFSET + 14 =>
-        wb_data_mux <= pos_lo_c;
-      when WB_ADDR_OFFSET + 15 =>
-        wb_data_mux <= targetvel_d;
-      when WB_ADDR_OFFSET + 16 =>
-        wb_data_mux <= deltalim_d;
-      when WB_ADDR_OFFSET + 17 =>
-        pos_capt_d <= WB_STB_RD;
-        wb_data_mux <= pos_hi_d;
-      when WB_ADDR_OFFSET + 18 =>
-        wb_data_mux <= pos_lo_d;
-      when others => 
-        wb_data_mux <= (others => '0');
-    end case;
+    capture_rd <= '0';
+    word := conv_integer(WB_ADDR - WB_ADDR_OFFSET) - 4;
+    chan := word / CHAN_WORDS;
+    if WB_ADDR = WB_CONF_OFFSET then
+      wb_data_mux(15 downto 0) <= std_logic_vector(to_unsigned(CHANNELS, 4)) & WB_CONF_DATA(11 downto 0);
+      wb_data_mux(31 downto 16) <= WB_ADDR_OFFSET & "00";
+    elsif WB_ADDR = WB_ADDR_OFFSET then
+      wb_data_mux <= step_len;
+    elsif WB_ADDR = WB_ADDR_OFFSET + 1 then
+      wb_data_mux <= dir_hold_dly;
+    elsif WB_ADDR = WB_ADDR_OFFSET + 2 then
+      wb_data_mux <= dir_setup_dly;
+    elsif WB_ADDR = WB_ADDR_OFFSET + 3 then
+      -- reading the timebase captures all channels
+      capture_rd <= WB_STB_RD;
+      if SNAP_EN = '1' then
+        wb_data_mux <= snap_ts;
+      else
+        wb_data_mux <= timestamp;
+      end if;
+    elsif WB_ADDR > WB_ADDR_OFFSET + 3 and WB_ADDR < WB_ADDR_OFFSET + 4 + CHAN_WORDS * CHANNELS then
+      case word mod CHAN_WORDS is
+        when 0 =>
+          wb_data_mux <= targetvel(chan);
+        when 1 =>
+          wb_data_mux <= deltalim(chan);
+        when 2 =>
+          wb_data_mux <= pos_hi(chan);
+        when 3 =>
+          wb_data_mux <= pos_lo(chan);
+        when 4 =>
+          wb_data_mux <= vel(chan);
+        when 5 =>
+          wb_data_mux <= cmd_hi(chan);
+        when 6 =>
+          wb_data_mux <= cmd_lo(chan);
+        when others =>
+          wb_data_mux <= posctl(chan);
+      end case;
+    else
+      wb_data_mux <= (others => '0');
+    end if;
+  end process;
+
+  -- with the global latch the channels are captured by the
+  -- snapshot strobe, the timebase word returns its time
+  capture <= SNAP when SNAP_EN = '1' else capture_rd;
+
+  P_SNAP_TS : process(WB_RST, WB_CLK)
+  begin
+    if WB_RST = '1' then
+      snap_ts <= (others => '0');
+    elsif rising_edge(WB_CLK) then
+      if SNAP = '1' then
+        snap_ts <= timestamp;
+      end if;
+    end if;
+  end process;
+
+  timestamp_proc: process(WB_RST, WB_CLK)
+  begin
+    if WB_RST = '1' then
+      timestamp <= (others => '0');
+    elsif rising_edge(WB_CLK) then
+      timestamp <= timestamp + 1;
+    end if;
   end process;
 
   P_WB_RD_REG : process(WB_RST, WB_CLK)
@@ -138,46 +153,43 @@ begin
   end process;
 
   P_PE_REG_WR : process(WB_RST, WB_CLK)
+    variable word: integer;
   begin
     if WB_RST = '1' then
       step_len <= (others => '0');
       dir_hold_dly <= (others => '0');
       dir_setup_dly <= (others => '0');
-      targetvel_a <= (others => '0');
-      deltalim_a <= (others => '0');
-      targetvel_b <= (others => '0');
-      deltalim_b <= (others => '0');
-      targetvel_c <= (others => '0');
-      deltalim_c <= (others => '0');
-      targetvel_d <= (others => '0');
-      deltalim_d <= (others => '0');
+      targetvel <= (others => (others => '0'));
+      deltalim <= (others => (others => '0'));
+      cmd_hi <= (others => (others => '0'));
+      cmd_lo <= (others => (others => '0'));
+      cmd_load <= (others => '0');
+      posctl <= (others => (others => '0'));
     elsif rising_edge(WB_CLK) then
+      cmd_load <= (others => '0');
       if WB_STB_WR = '1' then
-        case WB_ADDR is
-          when WB_ADDR_OFFSET =>
-            step_len <= WB_DATA_IN;
-          when WB_ADDR_OFFSET + 1 =>
-            dir_hold_dly <= WB_DATA_IN;
-          when WB_ADDR_OFFSET + 2 =>
-            dir_setup_dly <= WB_DATA_IN;
-          when WB_ADDR_OFFSET + 3 =>
-            targetvel_a <= WB_DATA_IN;
-          when WB_ADDR_OFFSET + 4 =>
-            deltalim_a <= WB_DATA_IN;
-          when WB_ADDR_OFFSET + 7 =>
-            targetvel_b <= WB_DATA_IN;
-          when WB_ADDR_OFFSET + 8 =>
-            deltalim_b <= WB_DATA_IN;
-          when WB_ADDR_OFFSET + 11 =>
-            targetvel_c <= WB_DATA_IN;
-          when WB_ADDR_OFFSET + 12 =>
-            deltalim_c <= WB_DATA_IN;
-          when WB_ADDR_OFFSET + 15 =>
-            targetvel_d <= WB_DATA_IN;
-          when WB_ADDR_OFFSET + 16 =>
-            deltalim_d <= WB_DATA_IN;
-          when others =>
-        end case;
+        word := conv_integer(WB_ADDR - WB_ADDR_OFFSET) - 4;
+        if WB_ADDR = WB_ADDR_OFFSET then
+          step_len <= WB_DATA_IN;
+        elsif WB_ADDR = WB_ADDR_OFFSET + 1 then
+          dir_hold_dly <= WB_DATA_IN;
+        elsif WB_ADDR = WB_ADDR_OFFSET + 2 then
+          dir_setup_dly <= WB_DATA_IN;
+        elsif WB_ADDR > WB_ADDR_OFFSET + 3 and WB_ADDR < WB_ADDR_OFFSET + 4 + CHAN_WORDS * CHANNELS then
+          if word mod CHAN_WORDS = 0 then
+            targetvel(word / CHAN_WORDS) <= WB_DATA_IN;
+          elsif word mod CHAN_WORDS = 1 then
+            deltalim(word / CHAN_WORDS) <= WB_DATA_IN;
+          elsif word mod CHAN_WORDS = 5 then
+            cmd_hi(word / CHAN_WORDS) <= WB_DATA_IN;
+          elsif word mod CHAN_WORDS = 6 then
+            -- the low word completes the position command
+            cmd_lo(word / CHAN_WORDS) <= WB_DATA_IN;
+            cmd_load(word / CHAN_WORDS) <= '1';
+          elsif word mod CHAN_WORDS = 7 then
+            posctl(word / CHAN_WORDS) <= WB_DATA_IN;
+          end if;
+        end if;
       end if;
     end if;
   end process;
@@ -186,94 +198,35 @@ begin
   --- stepgen instances
   ----------------------------------------------------------
 
-  IDLE <= idle_a and idle_b and idle_c and idle_d;
-
-  U_STEP_A: entity work.STEP_CHAN
-    port map (
-      RESET => WB_RST,
-      CLK => WB_CLK,
-
-      pos_capt => pos_capt_a,
-      pos_hi => pos_hi_a,
-      pos_lo => pos_lo_a,
-
-      targetvel => targetvel_a,
-      deltalim => deltalim_a,
-      step_len => step_len,
-      dir_hold_dly => dir_hold_dly,
-      dir_setup_dly => dir_setup_dly,
-
-      OUT_EN => OUT_EN,
-      IDLE => idle_a,
-
-      STP_OUT => SV(10),
-      STP_DIR => SV(9)
-    );
- 
-  U_STEP_B: entity work.STEP_CHAN
-    port map (
-      RESET => WB_RST,
-      CLK => WB_CLK,
-
-      pos_capt => pos_capt_b,
-      pos_hi => pos_hi_b,
-      pos_lo => pos_lo_b,
-
-      targetvel => targetvel_b,
-      deltalim => deltalim_b,
-      step_len => step_len,
-      dir_hold_dly => dir_hold_dly,
-      dir_setup_dly => dir_setup_dly,
-
-      OUT_EN => OUT_EN,
-      IDLE => idle_b,
-
-      STP_OUT => SV(8),
-      STP_DIR => SV(7)
-    );
- 
-  U_STEP_C: entity work.STEP_CHAN
-    port map (
-      RESET => WB_RST,
-      CLK => WB_CLK,
-
-      pos_capt => pos_capt_c,
-      pos_hi => pos_hi_c,
-      pos_lo => pos_lo_c,
-
-      targetvel => targetvel_c,
-      deltalim => deltalim_c,
-      step_len => step_len,
-      dir_hold_dly => dir_hold_dly,
-      dir_setup_dly => dir_setup_dly,
-
-      OUT_EN => OUT_EN,
-      IDLE => idle_c,
-
-      STP_OUT => SV(6),
-      STP_DIR => SV(5)
-    );
- 
-  U_STEP_D: entity work.STEP_CHAN
-    port map (
-      RESET => WB_RST,
-      CLK => WB_CLK,
-
-      pos_capt => pos_capt_d,
-      pos_hi => pos_hi_d,
-      pos_lo => pos_lo_d,
-
-      targetvel => targetvel_d,
-      deltalim => deltalim_d,
-      step_len => step_len,
-      dir_hold_dly => dir_hold_dly,
-      dir_setup_dly => dir_setup_dly,
-
-      OUT_EN => OUT_EN,
-      IDLE => idle_d,
-
-      STP_OUT => SV(4),
-      STP_DIR => SV(3)
-    );
+  IDLE <= '1' when idle_chan = (idle_chan'range => '1') else '0';
+
+  G_STEP_CHAN: for i in 0 to CHANNELS - 1 generate
+    U_STEP: entity work.STEP_CHAN
+      port map (
+        RESET => WB_RST,
+        CLK => WB_CLK,
+
+        pos_capt => capture,
+        pos_hi => pos_hi(i),
+        pos_lo => pos_lo(i),
+        vel_capt => vel(i),
+
+        targetvel => targetvel(i),
+        deltalim => deltalim(i),
+        pos_mode => posctl(i)(31),
+        maxvel => posctl(i)(30 downto 0),
+        cmd_load => cmd_load(i),
+        cmd_pos => cmd_hi(i) & cmd_lo(i),
+        step_len => step_len,
+        dir_hold_dly => dir_hold_dly,
+        dir_setup_dly => dir_setup_dly,
+
+        OUT_EN => OUT_EN,
+        IDLE => idle_chan(i),
+
+        STP_OUT => STP_OUT(i),
+        STP_DIR => STP_DIR(i)
+      );
+  end generate;
 
 end;
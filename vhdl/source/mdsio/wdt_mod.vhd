@@ -23,7 +23,10 @@ entity WDT_MOD is
     WB_STB_WR: in std_logic;
 
     RUN: out std_logic;
-    OUT_EN: out std_logic
+    OUT_EN: out std_logic;
+
+    -- pulses with every watchdog write, once per servo cycle
+    WR_STB: out std_logic
   );
 end;
 
@@ -35,6 +38,7 @@ architecture rtl of WDT_MOD is
   signal rand: std_logic_vector(15 downto 0) := RAND_SEED;
   signal rand_ok: std_logic;
   signal out_en_reg: std_logic;
+  signal boot_flag: std_logic;
 
   signal timer: std_logic_vector(19 downto 0);
   signal timeout: std_logic;
@@ -56,6 +60,8 @@ begin
         wb_data_mux <= (others => '0');
         wb_data_mux(15 downto 0) <= rand;
         wb_data_mux(16) <= out_en_reg;
+        wb_data_mux(17) <= cycle_ok;
+        wb_data_mux(18) <= boot_flag;
       when others => 
         wb_data_mux <= (others => '0');
     end case;
@@ -78,12 +84,17 @@ begin
       out_en_reg <= '0';
       rand <= RAND_SEED;
       rand_ok <= '0';
+      boot_flag <= '1';
     elsif rising_edge(WB_CLK) then
       rand_ok <= '0';
       if WB_STB_WR = '1' then
         case WB_ADDR is
           when WB_ADDR_OFFSET =>
             out_en_reg <= WB_DATA_IN(16);
+            -- set after every reset until acked by the driver
+            if WB_DATA_IN(18) = '1' then
+              boot_flag <= '0';
+            end if;
             if (WB_DATA_IN(15 downto 0) = rand) then
               rand_ok <= '1';
             end if;
@@ -131,6 +142,7 @@ begin
   -- set outputs
   RUN <= cycle_ok;
   OUT_EN <= out_en_reg and cycle_ok;
+  WR_STB <= '1' when WB_STB_WR = '1' and WB_ADDR = WB_ADDR_OFFSET else '0';
 
 end;
 
@@ -113,6 +113,7 @@ port (
     inta_drv    : out std_logic;
     req_drv     : out std_logic;
     gnt         : in std_logic;
+    mst_en      : out std_logic;
       
     -- Master whisbone
     wb_adr_o     : out std_logic_vector(24 downto 0);     
@@ -303,7 +304,8 @@ begin
         perrEN_o    => perrEN,
         serrEN_o    => serrEN,
         memEN_o        => memEN,
-         ioEN_o        => ioEN
+         ioEN_o        => ioEN,
+        mstEN_o        => mst_en
             
     );
     
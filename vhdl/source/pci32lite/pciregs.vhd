@@ -58,12 +58,13 @@
 --|    +-----------------------------------------------+------------------------------+                |
 --|    |    0    |    0   |   0    |    0   |   0    |    0    |     0     | SERRENb  | (15-8)            |
 --|    +------------------------------------------------------------------------------+                |
---|    |    0    | PERRENb|   0     |     0     |     0       |    0    |MEMSPACEENb|IOSPACEENb|  (7-0)         |
+--|    |    0    | PERRENb|   0     |     0     |     0       |BUSMASTb |MEMSPACEENb|IOSPACEENb|  (7-0)         |
 --|    +------------------------------------------------------------------------------+                |
 --|    | SERRENb : System ERRor ENable (1 = Enabled)                            |                        |
 --|    | PERRENb : Parity ERRor ENable (1 = Enabled)                            |                        |
 --|    | MEMSPACEENb : MEMory SPACE ENable (1 = Enabled)                        |                        |
 --|    | IOSPACEENb : IO SPACE ENable (1 = Enabled)                            |                        |
+--|    | BUSMASTb : BUS MASTer enable (1 = Enabled)                             |                        |
 --|    +-----------------------------------------------------------------------+                        |
 --|                                                                                                   |
 --|    +-----------------------------------------------+                                                |
@@ -203,7 +204,8 @@ port (
     perrEN_o        : out std_logic;
     serrEN_o        : out std_logic;
     memEN_o            : out std_logic;
-    ioEN_o            : out std_logic
+    ioEN_o            : out std_logic;
+    mstEN_o            : out std_logic
         
 );   
 end pciregs;
@@ -265,6 +267,7 @@ architecture rtl of pciregs is
     -- COMMAND register bits
     signal MEMSPACEENb    : std_logic;                        -- Memory SPACE ENable (bit)
     signal IOSPACEENb    : std_logic;                        -- IO SPACE ENable (bit)
+    signal BUSMASTb        : std_logic;                        -- BUS MASTer enable (bit)
     signal PERRENb        : std_logic;                        -- Parity ERRor ENable (bit)
     signal SERRENb        : std_logic;                        -- SERR ENable (bit)
     -- STATUS register bits
@@ -353,6 +356,7 @@ begin
         if( rst_i = '1' ) then
             IOSPACEENb  <= '0';
             MEMSPACEENb <= '0';
+            BUSMASTb    <= '0';
             PERRENb     <= '0';
             SERRENb     <= '0';            
         elsif( rising_edge( clk_i ) ) then
@@ -361,6 +365,7 @@ begin
             if( we0CMD = '1' ) then
                 IOSPACEENb  <= dat_i(0);
                 MEMSPACEENb <= dat_i(1);
+                BUSMASTb    <= dat_i(2);
                 PERRENb     <= dat_i(6);                
             end if;
             
@@ -470,7 +475,7 @@ begin
     --+-------------------------------------------------------------------------+
     --|  Registers MUX    (READ)                                                    |
     --+-------------------------------------------------------------------------+
-    RRMUX: process( adr_i, PERRDTb, SERRSIb, TABORTSIb, SERRENb, PERRENb, MEMSPACEENb, IOSPACEENb, BAR0b, 
+    RRMUX: process( adr_i, PERRDTb, SERRSIb, TABORTSIb, SERRENb, PERRENb, BUSMASTb, MEMSPACEENb, IOSPACEENb, BAR0b, 
                     INTLINEr, rdcfg_i )
     begin
 
@@ -482,7 +487,7 @@ begin
                     dataout <= DEVICEIDr & VENDORIDr;
                 when b"000001" => 
                     dataout <= PERRDTb & SERRSIb & b"00" & TABORTSIb & DEVSELTIMb & b"000000000" &
-                               b"0000000" & SERRENb & b"0" & PERRENb & b"0000" & MEMSPACEENb & IOSPACEENb;
+                               b"0000000" & SERRENb & b"0" & PERRENb & b"000" & BUSMASTb & MEMSPACEENb & IOSPACEENb;
                 when b"000010" => 
                     dataout <= CLASSCODEr & REVISIONIDr;
                 when b"000100" => 
@@ -516,6 +521,7 @@ begin
     serrEN_o    <= SERRENb;        
     memEN_o        <= MEMSPACEENb;
     ioEN_o        <= IOSPACEENb;
+    mstEN_o        <= BUSMASTb;
 
     
 end rtl;
@@ -0,0 +1,235 @@
+library ieee;
+  use ieee.std_logic_1164.all;
+  use ieee.std_logic_unsigned.all;
+  use ieee.numeric_std.all;
+
+library UNISIM;
+  use UNISIM.Vcomponents.all;
+
+-- minimal pci bus master, only does linear memory write bursts.
+-- data is fetched from a synchronous source with one clock
+-- read latency: SRC_DATA holds the word addressed by SRC_IDX
+-- in the previous clock. no transaction is started while EN
+-- (bus master enable of the config space) is cleared, a start
+-- refused or dropped that way ends with ERR.
+entity PCI_MWR is
+  port (
+    CLK: in std_logic;
+    RST: in std_logic;
+
+    EN: in std_logic;
+    START: in std_logic;
+    ADDR: in std_logic_vector(31 downto 2);
+    LEN: in std_logic_vector(15 downto 0);
+    BUSY: out std_logic;
+    ERR: out std_logic;
+
+    SRC_IDX: out std_logic_vector(15 downto 0);
+    SRC_DATA: in std_logic_vector(31 downto 0);
+
+    -- pci signals, all active low as on the bus
+    AD_OUT: out std_logic_vector(31 downto 0);
+    AD_OE: out std_logic;
+    CBE_OUT: out std_logic_vector(3 downto 0);
+    PAR_OUT: out std_logic;
+    PAR_OE: out std_logic;
+    FRAME_IN: in std_logic;
+    FRAME_OUT: out std_logic;
+    IRDY_IN: in std_logic;
+    IRDY_OUT: out std_logic;
+    CTL_OE: out std_logic;
+    TRDY_IN: in std_logic;
+    STOP_IN: in std_logic;
+    DEVSEL_IN: in std_logic;
+    REQ: out std_logic;
+    GNT: in std_logic
+  );
+end;
+
+architecture rtl of PCI_MWR is
+  constant CMD_MEM_WRITE: std_logic_vector(3 downto 0) := "0111";
+
+  type state_t is (ST_IDLE, ST_REQ, ST_ADDR, ST_DATA, ST_LAST, ST_TURN);
+  signal state: state_t;
+
+  signal addr_reg: std_logic_vector(31 downto 2);
+  signal cnt: std_logic_vector(15 downto 0);
+  signal idx: std_logic_vector(15 downto 0);
+  signal idx_next: std_logic_vector(15 downto 0);
+  signal devsel_wait: std_logic_vector(2 downto 0);
+  signal err_reg: std_logic;
+
+  signal req_reg: std_logic;
+  signal frame_reg: std_logic;
+  signal irdy_reg: std_logic;
+  signal ctl_oe_reg: std_logic;
+  signal ad_oe_reg: std_logic;
+  signal cbe_reg: std_logic_vector(3 downto 0);
+  signal ad_mux: std_logic_vector(31 downto 0);
+  signal par_reg: std_logic;
+  signal par_oe_reg: std_logic;
+
+begin
+  ----------------------------------------------------------
+  --- data path
+  ----------------------------------------------------------
+  -- advance source address with the data phase that completes
+  -- in this clock, so the next word is ready in time. stays on
+  -- the last word to not address beyond the source.
+  idx_next <= idx + 1 when (state = ST_DATA or state = ST_LAST) and TRDY_IN = '0' and cnt /= 1 else idx;
+  SRC_IDX <= idx_next;
+
+  ad_mux <= addr_reg & "00" when state = ST_ADDR else SRC_DATA;
+
+  P_PAR : process(RST, CLK)
+    variable p: std_logic;
+  begin
+    if RST = '1' then
+      par_reg <= '0';
+      par_oe_reg <= '0';
+    elsif rising_edge(CLK) then
+      p := '0';
+      for i in 0 to 31 loop
+        p := p xor ad_mux(i);
+      end loop;
+      for i in 0 to 3 loop
+        p := p xor cbe_reg(i);
+      end loop;
+      par_reg <= p;
+      par_oe_reg <= ad_oe_reg;
+    end if;
+  end process;
+
+  ----------------------------------------------------------
+  --- transaction sequencer
+  ----------------------------------------------------------
+  P_SEQ : process(RST, CLK)
+  begin
+    if RST = '1' then
+      state <= ST_IDLE;
+      addr_reg <= (others => '0');
+      cnt <= (others => '0');
+      idx <= (others => '0');
+      devsel_wait <= (others => '0');
+      err_reg <= '0';
+      req_reg <= '0';
+      frame_reg <= '1';
+      irdy_reg <= '1';
+      ctl_oe_reg <= '0';
+      ad_oe_reg <= '0';
+      cbe_reg <= (others => '1');
+    elsif rising_edge(CLK) then
+      idx <= idx_next;
+
+      case state is
+        when ST_IDLE =>
+          if START = '1' and LEN /= 0 then
+            if EN = '1' then
+              addr_reg <= ADDR;
+              cnt <= LEN;
+              idx <= (others => '0');
+              err_reg <= '0';
+              req_reg <= '1';
+              state <= ST_REQ;
+            else
+              err_reg <= '1';
+            end if;
+          end if;
+
+        when ST_REQ =>
+          -- wait for grant on an idle bus
+          if EN = '0' then
+            err_reg <= '1';
+            req_reg <= '0';
+            state <= ST_IDLE;
+          elsif GNT = '0' and FRAME_IN = '1' and IRDY_IN = '1' then
+            frame_reg <= '0';
+            ctl_oe_reg <= '1';
+            ad_oe_reg <= '1';
+            cbe_reg <= CMD_MEM_WRITE;
+            devsel_wait <= (others => '0');
+            state <= ST_ADDR;
+          end if;
+
+        when ST_ADDR =>
+          req_reg <= '0';
+          irdy_reg <= '0';
+          cbe_reg <= (others => '0');
+          if cnt = 1 then
+            frame_reg <= '1';
+            state <= ST_LAST;
+          else
+            state <= ST_DATA;
+          end if;
+
+        when ST_DATA =>
+          if TRDY_IN = '0' then
+            addr_reg <= addr_reg + 1;
+            cnt <= cnt - 1;
+          end if;
+          if DEVSEL_IN = '1' and devsel_wait /= 4 then
+            devsel_wait <= devsel_wait + 1;
+          end if;
+
+          -- end burst on master abort, target disconnect,
+          -- lost grant or with the last word
+          if DEVSEL_IN = '1' and devsel_wait = 4 then
+            err_reg <= '1';
+            cnt <= (others => '0');
+            frame_reg <= '1';
+            state <= ST_LAST;
+          elsif STOP_IN = '0' or GNT = '1' or (TRDY_IN = '0' and cnt = 2) then
+            frame_reg <= '1';
+            state <= ST_LAST;
+          end if;
+
+        when ST_LAST =>
+          if TRDY_IN = '0' then
+            addr_reg <= addr_reg + 1;
+            cnt <= cnt - 1;
+          end if;
+          if DEVSEL_IN = '1' and devsel_wait /= 4 then
+            devsel_wait <= devsel_wait + 1;
+          end if;
+
+          if DEVSEL_IN = '1' and devsel_wait = 4 then
+            err_reg <= '1';
+            cnt <= (others => '0');
+            irdy_reg <= '1';
+            ad_oe_reg <= '0';
+            state <= ST_TURN;
+          elsif TRDY_IN = '0' or STOP_IN = '0' then
+            irdy_reg <= '1';
+            ad_oe_reg <= '0';
+            state <= ST_TURN;
+          end if;
+
+        when ST_TURN =>
+          -- frame/irdy were driven high for one clock, release them
+          ctl_oe_reg <= '0';
+          cbe_reg <= (others => '1');
+          if cnt = 0 then
+            state <= ST_IDLE;
+          else
+            -- disconnected, retry with the remaining words
+            req_reg <= '1';
+            state <= ST_REQ;
+          end if;
+      end case;
+    end if;
+  end process;
+
+  BUSY <= '0' when state = ST_IDLE else '1';
+  ERR <= err_reg;
+
+  AD_OUT <= ad_mux;
+  AD_OE <= ad_oe_reg;
+  CBE_OUT <= cbe_reg;
+  PAR_OUT <= par_reg;
+  PAR_OE <= par_oe_reg;
+  FRAME_OUT <= frame_reg;
+  IRDY_OUT <= irdy_reg;
+  CTL_OE <= ctl_oe_reg;
+  REQ <= req_reg;
+
+end;
@@ -16,14 +16,14 @@ entity pci_top is
     -- onboard clock
     onboard_clock : in std_logic;
 
-    -- PCI Target 32 bits
+    -- PCI Target 32 bits, master for image dma
     pclk          : in std_logic;
     rst_n         : in std_logic;
     ad            : inout std_logic_vector(31 downto 0);
-    cbe_n         : in std_logic_vector(3 downto 0);
+    cbe_n         : inout std_logic_vector(3 downto 0);
     par           : inout std_logic;  
-    frame_n       : in std_logic;
-    irdy_n        : in std_logic;
+    frame_n       : inout std_logic;
+    irdy_n        : inout std_logic;
     trdy_n        : inout std_logic;
     devsel_n      : inout std_logic;
     stop_n        : inout std_logic;
@@ -101,12 +101,25 @@ architecture rtl of pci_top is
   signal pci_serr_drv   : std_logic;
   signal pci_inta_drv   : std_logic;
   signal pci_req_drv    : std_logic;
+  signal pci_mst_en     : std_logic;
+
+  signal mst_ad_out     : std_logic_vector(31 downto 0);
+  signal mst_ad_oe      : std_logic;
+  signal mst_cbe_out    : std_logic_vector(3 downto 0);
+  signal mst_par_out    : std_logic;
+  signal mst_par_oe     : std_logic;
+  signal mst_frame_out  : std_logic;
+  signal mst_irdy_out   : std_logic;
+  signal mst_ctl_oe     : std_logic;
+  signal mst_req        : std_logic;
 
   signal mds_cs         : std_logic;
   signal mds_stb        : std_logic;
   signal mds_stb_wr     : std_logic;
   signal mds_stb_rd     : std_logic;
   signal mds_ack        : std_logic;
+  signal mds_rty        : std_logic;
+  signal mds_lock       : std_logic;
   signal mds_oe         : std_logic;
   signal mds_run        : std_logic;
   signal mds_addr       : std_logic_vector(15 downto 2);
@@ -119,6 +132,23 @@ architecture rtl of pci_top is
   signal mds_datrd6     : std_logic_vector(31 downto 0);
   signal mds_datrd7     : std_logic_vector(31 downto 0);
   signal mds_datrd8     : std_logic_vector(31 downto 0);
+  signal mds_datrd9     : std_logic_vector(31 downto 0);
+  signal mds_datrd10    : std_logic_vector(31 downto 0);
+  signal mds_wdt_stb    : std_logic;
+  signal mds_snap       : std_logic;
+  signal mds_snap_en    : std_logic;
+  signal mds_probe      : std_logic;
+
+  signal img_addr       : std_logic_vector(15 downto 2);
+  signal img_stb_rd     : std_logic;
+
+  signal dma_start      : std_logic;
+  signal dma_addr       : std_logic_vector(31 downto 2);
+  signal dma_len        : std_logic_vector(15 downto 0);
+  signal dma_busy       : std_logic;
+  signal dma_err        : std_logic;
+  signal dma_idx        : std_logic_vector(15 downto 0);
+  signal dma_data       : std_logic_vector(31 downto 0);
 
 begin
 
@@ -208,6 +238,7 @@ begin
       inta_drv     => pci_inta_drv,
       req_drv      => pci_req_drv,
       gnt          => gnt_n,
+      mst_en       => pci_mst_en,
       -- Master whisbone
       wb_adr_o     => wb_adr,    
       wb_dat_i     => wb_datrd,
@@ -217,21 +248,59 @@ begin
       wb_stb_o     => wb_stb, 
       wb_cyc_o     => wb_cyc, 
       wb_ack_i     => wb_ack, 
-      wb_rty_i     => '0', 
+      wb_rty_i     => mds_rty, 
       wb_err_i     => '0',
       wb_int_i     => wb_irq
     );
 
+  -- PCI Master (image dma), only while the host set bus master enable
+  U_PCI_MWR: entity work.PCI_MWR
+    port map (
+      CLK          => wb_clk,
+      RST          => wb_rst,
+
+      EN           => pci_mst_en,
+      START        => dma_start,
+      ADDR         => dma_addr,
+      LEN          => dma_len,
+      BUSY         => dma_busy,
+      ERR          => dma_err,
+
+      SRC_IDX      => dma_idx,
+      SRC_DATA     => dma_data,
+
+      AD_OUT       => mst_ad_out,
+      AD_OE        => mst_ad_oe,
+      CBE_OUT      => mst_cbe_out,
+      PAR_OUT      => mst_par_out,
+      PAR_OE       => mst_par_oe,
+      FRAME_IN     => frame_n,
+      FRAME_OUT    => mst_frame_out,
+      IRDY_IN      => irdy_n,
+      IRDY_OUT     => mst_irdy_out,
+      CTL_OE       => mst_ctl_oe,
+      TRDY_IN      => trdy_n,
+      STOP_IN      => stop_n,
+      DEVSEL_IN    => devsel_n,
+      REQ          => mst_req,
+      GNT          => gnt_n
+    );
+
   -- pci open drain / tristate
-  ad       <= pci_ad_out when pci_ad_oe = '1' else (others => 'Z');
-  par      <= pci_par_out when pci_par_oe = '1' else 'Z';
+  ad       <= pci_ad_out when pci_ad_oe = '1' else
+              mst_ad_out when mst_ad_oe = '1' else (others => 'Z');
+  cbe_n    <= mst_cbe_out when mst_ad_oe = '1' else (others => 'Z');
+  par      <= pci_par_out when pci_par_oe = '1' else
+              mst_par_out when mst_par_oe = '1' else 'Z';
+  frame_n  <= mst_frame_out when mst_ctl_oe = '1' else 'Z';
+  irdy_n   <= mst_irdy_out when mst_ctl_oe = '1' else 'Z';
   trdy_n   <= pci_trdy_out when pci_targ_oe = '1' else 'Z';
   devsel_n <= pci_devsel_out when pci_targ_oe = '1' else 'Z';
   stop_n   <= pci_stop_out  when pci_targ_oe = '1' else 'Z';
   perr_n   <= '0' when pci_perr_drv = '1' else 'Z';
   serr_n   <= '0' when pci_serr_drv = '1' else 'Z';
   inta_n   <= '0' when pci_inta_drv = '1' else 'Z';
-  req_n    <= '0' when pci_req_drv  = '1' else 'Z';
+  req_n    <= '0' when pci_req_drv = '1' or mst_req = '1' else 'Z';
 
   -- irq handling
   wb_irq <= '0';
@@ -243,31 +312,44 @@ begin
   -- mdsio whisbone adapter
   ----------------------------------------------------------
 
+  -- pci accesses are retried while the snapshot sequencer owns the bus
   mds_cs     <= '1' when ((wb_stb = '1') and (wb_cyc = '1')) else '0';
-  mds_stb    <= '1' when mds_cs = '1' and wb_ack = '0' else '0'; 
-  mds_stb_rd <= '1' when mds_stb = '1' and wb_we = '0' else '0';
+  mds_stb    <= '1' when mds_cs = '1' and wb_ack = '0' and mds_rty = '0' and mds_lock = '0' else '0'; 
+  mds_stb_rd <= img_stb_rd when mds_lock = '1' else
+                '1' when mds_stb = '1' and wb_we = '0' else '0';
   mds_stb_wr <= '1' when mds_stb = '1' and wb_we = '1' else '0';
 
   P_MDS_WB_ACK : process(wb_rst, wb_clk)
   begin
     if wb_rst = '1' then
       mds_ack <= '0';
+      mds_rty <= '0';
     elsif rising_edge(wb_clk) then
-      mds_ack <= mds_cs;
+      mds_ack <= mds_cs and not mds_lock;
+      mds_rty <= mds_cs and mds_lock;
     end if;
   end process;
 
+  -- only the low 16 address bits are decoded, so the register space
+  -- repeats every 64k in BAR0. the driver maps the alias at 0x10000
+  -- write-combining for outputs (mdsio_pci wc parameter).
   wb_datrd <= mds_datrd;
-  mds_addr <= wb_adr(15 downto 2);
+  mds_addr <= img_addr when mds_lock = '1' else wb_adr(15 downto 2);
 
   ----------------------------------------------------------
   -- mdsio instances
   ----------------------------------------------------------
 
+  -- conf words 0..9, word 10 stays unused as eol marker,
+  -- module registers from word 11 on. the channel modules
+  -- report their CHANNELS generic in the conf word, the
+  -- register offsets below follow from it.
+
   U_DIO_MOD0: entity work.DIO_MOD
     generic map (
       WB_CONF_OFFSET => "00000000000000",
-      WB_ADDR_OFFSET => "00000000001001"
+      WB_ADDR_OFFSET => "00000000001011",
+      CHANNELS       => 5
     )
     port map (
       OUT_EN      => mds_oe,
@@ -282,13 +364,20 @@ begin
       WB_STB_RD   => mds_stb_rd,
       WB_STB_WR   => mds_stb_wr,
 
+      SNAP        => mds_snap,
+      SNAP_EN     => mds_snap_en,
+
+      PROBE_IN    => not SV8(10),
+      PROBE       => mds_probe,
+
       SV          => SV1
     );
 
   U_DAC_MOD0: entity work.DAC_MOD
     generic map (
       WB_CONF_OFFSET => "00000000000001",
-      WB_ADDR_OFFSET => "00000000001011"
+      WB_ADDR_OFFSET => "00000000001101",
+      CHANNELS       => 6
     )
     port map (
       OUT_EN      => mds_oe,
@@ -309,7 +398,8 @@ begin
   U_PHPE_MOD0: entity work.PHPE_MOD
     generic map (
       WB_CONF_OFFSET => "00000000000010",
-      WB_ADDR_OFFSET => "00000000001110"
+      WB_ADDR_OFFSET => "00000000010000",
+      CHANNELS       => 2
     )
     port map (
       CLK100      => clk100,
@@ -322,13 +412,23 @@ begin
       WB_STB_RD   => mds_stb_rd,
       WB_STB_WR   => mds_stb_wr,
 
-      SV          => SV3
+      SNAP        => mds_snap,
+      SNAP_EN     => mds_snap_en,
+      PROBE       => mds_probe,
+
+      TRAMS(0)    => not SV3(8),
+      TRAMS(1)    => not SV3(7),
+      AREA(0)     => not SV3(10),
+      AREA(1)     => not SV3(9),
+      SCAN_OUT    => SV3(5),
+      TRARS_OUT   => SV3(6)
     );
 
   U_PHPE_MOD1: entity work.PHPE_MOD
     generic map (
       WB_CONF_OFFSET => "00000000000011",
-      WB_ADDR_OFFSET => "00000000011101"
+      WB_ADDR_OFFSET => "00000000100101",
+      CHANNELS       => 2
     )
     port map (
       CLK100      => clk100,
@@ -341,43 +441,77 @@ begin
       WB_STB_RD   => mds_stb_rd,
       WB_STB_WR   => mds_stb_wr,
 
-      SV          => SV4
+      SNAP        => mds_snap,
+      SNAP_EN     => mds_snap_en,
+      PROBE       => mds_probe,
+
+      TRAMS(0)    => not SV4(8),
+      TRAMS(1)    => not SV4(7),
+      AREA(0)     => not SV4(10),
+      AREA(1)     => not SV4(9),
+      SCAN_OUT    => SV4(5),
+      TRARS_OUT   => SV4(6)
     );
 
   U_ENC_MOD0: entity work.ENC_MOD
     generic map (
       WB_CONF_OFFSET => "00000000000100",
-      WB_ADDR_OFFSET => "00000000101100"
+      WB_ADDR_OFFSET => "00000000111010",
+      CHANNELS       => 2
     )
     port map (
       WB_CLK      => wb_clk,
       WB_RST      => wb_rst,
       WB_ADDR     => mds_addr,
       WB_DATA_OUT => mds_datrd5,
+      WB_DATA_IN  => wb_datwr,
       WB_STB_RD   => mds_stb_rd,
+      WB_STB_WR   => mds_stb_wr,
 
-      SV          => SV5
+      SNAP        => mds_snap,
+      SNAP_EN     => mds_snap_en,
+      PROBE       => mds_probe,
+
+      ENC_A(0)    => not SV5(10),
+      ENC_A(1)    => not SV5(9),
+      ENC_B(0)    => not SV5(8),
+      ENC_B(1)    => not SV5(7),
+      ENC_I(0)    => not SV5(6),
+      ENC_I(1)    => not SV5(5)
     );
 
   U_ENC_MOD1: entity work.ENC_MOD
     generic map (
       WB_CONF_OFFSET => "00000000000101",
-      WB_ADDR_OFFSET => "00000000110011"
+      WB_ADDR_OFFSET => "00000001000111",
+      CHANNELS       => 2
     )
     port map (
       WB_CLK      => wb_clk,
       WB_RST      => wb_rst,
       WB_ADDR     => mds_addr,
       WB_DATA_OUT => mds_datrd6,
+      WB_DATA_IN  => wb_datwr,
       WB_STB_RD   => mds_stb_rd,
+      WB_STB_WR   => mds_stb_wr,
 
-      SV          => SV6
+      SNAP        => mds_snap,
+      SNAP_EN     => mds_snap_en,
+      PROBE       => mds_probe,
+
+      ENC_A(0)    => not SV6(10),
+      ENC_A(1)    => not SV6(9),
+      ENC_B(0)    => not SV6(8),
+      ENC_B(1)    => not SV6(7),
+      ENC_I(0)    => not SV6(6),
+      ENC_I(1)    => not SV6(5)
     );
 
   U_STEP_MOD0: entity work.STEP_MOD
     generic map (
       WB_CONF_OFFSET => "00000000000110",
-      WB_ADDR_OFFSET => "00000000111010"
+      WB_ADDR_OFFSET => "00000001010100",
+      CHANNELS       => 4
     )
     port map (
       OUT_EN      => mds_oe,
@@ -390,13 +524,23 @@ begin
       WB_STB_RD   => mds_stb_rd,
       WB_STB_WR   => mds_stb_wr,
 
-      SV          => SV7
+      SNAP        => mds_snap,
+      SNAP_EN     => mds_snap_en,
+
+      STP_OUT(0)  => SV7(10),
+      STP_DIR(0)  => SV7(9),
+      STP_OUT(1)  => SV7(8),
+      STP_DIR(1)  => SV7(7),
+      STP_OUT(2)  => SV7(6),
+      STP_DIR(2)  => SV7(5),
+      STP_OUT(3)  => SV7(4),
+      STP_DIR(3)  => SV7(3)
     );
 
   U_WDT_MOD0: entity work.WDT_MOD
     generic map (
       WB_CONF_OFFSET => "00000000000111",
-      WB_ADDR_OFFSET => "00000001001110"
+      WB_ADDR_OFFSET => "00000001111000"
     )
     port map (
       WB_CLK      => wb_clk,
@@ -408,10 +552,67 @@ begin
       WB_STB_WR   => mds_stb_wr,
 
       RUN         => mds_run,
-      OUT_EN      => mds_oe
+      OUT_EN      => mds_oe,
+      WR_STB      => mds_wdt_stb
     );
 
-  mds_datrd <= mds_datrd1 or mds_datrd2 or mds_datrd3 or mds_datrd4 or mds_datrd5 or mds_datrd6 or mds_datrd7 or mds_datrd8;
+  -- bus monitor, counts the pci target accesses per watchdog cycle
+  U_BMON_MOD0: entity work.BMON_MOD
+    generic map (
+      WB_CONF_OFFSET => "00000000001001",
+      WB_ADDR_OFFSET => "00000001111001"
+    )
+    port map (
+      WB_CLK      => wb_clk,
+      WB_RST      => wb_rst,
+      WB_ADDR     => mds_addr,
+      WB_DATA_OUT => mds_datrd10,
+      WB_STB_RD   => mds_stb_rd,
+
+      MON_CYC     => mds_cs,
+      MON_WE      => wb_we,
+      MON_ACK     => wb_ack,
+      MON_RTY     => mds_rty,
+
+      LATCH       => mds_wdt_stb
+    );
+
+  -- process image, latches the inputs of all modules at once
+  U_IMG_MOD0: entity work.IMG_MOD
+    generic map (
+      WB_CONF_OFFSET => "00000000001000",
+      WB_ADDR_OFFSET => "00000010000000",
+      SRC_OFFSET     => "00000000001011",
+      SRC_LEN        => 117,
+      DMA_EN         => true
+    )
+    port map (
+      WB_CLK      => wb_clk,
+      WB_RST      => wb_rst,
+      WB_ADDR     => mds_addr,
+      WB_DATA_OUT => mds_datrd9,
+      WB_DATA_IN  => wb_datwr,
+      WB_STB_RD   => mds_stb_rd,
+      WB_STB_WR   => mds_stb_wr,
+
+      SNAP        => mds_snap,
+      SNAP_EN     => mds_snap_en,
+
+      BUSY        => mds_lock,
+      SRC_ADDR    => img_addr,
+      SRC_STB_RD  => img_stb_rd,
+      SRC_DATA    => mds_datrd,
+
+      DMA_START   => dma_start,
+      DMA_ADDR    => dma_addr,
+      DMA_LEN     => dma_len,
+      DMA_BUSY    => dma_busy,
+      DMA_ERR     => dma_err,
+      DMA_IDX     => dma_idx,
+      DMA_DATA    => dma_data
+    );
+
+  mds_datrd <= mds_datrd1 or mds_datrd2 or mds_datrd3 or mds_datrd4 or mds_datrd5 or mds_datrd6 or mds_datrd7 or mds_datrd8 or mds_datrd9 or mds_datrd10;
 
   ----------------------------------------------------------
   -- Debug Stuff
@@ -420,7 +621,15 @@ begin
   can1_tx <= '0';
   can2_tx <= '0';
 
-  SV8 <= (others => '0');
+  -- unused pins of the phpe and encoder headers
+  SV3(4 downto 3) <= (others => '0');
+  SV4(4 downto 3) <= (others => '0');
+  SV5(4 downto 3) <= (others => '0');
+  SV6(4 downto 3) <= (others => '0');
+
+  -- SV8 pin 10 is the probe input
+  SV8(10) <= 'Z';
+  SV8(9 downto 3) <= (others => '0');
   SV9 <= (others => '0');
 
   LED_CONF <= '1';